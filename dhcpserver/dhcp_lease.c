@@ -0,0 +1,260 @@
+#include <string.h>
+
+#include "dhcp_lease.h"
+
+_Static_assert((DHCP_LEASE_BALDES & (DHCP_LEASE_BALDES - 1)) == 0, "DHCP_LEASE_BALDES deve ser potencia de 2");
+_Static_assert(DHCPS_MAX_IP <= 256, "pool maior que a tabela de hash");
+
+// ================= HASH (MAC -> índice) =================
+
+// FNV-1a: MACs aleatórios e sequenciais do mesmo fabricante espalham bem
+static uint16_t hash_mac(const uint8_t mac[6]) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; i++) h = (h ^ mac[i]) * 16777619u;
+    return (uint16_t)(h ^ (h >> 16));
+}
+
+// Posição do MAC na tabela ou DHCP_LEASE_NENHUM
+static uint16_t hash_posicao(const dhcp_lease_tabela_t *t, const uint8_t mac[6]) {
+    uint16_t m = t->hash_mascara;
+    for (uint16_t p = hash_mac(mac) & m; t->hash[p]; p = (p + 1) & m) {
+        if (memcmp(t->lease[t->hash[p] - 1].mac, mac, 6) == 0) return p;
+    }
+    return DHCP_LEASE_NENHUM;
+}
+
+static void hash_inserir(dhcp_lease_tabela_t *t, uint16_t i) {
+    uint16_t m = t->hash_mascara;
+    uint16_t p = hash_mac(t->lease[i].mac) & m;
+    while (t->hash[p]) p = (p + 1) & m;
+    t->hash[p] = i + 1;
+}
+
+// Remoção por deslocamento para trás: quem estava depois do buraco e pode
+// ocupá-lo sem ficar antes da própria posição de origem é puxado
+static void hash_remover(dhcp_lease_tabela_t *t, uint16_t p) {
+    uint16_t m = t->hash_mascara;
+    uint16_t j = p;
+
+    t->hash[p] = 0;
+    for (;;) {
+        j = (j + 1) & m;
+        if (!t->hash[j]) return;
+        uint16_t k = hash_mac(t->lease[t->hash[j] - 1].mac) & m;
+        bool fica = (p <= j) ? (p < k && k <= j) : (p < k || k <= j);
+        if (fica) continue;
+        t->hash[p] = t->hash[j];
+        t->hash[j] = 0;
+        p = j;
+    }
+}
+
+// ================= LISTAS (roda e livres) =================
+
+static uint16_t balde(uint32_t ms) {
+    return (uint16_t)((ms / DHCP_LEASE_TICK_MS) & (DHCP_LEASE_BALDES - 1));
+}
+
+static void lista_inserir(dhcp_lease_tabela_t *t, uint16_t *inicio, uint16_t i) {
+    t->lease[i].ant = DHCP_LEASE_NENHUM;
+    t->lease[i].prox = *inicio;
+    if (*inicio != DHCP_LEASE_NENHUM) t->lease[*inicio].ant = i;
+    *inicio = i;
+}
+
+static void lista_remover(dhcp_lease_tabela_t *t, uint16_t *inicio, uint16_t i) {
+    dhcp_lease_t *l = &t->lease[i];
+    if (l->ant != DHCP_LEASE_NENHUM) t->lease[l->ant].prox = l->prox;
+    else *inicio = l->prox;
+    if (l->prox != DHCP_LEASE_NENHUM) t->lease[l->prox].ant = l->ant;
+}
+
+static void roda_inserir(dhcp_lease_tabela_t *t, uint16_t i) {
+    lista_inserir(t, &t->roda[balde(t->lease[i].expira_ms)], i);
+}
+
+static void roda_remover(dhcp_lease_tabela_t *t, uint16_t i) {
+    lista_remover(t, &t->roda[balde(t->lease[i].expira_ms)], i);
+}
+
+// Fila de livres: sai do início, volta no fim (o endereço devolvido há mais
+// tempo é reutilizado primeiro)
+static void livres_inserir(dhcp_lease_tabela_t *t, uint16_t i) {
+    t->lease[i].prox = DHCP_LEASE_NENHUM;
+    t->lease[i].ant = t->livres_fim;
+    if (t->livres_fim != DHCP_LEASE_NENHUM) t->lease[t->livres_fim].prox = i;
+    else t->livres_inicio = i;
+    t->livres_fim = i;
+}
+
+static void livres_remover(dhcp_lease_tabela_t *t, uint16_t i) {
+    dhcp_lease_t *l = &t->lease[i];
+    if (l->ant != DHCP_LEASE_NENHUM) t->lease[l->ant].prox = l->prox;
+    else t->livres_inicio = l->prox;
+    if (l->prox != DHCP_LEASE_NENHUM) t->lease[l->prox].ant = l->ant;
+    else t->livres_fim = l->ant;
+}
+
+// ================= ESTADOS =================
+
+static void agendar(dhcp_lease_tabela_t *t, uint16_t i, uint32_t expira_ms) {
+    if (t->lease[i].estado != DHCP_LEASE_LIVRE) roda_remover(t, i);
+    t->lease[i].expira_ms = expira_ms;
+    roda_inserir(t, i);
+}
+
+// Tira o lease do dono (hash) e da roda
+static void desligar(dhcp_lease_tabela_t *t, uint16_t i) {
+    dhcp_lease_t *l = &t->lease[i];
+    if (l->estado == DHCP_LEASE_OFERECIDO || l->estado == DHCP_LEASE_ATIVO) {
+        hash_remover(t, hash_posicao(t, l->mac));
+    }
+    roda_remover(t, i);
+    memset(l->mac, 0, sizeof(l->mac));
+}
+
+static void devolver(dhcp_lease_tabela_t *t, uint16_t i) {
+    if (t->lease[i].estado == DHCP_LEASE_ATIVO) t->alteracoes++;
+    desligar(t, i);
+    t->lease[i].estado = DHCP_LEASE_LIVRE;
+    livres_inserir(t, i);
+    t->em_uso--;
+}
+
+static void ocupar(dhcp_lease_tabela_t *t, uint16_t i, const uint8_t mac[6], uint8_t estado, uint32_t expira_ms) {
+    dhcp_lease_t *l = &t->lease[i];
+    livres_remover(t, i);
+    memcpy(l->mac, mac, sizeof(l->mac));
+    l->estado = estado;
+    l->restaurado = 0;
+    l->expira_ms = expira_ms;
+    roda_inserir(t, i);
+    hash_inserir(t, i);
+    t->em_uso++;
+}
+
+// ================= API =================
+
+void dhcp_lease_init(dhcp_lease_tabela_t *t, uint16_t n, uint32_t agora_ms) {
+    memset(t, 0, sizeof(*t));
+    if (n > DHCPS_MAX_IP) n = DHCPS_MAX_IP;
+    t->n = n;
+
+    // Carga da tabela de hash <= 50%
+    t->hash_mascara = 1;
+    while (t->hash_mascara < 2 * n && t->hash_mascara < DHCP_LEASE_HASH_MAX) t->hash_mascara <<= 1;
+    t->hash_mascara--;
+
+    for (int b = 0; b < DHCP_LEASE_BALDES; b++) t->roda[b] = DHCP_LEASE_NENHUM;
+    t->livres_inicio = t->livres_fim = DHCP_LEASE_NENHUM;
+    for (uint16_t i = 0; i < n; i++) livres_inserir(t, i);
+    t->roda_ms = agora_ms - agora_ms % DHCP_LEASE_TICK_MS;
+}
+
+// Um balde por tick decorrido. O teste é pelo horário, não pela volta da roda:
+// um lease cujo vencimento ainda não chegou fica no balde para a próxima volta.
+void dhcp_lease_tick(dhcp_lease_tabela_t *t, uint32_t agora_ms) {
+    int ticks = 0;
+    while ((int32_t)(agora_ms - t->roda_ms) >= DHCP_LEASE_TICK_MS && ticks++ < DHCP_LEASE_BALDES) {
+        uint16_t i = t->roda[balde(t->roda_ms)];
+        while (i != DHCP_LEASE_NENHUM) {
+            uint16_t prox = t->lease[i].prox;
+            if ((int32_t)(t->lease[i].expira_ms - agora_ms) <= 0) {
+                devolver(t, i);
+                t->stats.expiradas++;
+            }
+            i = prox;
+        }
+        t->roda_ms += DHCP_LEASE_TICK_MS;
+    }
+    // Atraso maior que uma volta: todos os baldes já foram vistos
+    if ((int32_t)(agora_ms - t->roda_ms) >= DHCP_LEASE_TICK_MS) {
+        t->roda_ms = agora_ms - agora_ms % DHCP_LEASE_TICK_MS;
+    }
+}
+
+uint16_t dhcp_lease_buscar(const dhcp_lease_tabela_t *t, const uint8_t mac[6]) {
+    uint16_t p = hash_posicao(t, mac);
+    return (p == DHCP_LEASE_NENHUM) ? DHCP_LEASE_NENHUM : t->hash[p] - 1;
+}
+
+uint16_t dhcp_lease_oferecer(dhcp_lease_tabela_t *t, const uint8_t mac[6], uint32_t agora_ms) {
+    uint16_t i = dhcp_lease_buscar(t, mac);
+
+    if (i != DHCP_LEASE_NENHUM) {
+        // Cliente conhecido: mesmo endereço; uma oferta pendente é renovada
+        if (t->lease[i].estado == DHCP_LEASE_OFERECIDO) agendar(t, i, agora_ms + DHCP_LEASE_OFERTA_S * 1000u);
+    } else {
+        i = t->livres_inicio;
+        if (i == DHCP_LEASE_NENHUM) {
+            t->stats.esgotado++;
+            return DHCP_LEASE_NENHUM;
+        }
+        ocupar(t, i, mac, DHCP_LEASE_OFERECIDO, agora_ms + DHCP_LEASE_OFERTA_S * 1000u);
+    }
+    t->stats.ofertas++;
+    return i;
+}
+
+dhcp_lease_resposta_t dhcp_lease_confirmar(dhcp_lease_tabela_t *t, const uint8_t mac[6], uint16_t indice,
+                                           uint32_t agora_ms, uint32_t duracao_s) {
+    if (indice >= t->n) {
+        t->stats.naks++;
+        return DHCP_LEASE_NAK;
+    }
+    dhcp_lease_t *l = &t->lease[indice];
+    uint32_t expira_ms = agora_ms + duracao_s * 1000u;
+
+    if (l->estado == DHCP_LEASE_LIVRE) {
+        // Endereço livre pedido direto (cliente que voltou sem DISCOVER):
+        // um lease anterior do mesmo MAC é devolvido
+        uint16_t anterior = dhcp_lease_buscar(t, mac);
+        if (anterior != DHCP_LEASE_NENHUM) devolver(t, anterior);
+        ocupar(t, indice, mac, DHCP_LEASE_ATIVO, expira_ms);
+    } else if ((l->estado == DHCP_LEASE_OFERECIDO || l->estado == DHCP_LEASE_ATIVO) &&
+               memcmp(l->mac, mac, sizeof(l->mac)) == 0) {
+        agendar(t, indice, expira_ms);
+        l->estado = DHCP_LEASE_ATIVO;
+        if (l->restaurado) {
+            l->restaurado = 0;
+            t->stats.reconectados++;
+        }
+    } else {
+        t->stats.naks++;
+        return DHCP_LEASE_NAK;
+    }
+    t->stats.acks++;
+    if (!t->stats.primeiro_ack_ms) t->stats.primeiro_ack_ms = agora_ms ? agora_ms : 1;
+    t->alteracoes++;
+    return DHCP_LEASE_ACK;
+}
+
+void dhcp_lease_liberar(dhcp_lease_tabela_t *t, const uint8_t mac[6]) {
+    uint16_t i = dhcp_lease_buscar(t, mac);
+    if (i != DHCP_LEASE_NENHUM) devolver(t, i);
+}
+
+void dhcp_lease_recusar(dhcp_lease_tabela_t *t, const uint8_t mac[6], uint32_t agora_ms) {
+    uint16_t i = dhcp_lease_buscar(t, mac);
+    if (i == DHCP_LEASE_NENHUM) return;
+
+    if (t->lease[i].estado == DHCP_LEASE_ATIVO) t->alteracoes++;
+    desligar(t, i);
+    t->lease[i].estado = DHCP_LEASE_RECUSADO;
+    t->lease[i].expira_ms = agora_ms + DHCP_LEASE_RECUSA_S * 1000u;
+    roda_inserir(t, i);
+}
+
+uint16_t dhcp_lease_em_uso(const dhcp_lease_tabela_t *t) {
+    return t->em_uso;
+}
+
+bool dhcp_lease_restaurar(dhcp_lease_tabela_t *t, const uint8_t mac[6], uint16_t indice,
+                          uint32_t agora_ms, uint32_t duracao_s) {
+    if (indice >= t->n || t->lease[indice].estado != DHCP_LEASE_LIVRE) return false;
+    if (dhcp_lease_buscar(t, mac) != DHCP_LEASE_NENHUM) return false;
+
+    ocupar(t, indice, mac, DHCP_LEASE_ATIVO, agora_ms + duracao_s * 1000u);
+    t->lease[indice].restaurado = 1;
+    return true;
+}
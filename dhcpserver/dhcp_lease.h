@@ -0,0 +1,105 @@
+#ifndef DHCP_LEASE_H
+#define DHCP_LEASE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Tabela de concessões do servidor DHCP, sem acesso a hardware nem ao lwIP
+// (o benchmark em tools/ usa o mesmo código):
+//  - busca pelo MAC em O(1): hash com endereçamento aberto (sondagem linear,
+//    remoção por deslocamento para trás, sem lápides)
+//  - endereços livres numa fila: o devolvido há mais tempo é o próximo a sair
+//  - expiração por roda de temporização: cada tick olha só um balde
+// O tempo (ms, com wrap) vem sempre de quem chama.
+
+// ================= CONFIGURAÇÃO =================
+#ifndef DHCPS_MAX_IP
+#define DHCPS_MAX_IP 32              // Tamanho do pool (endereços DHCPS_BASE_IP...)
+#endif
+
+#define DHCP_LEASE_OFERTA_S    60     // Endereço reservado entre o OFFER e o REQUEST
+#define DHCP_LEASE_RECUSA_S    600    // Endereço fora do pool após um DECLINE
+#define DHCP_LEASE_TICK_MS     1000
+#define DHCP_LEASE_BALDES      64     // Potência de 2
+
+#define DHCP_LEASE_NENHUM      0xFFFF
+#define DHCP_LEASE_HASH_MAX    (DHCPS_MAX_IP <= 8 ? 16 : DHCPS_MAX_IP <= 32 ? 64 : DHCPS_MAX_IP <= 128 ? 256 : 512)
+
+typedef enum {
+    DHCP_LEASE_LIVRE = 0,
+    DHCP_LEASE_OFERECIDO,
+    DHCP_LEASE_ATIVO,
+    DHCP_LEASE_RECUSADO          // DECLINE: endereço em conflito na rede, sem dono
+} dhcp_lease_estado_t;
+
+typedef struct {
+    uint8_t mac[6];
+    uint8_t estado;
+    uint8_t restaurado;          // Veio da flash e o cliente ainda não confirmou
+    uint32_t expira_ms;
+    uint16_t prox;               // Balde da roda (ou fila de livres)
+    uint16_t ant;
+} dhcp_lease_t;
+
+typedef struct {
+    uint32_t ofertas;
+    uint32_t acks;
+    uint32_t naks;
+    uint32_t expiradas;
+    uint32_t esgotado;           // DISCOVER sem endereço livre
+    uint32_t reconectados;       // ACKs de leases restaurados da flash
+    uint32_t primeiro_ack_ms;    // agora_ms do primeiro ACK após o init (0 = nenhum)
+} dhcp_lease_stats_t;
+
+typedef struct {
+    dhcp_lease_t lease[DHCPS_MAX_IP];
+    uint16_t hash[DHCP_LEASE_HASH_MAX];     // Índice do lease + 1 (0 = vazio)
+    uint16_t hash_mascara;
+    uint16_t n;
+    uint16_t em_uso;             // Fora da fila de livres (oferecidos, ativos e recusados)
+    uint16_t livres_inicio;
+    uint16_t livres_fim;
+    uint16_t roda[DHCP_LEASE_BALDES];
+    uint32_t roda_ms;            // Início do próximo tick a processar
+    uint32_t alteracoes;         // Muda a cada ACK ou lease ativo desfeito (para quem persiste a tabela)
+    dhcp_lease_stats_t stats;
+} dhcp_lease_tabela_t;
+
+typedef enum {
+    DHCP_LEASE_ACK = 0,
+    DHCP_LEASE_NAK
+} dhcp_lease_resposta_t;
+
+// ================= API =================
+// n <= DHCPS_MAX_IP endereços, índices 0..n-1
+void dhcp_lease_init(dhcp_lease_tabela_t *t, uint16_t n, uint32_t agora_ms);
+
+// Expira o que venceu até agora_ms (chamar com frequência; custo por tick = um balde)
+void dhcp_lease_tick(dhcp_lease_tabela_t *t, uint32_t agora_ms);
+
+// Índice do lease do MAC ou DHCP_LEASE_NENHUM
+uint16_t dhcp_lease_buscar(const dhcp_lease_tabela_t *t, const uint8_t mac[6]);
+
+// DISCOVER: o endereço atual do MAC ou um livre, reservado por DHCP_LEASE_OFERTA_S.
+// DHCP_LEASE_NENHUM com o pool esgotado.
+uint16_t dhcp_lease_oferecer(dhcp_lease_tabela_t *t, const uint8_t mac[6], uint32_t agora_ms);
+
+// REQUEST do endereço 'indice': ACK (concessão por duracao_s) ou NAK se o
+// endereço é de outro cliente
+dhcp_lease_resposta_t dhcp_lease_confirmar(dhcp_lease_tabela_t *t, const uint8_t mac[6], uint16_t indice,
+                                           uint32_t agora_ms, uint32_t duracao_s);
+
+// RELEASE: devolve o endereço do MAC ao pool
+void dhcp_lease_liberar(dhcp_lease_tabela_t *t, const uint8_t mac[6]);
+
+// DECLINE: o endereço do MAC está em uso por outro host; fica fora do pool por DHCP_LEASE_RECUSA_S
+void dhcp_lease_recusar(dhcp_lease_tabela_t *t, const uint8_t mac[6], uint32_t agora_ms);
+
+uint16_t dhcp_lease_em_uso(const dhcp_lease_tabela_t *t);
+
+// Recria um lease ativo salvo antes do reset. Falha se o endereço já está
+// ocupado ou o MAC já tem lease.
+bool dhcp_lease_restaurar(dhcp_lease_tabela_t *t, const uint8_t mac[6], uint16_t indice,
+                          uint32_t agora_ms, uint32_t duracao_s);
+
+#endif
@@ -35,6 +35,7 @@
 #include "cyw43_config.h"
 #include "dhcpserver.h"
 #include "lwip/udp.h"
+#include "log.h"
 
 #define DHCPDISCOVER    (1)
 #define DHCPOFFER       (2)
@@ -211,31 +212,16 @@ static void dhcp_server_process(void *arg, struct udp_pcb *upcb, struct pbuf *p,
         goto ignore_request;
     }
 
+    uint32_t now = cyw43_hal_ticks_ms();
+    dhcp_lease_tick(&d->leases, now);
+
+    bool nak = false;
     switch (msgtype[2]) {
         case DHCPDISCOVER: {
-            int yi = DHCPS_MAX_IP;
-            for (int i = 0; i < DHCPS_MAX_IP; ++i) {
-                if (memcmp(d->lease[i].mac, dhcp_msg.chaddr, MAC_LEN) == 0) {
-                    // MAC match, use this IP address
-                    yi = i;
-                    break;
-                }
-                if (yi == DHCPS_MAX_IP) {
-                    // Look for a free IP address
-                    if (memcmp(d->lease[i].mac, "\x00\x00\x00\x00\x00\x00", MAC_LEN) == 0) {
-                        // IP available
-                        yi = i;
-                    }
-                    uint32_t expiry = d->lease[i].expiry << 16 | 0xffff;
-                    if ((int32_t)(expiry - cyw43_hal_ticks_ms()) < 0) {
-                        // IP expired, reuse it
-                        memset(d->lease[i].mac, 0, MAC_LEN);
-                        yi = i;
-                    }
-                }
-            }
-            if (yi == DHCPS_MAX_IP) {
+            uint16_t yi = dhcp_lease_oferecer(&d->leases, dhcp_msg.chaddr, now);
+            if (yi == DHCP_LEASE_NENHUM) {
                 // No more IP addresses left
+                LOG_AVISO("DHCPS: pool exhausted (%u leases)", (unsigned)d->leases.n);
                 goto ignore_request;
             }
             dhcp_msg.yiaddr[3] = DHCPS_BASE_IP + yi;
@@ -244,50 +230,78 @@ static void dhcp_server_process(void *arg, struct udp_pcb *upcb, struct pbuf *p,
         }
 
         case DHCPREQUEST: {
-            uint8_t *o = opt_find(opt, DHCP_OPT_REQUESTED_IP);
-            if (o == NULL) {
-                // Should be NACK
+            uint8_t *o = opt_find(opt, DHCP_OPT_SERVER_ID);
+            if (o != NULL && memcmp(o + 2, &ip4_addr_get_u32(ip_2_ip4(&d->ip)), 4) != 0) {
+                // Client selected another server: drop our offer
+                uint16_t yi = dhcp_lease_buscar(&d->leases, dhcp_msg.chaddr);
+                if (yi != DHCP_LEASE_NENHUM && d->leases.lease[yi].estado == DHCP_LEASE_OFERECIDO) {
+                    dhcp_lease_liberar(&d->leases, dhcp_msg.chaddr);
+                }
                 goto ignore_request;
             }
-            if (memcmp(o + 2, &ip4_addr_get_u32(ip_2_ip4(&d->ip)), 3) != 0) {
-                // Should be NACK
-                goto ignore_request;
+
+            // INIT-REBOOT/SELECTING carry option 50; RENEWING/REBINDING use ciaddr
+            const uint8_t *req_ip;
+            o = opt_find(opt, DHCP_OPT_REQUESTED_IP);
+            if (o != NULL) {
+                req_ip = o + 2;
+            } else if (memcmp(dhcp_msg.ciaddr, "\x00\x00\x00\x00", 4) != 0) {
+                req_ip = dhcp_msg.ciaddr;
+            } else {
+                nak = true;
+                break;
             }
-            uint8_t yi = o[5] - DHCPS_BASE_IP;
-            if (yi >= DHCPS_MAX_IP) {
-                // Should be NACK
-                goto ignore_request;
+            if (memcmp(req_ip, &ip4_addr_get_u32(ip_2_ip4(&d->ip)), 3) != 0 || req_ip[3] < DHCPS_BASE_IP) {
+                nak = true;
+                break;
             }
-            if (memcmp(d->lease[yi].mac, dhcp_msg.chaddr, MAC_LEN) == 0) {
-                // MAC match, ok to use this IP address
-            } else if (memcmp(d->lease[yi].mac, "\x00\x00\x00\x00\x00\x00", MAC_LEN) == 0) {
-                // IP unused, ok to use this IP address
-                memcpy(d->lease[yi].mac, dhcp_msg.chaddr, MAC_LEN);
-            } else {
-                // IP already in use
-                // Should be NACK
-                goto ignore_request;
+            uint16_t yi = req_ip[3] - DHCPS_BASE_IP;
+            if (dhcp_lease_confirmar(&d->leases, dhcp_msg.chaddr, yi, now, DEFAULT_LEASE_TIME_S) != DHCP_LEASE_ACK) {
+                // Out of the pool or leased to another client
+                nak = true;
+                break;
             }
-            d->lease[yi].expiry = (cyw43_hal_ticks_ms() + DEFAULT_LEASE_TIME_S * 1000) >> 16;
             dhcp_msg.yiaddr[3] = DHCPS_BASE_IP + yi;
             opt_write_u8(&opt, DHCP_OPT_MSG_TYPE, DHCPACK);
-            printf("DHCPS: client connected: MAC=%02x:%02x:%02x:%02x:%02x:%02x IP=%u.%u.%u.%u\n",
+            LOG_INFO("DHCPS: client connected: MAC=%02x:%02x:%02x:%02x:%02x:%02x IP=%u.%u.%u.%u",
                 dhcp_msg.chaddr[0], dhcp_msg.chaddr[1], dhcp_msg.chaddr[2], dhcp_msg.chaddr[3], dhcp_msg.chaddr[4], dhcp_msg.chaddr[5],
                 dhcp_msg.yiaddr[0], dhcp_msg.yiaddr[1], dhcp_msg.yiaddr[2], dhcp_msg.yiaddr[3]);
             break;
         }
 
+        case DHCPRELEASE:
+            dhcp_lease_liberar(&d->leases, dhcp_msg.chaddr);
+            goto ignore_request;
+
+        case DHCPDECLINE:
+            // Address already in use on the network: keep it out of the pool for a while
+            LOG_AVISO("DHCPS: address declined by MAC=%02x:%02x:%02x:%02x:%02x:%02x",
+                dhcp_msg.chaddr[0], dhcp_msg.chaddr[1], dhcp_msg.chaddr[2], dhcp_msg.chaddr[3], dhcp_msg.chaddr[4], dhcp_msg.chaddr[5]);
+            dhcp_lease_recusar(&d->leases, dhcp_msg.chaddr, now);
+            goto ignore_request;
+
         default:
             goto ignore_request;
     }
 
+    struct netif *nif = ip_current_input_netif();
+    if (nak) {
+        // RFC 2131 4.3.2: NAK is broadcast with no address and only the server id
+        memset(dhcp_msg.ciaddr, 0, 4);
+        memset(dhcp_msg.yiaddr, 0, 4);
+        opt_write_u8(&opt, DHCP_OPT_MSG_TYPE, DHCPNACK);
+        opt_write_n(&opt, DHCP_OPT_SERVER_ID, 4, &ip4_addr_get_u32(ip_2_ip4(&d->ip)));
+        *opt++ = DHCP_OPT_END;
+        dhcp_socket_sendto(&d->udp, nif, &dhcp_msg, opt - (uint8_t *)&dhcp_msg, 0xffffffff, PORT_DHCP_CLIENT);
+        goto ignore_request;
+    }
+
     opt_write_n(&opt, DHCP_OPT_SERVER_ID, 4, &ip4_addr_get_u32(ip_2_ip4(&d->ip)));
     opt_write_n(&opt, DHCP_OPT_SUBNET_MASK, 4, &ip4_addr_get_u32(ip_2_ip4(&d->nm)));
     opt_write_n(&opt, DHCP_OPT_ROUTER, 4, &ip4_addr_get_u32(ip_2_ip4(&d->ip))); // aka gateway; can have multiple addresses
     opt_write_n(&opt, DHCP_OPT_DNS, 4, &ip4_addr_get_u32(ip_2_ip4(&d->ip))); // this server is the dns
     opt_write_u32(&opt, DHCP_OPT_IP_LEASE_TIME, DEFAULT_LEASE_TIME_S);
     *opt++ = DHCP_OPT_END;
-    struct netif *nif = ip_current_input_netif();
     dhcp_socket_sendto(&d->udp, nif, &dhcp_msg, opt - (uint8_t *)&dhcp_msg, 0xffffffff, PORT_DHCP_CLIENT);
 
 ignore_request:
@@ -297,7 +311,7 @@ ignore_request:
 void dhcp_server_init(dhcp_server_t *d, ip_addr_t *ip, ip_addr_t *nm) {
     ip_addr_copy(d->ip, *ip);
     ip_addr_copy(d->nm, *nm);
-    memset(d->lease, 0, sizeof(d->lease));
+    dhcp_lease_init(&d->leases, DHCPS_MAX_IP, cyw43_hal_ticks_ms());
     if (dhcp_socket_new_dgram(&d->udp, d, dhcp_server_process) != 0) {
         return;
     }
@@ -307,3 +321,7 @@ void dhcp_server_init(dhcp_server_t *d, ip_addr_t *ip, ip_addr_t *nm) {
 void dhcp_server_deinit(dhcp_server_t *d) {
     dhcp_socket_free(&d->udp);
 }
+
+void dhcp_server_tick(dhcp_server_t *d) {
+    dhcp_lease_tick(&d->leases, cyw43_hal_ticks_ms());
+}
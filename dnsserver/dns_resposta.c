@@ -0,0 +1,156 @@
+#include <string.h>
+
+#include "dns_resposta.h"
+
+#define DNS_CABECALHO_BYTES  12
+#define DNS_NOME_MAX         255
+
+#define DNS_TIPO_A           1
+#define DNS_TIPO_SOA         6
+#define DNS_TIPO_AAAA        28
+#define DNS_TIPO_SVCB        64
+#define DNS_TIPO_HTTPS       65
+#define DNS_TIPO_ANY         255
+#define DNS_CLASSE_IN        1
+#define DNS_CLASSE_ANY       255
+
+#define DNS_RCODE_NXDOMAIN   3
+
+// ================= MODELOS =================
+
+static uint8_t *put16(uint8_t *p, uint16_t v) {
+    *p++ = (uint8_t)(v >> 8);
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v) {
+    p = put16(p, (uint16_t)(v >> 16));
+    return put16(p, (uint16_t)v);
+}
+
+// Nome do registro = ponteiro para a pergunta, sempre logo após o cabeçalho
+static uint8_t *registro(uint8_t *p, uint16_t tipo, uint16_t rdlen) {
+    p = put16(p, 0xC000 | DNS_CABECALHO_BYTES);
+    p = put16(p, tipo);
+    p = put16(p, DNS_CLASSE_IN);
+    p = put32(p, DNS_TTL_S);
+    return put16(p, rdlen);
+}
+
+void dns_modelos_init(dns_modelos_t *m, uint32_t ip) {
+    uint8_t *p = registro(m->a, DNS_TIPO_A, 4);
+    memcpy(p, &ip, 4);
+
+    // SOA sem nomes (raiz) só para dar o TTL negativo (RFC 2308)
+    p = registro(m->soa, DNS_TIPO_SOA, 22);
+    *p++ = 0;                    // MNAME
+    *p++ = 0;                    // RNAME
+    p = put32(p, 1);             // SERIAL
+    p = put32(p, 3600);          // REFRESH
+    p = put32(p, 600);           // RETRY
+    p = put32(p, 86400);         // EXPIRE
+    put32(p, DNS_TTL_S);         // MINIMUM
+}
+
+const uint8_t *dns_modelo(const dns_modelos_t *m, dns_resposta_t r, size_t *len) {
+    if (r == DNS_RESPOSTA_A) {
+        *len = sizeof(m->a);
+        return m->a;
+    }
+    *len = sizeof(m->soa);
+    return m->soa;
+}
+
+// ================= CONSULTA =================
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+// Hash do nome de 4 em 4 bytes. O bit 5 é ignorado, o que iguala maiúsculas
+// e minúsculas (e alguns pares de símbolos, sem importância para contar repetições).
+static uint32_t hash_nome(const uint8_t *nome, size_t len) {
+    uint32_t h = 2166136261u;
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        uint32_t w;
+        memcpy(&w, nome + i, 4);
+        h = (h ^ (w | 0x20202020u)) * 16777619u;
+        h ^= h >> 15;
+    }
+    for (; i < len; i++) h = (h ^ (nome[i] | 0x20u)) * 16777619u;
+    return h;
+}
+
+static dns_resposta_t classificar(uint16_t tipo, uint16_t classe) {
+    if (classe != DNS_CLASSE_IN && classe != DNS_CLASSE_ANY) return DNS_RESPOSTA_NXDOMAIN;
+    switch (tipo) {
+    case DNS_TIPO_A:
+    case DNS_TIPO_ANY:
+        return DNS_RESPOSTA_A;
+    case DNS_TIPO_AAAA:
+    case DNS_TIPO_SVCB:
+    case DNS_TIPO_HTTPS:
+        return DNS_RESPOSTA_VAZIA;
+    default:
+        return DNS_RESPOSTA_NXDOMAIN;
+    }
+}
+
+dns_resposta_t dns_resposta_preparar(uint8_t *msg, size_t len, size_t *mantido, uint32_t *hash) {
+    if (len < DNS_CABECALHO_BYTES) return DNS_RESPOSTA_IGNORAR;
+
+    // flags (RFC 1035): QR | Opcode(4) | AA | TC | RD | RA | Z(3) | RCODE(4)
+    uint16_t flags = get16(msg + 2);
+    if ((flags & 0x8000) || ((flags >> 11) & 0xF) != 0 || get16(msg + 4) < 1) return DNS_RESPOSTA_IGNORAR;
+
+    // Só a primeira pergunta: os rótulos são pulados sem olhar os caracteres
+    size_t p = DNS_CABECALHO_BYTES;
+    for (;;) {
+        if (p >= len) return DNS_RESPOSTA_IGNORAR;
+        uint8_t rotulo = msg[p++];
+        if (rotulo == 0) break;
+        if (rotulo > 63 || p + rotulo > len) return DNS_RESPOSTA_IGNORAR;   // Ponteiro não vale na pergunta
+        p += rotulo;
+        if (p - DNS_CABECALHO_BYTES > DNS_NOME_MAX) return DNS_RESPOSTA_IGNORAR;
+    }
+    if (p + 4 > len) return DNS_RESPOSTA_IGNORAR;
+    uint32_t h = hash_nome(msg + DNS_CABECALHO_BYTES, p - DNS_CABECALHO_BYTES);
+
+    uint16_t tipo = get16(msg + p);
+    dns_resposta_t r = classificar(tipo, get16(msg + p + 2));
+    p += 4;
+
+    // Resposta autoritativa; RD volta como veio
+    uint16_t resposta = 0x8000 | 0x0400 | (flags & 0x0100) | 0x0080;
+    if (r == DNS_RESPOSTA_NXDOMAIN) resposta |= DNS_RCODE_NXDOMAIN;
+    put16(msg + 2, resposta);
+    put16(msg + 4, 1);                                   // QDCOUNT
+    put16(msg + 6, r == DNS_RESPOSTA_A ? 1 : 0);         // ANCOUNT
+    put16(msg + 8, r == DNS_RESPOSTA_A ? 0 : 1);         // NSCOUNT (SOA)
+    put16(msg + 10, 0);                                  // ARCOUNT: EDNS e o resto ficam de fora
+
+    *mantido = p;
+    *hash = (h ^ tipo) * 16777619u;
+    return r;
+}
+
+// ================= REPETIÇÕES =================
+
+bool dns_recentes_repeticao(dns_recentes_t *r, uint32_t ip, uint32_t hash, uint32_t agora_ms) {
+    for (int i = 0; i < DNS_RECENTES; i++) {
+        dns_recente_t *e = &r->item[i];
+        if (e->ip == ip && e->hash == hash) {
+            bool repeticao = (agora_ms - e->t_ms) < DNS_REPETICAO_MS;
+            e->t_ms = agora_ms;
+            return repeticao;
+        }
+    }
+    dns_recente_t *e = &r->item[r->proximo];
+    r->proximo = (uint8_t)((r->proximo + 1) % DNS_RECENTES);
+    e->ip = ip;
+    e->hash = hash;
+    e->t_ms = agora_ms;
+    return false;
+}
@@ -0,0 +1,66 @@
+#ifndef DNS_RESPOSTA_H
+#define DNS_RESPOSTA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Respostas do DNS do portal cativo, sem lwIP (o benchmark em tools/ usa o
+// mesmo código). Todo nome aponta para o AP, então a resposta só depende do
+// tipo pedido e é montada no próprio buffer da consulta: o cabeçalho é
+// reescrito, a pergunta fica como está e o registro anexado vem pronto de
+// dns_modelos_t.
+//  - A / ANY:               NOERROR com o A do AP
+//  - AAAA / HTTPS / SVCB:   NOERROR sem respostas + SOA (o celular guarda a
+//                           ausência por DNS_TTL_S em vez de repetir)
+//  - demais tipos:          NXDOMAIN + SOA
+
+// ================= CONFIGURAÇÃO =================
+#define DNS_TTL_S              60
+#define DNS_RECENTES           16      // Consultas lembradas para contar repetições
+#define DNS_REPETICAO_MS       5000    // Mesma pergunta do mesmo cliente dentro deste prazo
+
+#define DNS_MODELO_A_BYTES     16
+#define DNS_MODELO_SOA_BYTES   34
+
+typedef enum {
+    DNS_RESPOSTA_IGNORAR = 0,    // Não é consulta padrão ou está malformada
+    DNS_RESPOSTA_A,
+    DNS_RESPOSTA_VAZIA,
+    DNS_RESPOSTA_NXDOMAIN,
+    DNS_RESPOSTA_TIPOS
+} dns_resposta_t;
+
+// Registros anexados à pergunta, montados uma vez com o IP do AP
+typedef struct {
+    uint8_t a[DNS_MODELO_A_BYTES];
+    uint8_t soa[DNS_MODELO_SOA_BYTES];
+} dns_modelos_t;
+
+typedef struct {
+    uint32_t ip;
+    uint32_t hash;               // Nome (sem diferenciar maiúsculas) e tipo
+    uint32_t t_ms;
+} dns_recente_t;
+
+typedef struct {
+    dns_recente_t item[DNS_RECENTES];
+    uint8_t proximo;             // Substituição em rodízio
+} dns_recentes_t;
+
+// ================= API =================
+// ip em ordem de rede, como em ip_addr_t.addr
+void dns_modelos_init(dns_modelos_t *m, uint32_t ip);
+
+// Registro a anexar para o tipo de resposta
+const uint8_t *dns_modelo(const dns_modelos_t *m, dns_resposta_t r, size_t *len);
+
+// Valida a consulta em msg[0..len) e reescreve o cabeçalho como resposta.
+// *mantido = bytes da mensagem que seguem na resposta (cabeçalho + 1ª pergunta);
+// *hash = nome e tipo da pergunta, para dns_recentes_repeticao.
+dns_resposta_t dns_resposta_preparar(uint8_t *msg, size_t len, size_t *mantido, uint32_t *hash);
+
+// true se o cliente fez a mesma pergunta há menos de DNS_REPETICAO_MS
+bool dns_recentes_repeticao(dns_recentes_t *r, uint32_t ip, uint32_t hash, uint32_t agora_ms);
+
+#endif
@@ -10,25 +10,16 @@
 #include <assert.h>
 #include <stdbool.h>
 
+#include "cyw43_config.h"
 #include "dnsserver.h"
 #include "lwip/udp.h"
+#include "log.h"
 
 #define PORT_DNS_SERVER 53
 #define DUMP_DATA 0
 
 #define DEBUG_printf(...)
-#define ERROR_printf printf
-
-typedef struct dns_header_t_ {
-    uint16_t id;
-    uint16_t flags;
-    uint16_t question_count;
-    uint16_t answer_record_count;
-    uint16_t authority_record_count;
-    uint16_t additional_record_count;
-} dns_header_t;
-
-#define MAX_DNS_MSG_SIZE 300
+#define ERROR_printf LOG_ERRO
 
 static int dns_socket_new_dgram(struct udp_pcb **udp, void *cb_data, udp_recv_fn cb_udp_recv) {
     *udp = udp_new();
@@ -73,146 +64,65 @@ static void dump_bytes(const uint8_t *bptr, uint32_t len) {
 }
 #endif
 
-static int dns_socket_sendto(struct udp_pcb **udp, const void *buf, size_t len, const ip_addr_t *dest, uint16_t port) {
-    if (len > 0xffff) {
-        len = 0xffff;
-    }
-
-    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
-    if (p == NULL) {
-        ERROR_printf("DNS: Failed to send message out of memory\n");
-        return -ENOMEM;
-    }
-
-    memcpy(p->payload, buf, len);
-    err_t err = udp_sendto(*udp, p, dest, port);
-
-    pbuf_free(p);
-
-    if (err != ERR_OK) {
-        ERROR_printf("DNS: Failed to send message %d\n", err);
-        return err;
-    }
-
-#if DUMP_DATA
-    dump_bytes(buf, len);
-#endif
-    return len;
-}
-
+// The reply is built in the query's own pbuf: the header is rewritten in
+// place, the first question is kept, and the answer record is chained as a
+// PBUF_ROM pointing at the precomputed template. Nothing is copied here.
 static void dns_server_process(void *arg, struct udp_pcb *upcb, struct pbuf *p, const ip_addr_t *src_addr, u16_t src_port) {
     dns_server_t *d = arg;
     DEBUG_printf("dns_server_process %u\n", p->tot_len);
-
-    uint8_t dns_msg[MAX_DNS_MSG_SIZE];
-    dns_header_t *dns_hdr = (dns_header_t*)dns_msg;
-
-    size_t msg_len = pbuf_copy_partial(p, dns_msg, sizeof(dns_msg), 0);
-    if (msg_len < sizeof(dns_header_t)) {
-        goto ignore_request;
+    // Every query ends in exactly one counter: answers[r] once the reply is
+    // sent (IGNORAR when dropped as invalid) or no_memory
+    d->stats.queries++;
+
+    if (p->next != NULL) {
+        // Query split across pbufs (unusual for a single question)
+        struct pbuf *q = pbuf_coalesce(p, PBUF_TRANSPORT);
+        if (q == p) {
+            d->stats.no_memory++;
+            goto ignore_request;
+        }
+        p = q;
     }
 
 #if DUMP_DATA
-    dump_bytes(dns_msg, msg_len);
+    dump_bytes(p->payload, p->len);
 #endif
 
-    uint16_t flags = lwip_ntohs(dns_hdr->flags);
-    uint16_t question_count = lwip_ntohs(dns_hdr->question_count);
-
-    DEBUG_printf("len %d\n", msg_len);
-    DEBUG_printf("dns flags 0x%x\n", flags);
-    DEBUG_printf("dns question count 0x%x\n", question_count);
-
-    // flags from rfc1035
-    // +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-    // |QR|   Opcode  |AA|TC|RD|RA|   Z    |   RCODE   |
-    // +--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+--+
-
-    // Check QR indicates a query
-    if (((flags >> 15) & 0x1) != 0) {
-        DEBUG_printf("Ignoring non-query\n");
+    size_t kept;
+    uint32_t hash;
+    dns_resposta_t r = dns_resposta_preparar(p->payload, p->len, &kept, &hash);
+    if (r == DNS_RESPOSTA_IGNORAR) {
+        DEBUG_printf("Ignoring invalid or non-standard query\n");
+        d->stats.answers[r]++;
         goto ignore_request;
     }
 
-    // Check for standard query
-    if (((flags >> 11) & 0xf) != 0) {
-        DEBUG_printf("Ignoring non-standard query\n");
-        goto ignore_request;
+    if (dns_recentes_repeticao(&d->recentes, ip4_addr_get_u32(ip_2_ip4(src_addr)), hash, cyw43_hal_ticks_ms())) {
+        d->stats.repeats++;
     }
 
-    // Check question count
-    if (question_count < 1) {
-        DEBUG_printf("Invalid question count\n");
+    size_t record_len;
+    const uint8_t *record = dns_modelo(&d->modelos, r, &record_len);
+    struct pbuf *answer = pbuf_alloc(PBUF_RAW, record_len, PBUF_ROM);
+    if (answer == NULL) {
+        d->stats.no_memory++;
         goto ignore_request;
     }
+    answer->payload = (void *)record;
 
-    // Print the question
-    DEBUG_printf("question: ");
-    const uint8_t *question_ptr_start = dns_msg + sizeof(dns_header_t);
-    const uint8_t *question_ptr_end = dns_msg + msg_len;
-    const uint8_t *question_ptr = question_ptr_start;
-    while(question_ptr < question_ptr_end) {
-        if (*question_ptr == 0) {
-            question_ptr++;
-            break;
-        } else {
-            if (question_ptr > question_ptr_start) {
-                DEBUG_printf(".");
-            }
-            int label_len = *question_ptr++;
-            if (label_len > 63) {
-                DEBUG_printf("Invalid label\n");
-                goto ignore_request;
-            }
-            DEBUG_printf("%.*s", label_len, question_ptr);
-            question_ptr += label_len;
-        }
-    }
-    DEBUG_printf("\n");
+    // Drops EDNS and any further questions, then appends the record
+    pbuf_realloc(p, kept);
+    pbuf_cat(p, answer);
 
-    // Check question length
-    if (question_ptr - question_ptr_start > 255) {
-        DEBUG_printf("Invalid question length\n");
-        goto ignore_request;
+    DEBUG_printf("Sending %d byte reply to %s:%d\n", p->tot_len, ipaddr_ntoa(src_addr), src_port);
+    err_t err = udp_sendto(upcb, p, src_addr, src_port);
+    if (err != ERR_OK) {
+        ERROR_printf("DNS: Failed to send message %d", err);
+        d->stats.no_memory++;
+    } else {
+        d->stats.answers[r]++;
     }
 
-    // Skip QNAME and QTYPE
-    question_ptr += 4;
-
-    // Generate answer
-    uint8_t *answer_ptr = dns_msg + (question_ptr - dns_msg);
-    *answer_ptr++ = 0xc0; // pointer
-    *answer_ptr++ = question_ptr_start - dns_msg; // pointer to question
-    
-    *answer_ptr++ = 0;
-    *answer_ptr++ = 1; // host address
-
-    *answer_ptr++ = 0;
-    *answer_ptr++ = 1; // Internet class
-
-    *answer_ptr++ = 0;
-    *answer_ptr++ = 0;
-    *answer_ptr++ = 0;
-    *answer_ptr++ = 60; // ttl 60s
-
-    *answer_ptr++ = 0;
-    *answer_ptr++ = 4; // length
-    memcpy(answer_ptr, &d->ip.addr, 4); // use our address
-    answer_ptr += 4;
-
-    dns_hdr->flags = lwip_htons(
-                0x1 << 15 | // QR = response
-                0x1 << 10 | // AA = authoritative
-                0x1 << 7);   // RA = authenticated
-    dns_hdr->question_count = lwip_htons(1);
-    dns_hdr->answer_record_count = lwip_htons(1);
-    dns_hdr->authority_record_count = 0;
-    dns_hdr->additional_record_count = 0;
-
-    // Send the reply
-    DEBUG_printf("Sending %d byte reply to %s:%d\n", answer_ptr - dns_msg, ipaddr_ntoa(src_addr), src_port);
-    dns_socket_sendto(&d->udp, &dns_msg, answer_ptr - dns_msg, src_addr, src_port);
-
 ignore_request:
     pbuf_free(p);
 }
@@ -227,6 +137,9 @@ void dns_server_init(dns_server_t *d, ip_addr_t *ip) {
         return;
     }
     ip_addr_copy(d->ip, *ip);
+    dns_modelos_init(&d->modelos, ip4_addr_get_u32(ip_2_ip4(&d->ip)));
+    memset(&d->recentes, 0, sizeof(d->recentes));
+    memset(&d->stats, 0, sizeof(d->stats));
     DEBUG_printf("dns server listening on port %d\n", PORT_DNS_SERVER);
 }
 
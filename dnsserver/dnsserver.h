@@ -8,10 +8,21 @@
 #define _DNSSERVER_H_
 
 #include "lwip/ip_addr.h"
+#include "dns_resposta.h"
+
+typedef struct {
+    uint32_t queries;
+    uint32_t answers[DNS_RESPOSTA_TIPOS];   // Replies sent, by dns_resposta_t (IGNORAR = dropped as invalid)
+    uint32_t repeats;                       // Same question from the same client within DNS_REPETICAO_MS
+    uint32_t no_memory;                     // Dropped: no pbuf for the query or reply, or the send failed
+} dns_server_stats_t;
 
 typedef struct dns_server_t_ {
     struct udp_pcb *udp;
      ip_addr_t ip;
+    dns_modelos_t modelos;
+    dns_recentes_t recentes;
+    dns_server_stats_t stats;
 } dns_server_t;
 
 void dns_server_init(dns_server_t *d, ip_addr_t *ip);
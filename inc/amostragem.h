@@ -0,0 +1,50 @@
+#ifndef AMOSTRAGEM_H
+#define AMOSTRAGEM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// ================= CONFIGURAÇÃO =================
+// Carro em manobra (zona de atenção): amostragem rápida para o buzzer
+#define AMOSTRAGEM_RAPIDA_MS     25
+
+// Taxa fixa usada antes da amostragem adaptativa (referência dos contadores)
+#define AMOSTRAGEM_BASE_MS       100
+
+// Teto do backoff: limita o atraso de reação numa vaga estável
+#define AMOSTRAGEM_LENTA_MAX_MS  400
+
+// Amostras seguidas na mesma zona antes de dobrar o intervalo
+#define AMOSTRAGEM_ESTAVEIS      5
+
+typedef enum {
+    AMOSTRAGEM_ZONA_LIVRE = 0,
+    AMOSTRAGEM_ZONA_ATENCAO,
+    AMOSTRAGEM_ZONA_PARADO
+} amostragem_zona_t;
+
+// Política de um canal + contadores de comparação com a taxa fixa
+typedef struct {
+    uint16_t parado_mm;
+    uint16_t livre_mm;
+    amostragem_zona_t zona;
+    uint32_t intervalo_ms;
+    uint8_t estaveis;
+    uint64_t inicio_us;
+    uint64_t ultima_us;
+    uint64_t proxima_us;
+
+    uint32_t amostras;        // Amostras efetivamente feitas
+    uint32_t transicoes;      // Trocas de zona detectadas
+    uint32_t atraso_max_us;   // Pior atraso de detecção observado numa troca de zona
+} amostragem_canal_t;
+
+// ================= API =================
+void amostragem_init(amostragem_canal_t *c, uint16_t parado_mm, uint16_t livre_mm);
+bool amostragem_devida(const amostragem_canal_t *c, uint64_t agora_us);
+bool amostragem_registrar(amostragem_canal_t *c, uint16_t mm, uint64_t agora_us);
+void amostragem_adiar(amostragem_canal_t *c, uint64_t agora_us);
+bool amostragem_confirmar(amostragem_canal_t *c, uint64_t agora_us);
+uint32_t amostragem_base(const amostragem_canal_t *c, uint64_t agora_us);
+
+#endif
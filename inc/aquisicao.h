@@ -0,0 +1,52 @@
+#ifndef AQUISICAO_H
+#define AQUISICAO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "vl53l0x.h"
+#include "amostragem.h"
+
+// ================= CONFIGURAÇÃO =================
+#define AQUISICAO_MAX_CANAIS 8
+
+typedef enum {
+    CANAL_VL53L0X = 0,
+    CANAL_ULTRASSONICO
+} canal_tipo_t;
+
+// Leitura de um canal dentro de um ciclo de aquisição
+typedef struct {
+    uint16_t distancia_mm;   // SENSOR_SEM_ALVO quando não há alvo/eco
+    bool nova;               // true se o sensor entregou amostra neste ciclo
+    uint64_t t_us;           // Instante em que a leitura foi obtida
+} leitura_t;
+
+// Conjunto coerente entregue à lógica de decisão
+typedef struct {
+    uint64_t inicio_us;      // Disparo do ciclo
+    uint64_t fim_us;         // Último canal concluído
+    uint8_t n_canais;
+    leitura_t canal[AQUISICAO_MAX_CANAIS];
+} aquisicao_conjunto_t;
+
+typedef struct {
+    uint32_t ciclos;
+    uint64_t latencia_total_us;
+    uint32_t latencia_max_us;
+} aquisicao_stats_t;
+
+// ================= API =================
+int aquisicao_adicionar_vl53l0x(vl53l0x_dev *dev);
+int aquisicao_adicionar_ultrassonico(uint8_t canal_ultra);
+
+// Liga a amostragem adaptativa por canal (sem isto: taxa fixa AMOSTRAGEM_BASE_MS)
+void aquisicao_set_zonas(uint16_t parado_mm, uint16_t livre_mm);
+const amostragem_canal_t *aquisicao_get_amostragem(int canal);
+
+bool aquisicao_devida(void);
+void aquisicao_iniciar(void);
+bool aquisicao_em_andamento(void);
+bool aquisicao_coletar(aquisicao_conjunto_t *conjunto);
+const aquisicao_stats_t *aquisicao_get_stats(void);
+
+#endif
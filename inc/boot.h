@@ -0,0 +1,33 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// 1 = sem esperas fixas na inicialização (sem aguardar o USB e sem o
+//     autoteste do servo); 0 = comportamento antigo, útil para depuração
+#ifndef BOOT_RAPIDO
+#define BOOT_RAPIDO 1
+#endif
+
+// ================= FASES =================
+typedef enum {
+    BOOT_FASE_STDIO = 0,
+    BOOT_FASE_WIFI,
+    BOOT_FASE_HTTP,
+    BOOT_FASE_SENSORES,      // core1
+    BOOT_FASE_DISPLAY,       // core1
+    BOOT_FASE_ATUADORES,
+    BOOT_FASE_ESPERA_CORE1,
+    BOOT_FASE_RECUPERACAO,   // Estado das vagas e histórico lidos do log na flash
+    BOOT_FASE_PRIMEIRA_DECISAO,
+    BOOT_NUM_FASES
+} boot_fase_t;
+
+// ================= API =================
+void boot_fase_inicio(boot_fase_t fase);
+void boot_fase_fim(boot_fase_t fase);
+bool boot_concluido(void);
+void boot_imprimir(void);
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef DECISAO_H
+#define DECISAO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Lógica de decisão do laço principal (filtro do ultrassônico, cancela,
+// buzzers, LED e ocupação) sem nenhum acesso a hardware: recebe as leituras
+// de um ciclo e devolve o nível de cada atuador. O tempo vem só da entrada,
+// então o mesmo código roda na placa e no replay de traces no PC.
+
+// ================= LIMITES =================
+// Cancela: FECHAR = carro estacionado ou saiu de vez; ABRIR = zona de "Atenção"
+#define LIMITE_FECHAR_MM 150
+#define LIMITE_ABRIR_MM  600
+
+// Buzzer / ocupação
+#define ZONA_LIVRE_MM    800
+#define ZONA_PARADO_MM   150
+
+#define DECISAO_SEM_LEITURA 9999
+
+// Espera antes de baixar a cancela (o carro termina o movimento)
+#define DECISAO_FECHAR_ATRASO_US (300 * 1000)
+
+// ================= TIPOS =================
+typedef struct {
+    uint64_t t_us;           // Instante do ciclo (monotônico)
+    uint16_t d1_mm;          // Laser (vaga 1), SENSOR_SEM_ALVO sem alvo
+    uint16_t d2_mm;          // Ultrassônico (vaga 2), bruto
+    bool d2_nova;            // Eco novo neste ciclo
+    bool localizar[2];       // Pedidos de localização recebidos desde o ciclo anterior
+    // Só para medir latência (não influenciam a decisão nem vão para o trace)
+    uint64_t d1_t_us;        // Aquisição da leitura d1
+    uint64_t d2_t_us;        // Aquisição da leitura d2
+    uint64_t localizar_us;   // Chegada do primeiro pedido de localização pendente
+} decisao_entrada_t;
+
+typedef struct {
+    uint8_t servo_graus;     // 0 = cancela baixa, 90 = levantada
+    bool led_vermelho;
+    bool led_verde;
+    bool buzzer_manobra;
+    bool buzzer_localizar;
+    bool vaga_ocupada[2];
+    uint16_t d1_mm;          // Distâncias usadas na decisão (d2 já filtrada)
+    uint16_t d2_mm;
+    uint64_t d1_t_us;        // Aquisição da amostra por trás de cada distância
+    uint64_t d2_t_us;
+    // Origem (amostra ou pedido) das ações tomadas neste ciclo; 0 = nenhuma
+    uint64_t origem_abrir_us;
+    uint64_t origem_fechar_us;
+    uint64_t origem_beep_us;       // Primeiro beep após entrar na zona de manobra
+    uint64_t origem_localizar_us;  // Primeiro beep de localização
+} decisao_saida_t;
+
+typedef struct {
+    // Filtro de confirmação do ultrassônico
+    uint16_t d2_estavel;
+    uint8_t leituras_divergentes;
+    uint64_t d2_estavel_us;         // Primeira leitura da mudança aceita pelo filtro
+    uint64_t d2_divergente_us;
+    // Localização
+    uint8_t localizar_beeps;
+    uint64_t localizar_ultimo_us;
+    uint64_t localizar_origem_us;   // Pedido ainda sem beep (0 = nenhum)
+    // Cancela
+    bool cancela_aberta;
+    bool fechando;
+    uint64_t fechar_em_us;
+    uint64_t fechar_origem_us;
+    // Buzzer de manobra
+    bool beep_on;
+    uint64_t ultimo_beep_us;
+    bool zona_manobra;
+    uint64_t beep_origem_us;        // Entrada na zona ainda sem beep (0 = nenhuma)
+
+    decisao_saida_t saida;
+} decisao_t;
+
+// Estado serializado (tamanho fixo, little-endian) para o trace; os campos
+// que só servem à medição de latência ficam de fora
+#define DECISAO_ESTADO_BYTES 40
+
+// ================= API =================
+void decisao_init(decisao_t *d);
+const decisao_saida_t *decisao_passo(decisao_t *d, const decisao_entrada_t *e);
+
+void decisao_exportar(const decisao_t *d, uint8_t buf[DECISAO_ESTADO_BYTES]);
+void decisao_importar(decisao_t *d, const uint8_t buf[DECISAO_ESTADO_BYTES]);
+
+#endif
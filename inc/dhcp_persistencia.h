@@ -0,0 +1,43 @@
+#ifndef DHCP_PERSISTENCIA_H
+#define DHCP_PERSISTENCIA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "dhcp_lease.h"
+
+// Cópia dos leases ativos do DHCP na flash (FLASH_STORE_DHCP_OFFSET), para
+// que depois de um reset o celular que pede o endereço antigo (INIT-REBOOT)
+// receba ACK na hora e nenhum cliente novo ganhe um endereço ainda em uso.
+// Cada cópia ocupa um slot de páginas inteiras; os slots são gravados em
+// sequência e o setor é apagado ao entrar nele. No boot vale a cópia íntegra
+// de maior seq.
+
+// ================= CONFIGURAÇÃO =================
+// 0 = tabela começa vazia a cada boot (para comparar a reconexão)
+#ifndef DHCP_PERSISTENCIA
+#define DHCP_PERSISTENCIA 1
+#endif
+
+// Depois de uma mudança espera mais mudanças (vários celulares entrando juntos)
+#define DHCP_PERSISTENCIA_ESPERA_MS      5000
+// Intervalo mínimo entre gravações (desgaste da flash)
+#define DHCP_PERSISTENCIA_INTERVALO_MS   30000
+
+typedef struct {
+    uint32_t gravacoes;
+    uint32_t falhas;
+    uint16_t restaurados;        // Leases recriados no boot
+    uint32_t seq;                // Cópia atual na flash
+    uint32_t gravacao_us;        // Última gravação (apagamento incluído)
+} dhcp_persistencia_stats_t;
+
+// ================= API =================
+// Restaura a tabela (recém-criada por dhcp_server_init) e passa a acompanhá-la
+void dhcp_persistencia_init(dhcp_lease_tabela_t *t);
+
+// Grava a tabela se ela mudou, respeitando os intervalos; chamar a cada volta do laço
+void dhcp_persistencia_tarefa(void);
+
+const dhcp_persistencia_stats_t *dhcp_persistencia_get_stats(void);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef ESTATISTICAS_H
+#define ESTATISTICAS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Agregados de ocupação por vaga, atualizados só nas transições (O(1)).
+// A memória é fixa: médias incrementais + anel de baldes por hora.
+
+// ================= CONFIGURAÇÃO =================
+#define ESTAT_VAGAS 2
+#define ESTAT_HORAS 24
+
+// Média/variância incrementais (Welford) + extremos
+typedef struct {
+    uint32_t n;
+    double media;
+    double m2;
+    uint32_t min;
+    uint32_t max;
+} estat_welford_t;
+
+typedef struct {
+    uint32_t hora;           // Hora desde o boot a que o balde se refere
+    uint32_t ocupado_ms;
+    uint16_t chegadas;
+} estat_hora_t;
+
+typedef struct {
+    bool ocupada;
+    bool inicio_conhecido;      // false até a primeira transição (início real desconhecido)
+    int64_t desde_us;           // Início do estado atual (negativo = antes deste boot)
+    uint64_t contabilizado_us;  // Tempo ocupado já distribuído nos baldes até aqui
+    estat_welford_t permanencia; // Duração das ocupações (ms)
+    estat_welford_t vacancia;    // Tempo livre entre uma saída e a próxima chegada (ms)
+    estat_hora_t horas[ESTAT_HORAS];
+} estat_vaga_t;
+
+// ================= API =================
+void estatisticas_init(uint8_t vaga, bool ocupada, uint32_t tempo_ocupada_ms);
+void estatisticas_transicao(uint8_t vaga, bool ocupada, uint64_t t_us);
+int estatisticas_json(char *buf, size_t len);
+
+#endif
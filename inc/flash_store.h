@@ -0,0 +1,28 @@
+#ifndef FLASH_STORE_H
+#define FLASH_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hardware/flash.h"
+
+// ================= MAPA DA FLASH =================
+// Setores reservados no fim da flash, fora da área do programa.
+#define FLASH_STORE_CALIBRACAO_OFFSET (PICO_FLASH_SIZE_BYTES - 1 * FLASH_SECTOR_SIZE)
+
+// Log de eventos/estado das vagas: setores usados em rodízio (wear leveling)
+#define FLASH_STORE_LOG_SETORES       16
+#define FLASH_STORE_LOG_OFFSET        (FLASH_STORE_CALIBRACAO_OFFSET - FLASH_STORE_LOG_SETORES * FLASH_SECTOR_SIZE)
+
+// Leases do servidor DHCP: cópias da tabela gravadas em sequência, setores em rodízio
+#define FLASH_STORE_DHCP_SETORES      4
+#define FLASH_STORE_DHCP_OFFSET       (FLASH_STORE_LOG_OFFSET - FLASH_STORE_DHCP_SETORES * FLASH_SECTOR_SIZE)
+
+// ================= API =================
+const uint8_t *flash_store_ptr(uint32_t offset);
+bool flash_store_write_sector(uint32_t offset, const void *data, size_t len);
+bool flash_store_erase_sector(uint32_t offset);
+bool flash_store_program_page(uint32_t offset, const void *data);
+uint32_t flash_store_crc32(const void *data, size_t len);
+
+#endif
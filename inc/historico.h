@@ -0,0 +1,46 @@
+#ifndef HISTORICO_H
+#define HISTORICO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// ================= CONFIGURAÇÃO =================
+// Potência de 2: o índice no anel é seq & (CAPACIDADE - 1)
+#define HISTORICO_CAPACIDADE 256
+
+// Distâncias a partir daqui são "sem alvo" e não entram no mínimo/máximo
+#define HISTORICO_SEM_LEITURA 9999
+
+typedef enum {
+    EVENTO_CHEGADA = 0,
+    EVENTO_SAIDA
+} evento_tipo_t;
+
+// Evento compacto (16 bytes). Mínimo e máximo são da distância observada
+// desde o evento anterior da mesma vaga (a manobra de chegada ou a permanência).
+typedef struct {
+    uint32_t seq;           // Começa em 1 e nunca se repete
+    uint32_t t_ms;          // ms desde o boot indicado em 'boot' (monotônico)
+    uint16_t dist_min_mm;
+    uint16_t dist_max_mm;
+    uint8_t vaga;
+    uint8_t tipo;           // evento_tipo_t
+    uint8_t boot;           // Contador de boots (mod 256), vindo do log na flash
+    uint8_t reservado;
+} evento_t;
+
+// ================= API =================
+void historico_observar(uint8_t vaga, uint16_t distancia_mm);
+const evento_t *historico_registrar(uint8_t vaga, evento_tipo_t tipo, uint64_t t_us);
+
+// Recuperação após reset: eventos do log entram no anel com o seq original
+void historico_set_boot(uint8_t boot);
+uint8_t historico_boot(void);
+void historico_restaurar(const evento_t *evento);
+void historico_continuar(uint32_t ultimo_seq);
+
+uint32_t historico_ultimo_seq(void);
+uint32_t historico_primeiro_seq(void);
+bool historico_ler(uint32_t seq, evento_t *evento);
+
+#endif
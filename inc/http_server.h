@@ -1,6 +1,25 @@
 #ifndef HTTP_SERVER_H
 #define HTTP_SERVER_H
 
+// ================= CONFIGURAÇÃO =================
+// Sondas de conectividade do sistema do celular (Android, Apple, Windows,
+// Firefox), que chegam aqui porque o DNS resolve tudo para o AP:
+// 1 = redireciona para o painel (o sistema abre a página como portal cativo)
+// 0 = responde o esperado pelo sistema ("sem portal", a rede fica como está)
+#ifndef HTTP_PORTAL_CATIVO
+#define HTTP_PORTAL_CATIVO 1
+#endif
+
+// Admissão: excesso recebe RST no accept, antes de ocupar buffers
+#define HTTP_MAX_CONEXOES         6    // Abertas ao mesmo tempo (< MEMP_NUM_TCP_PCB)
+#define HTTP_MAX_CONEXOES_POR_IP  3
+#define HTTP_CONEXOES_POR_S       4    // Balde de fichas por IP: reposição...
+#define HTTP_RAJADA               8    // ...e capacidade
+#define HTTP_BALDES_IP            16   // IPs acompanhados (sai o mais antigo)
+#define HTTP_OCIOSA_S             10   // Sem tráfego por este tempo: conexão abortada
+#define HTTP_POLL_INTERVALO       2    // tcp_poll em ticks de 500 ms
+#define HTTP_MAX_STREAMS          4    // /history, /serie e /metrics enviados em pedaços
+
 void http_server_init(void);
 
 #endif
@@ -0,0 +1,76 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Log adiado: a chamada só copia o ponteiro do formato (literal na flash) e
+// os argumentos em binário para um anel; a formatação e a escrita na CDC USB
+// ficam para log_tarefa(), no fim do laço principal. Nenhuma chamada espera:
+// sem espaço no anel a mensagem é descartada e contada, e log_tarefa() só
+// escreve o que cabe no buffer da CDC naquele momento.
+//
+// Pode ser chamada dos dois núcleos (o core1 loga durante o boot) e de
+// interrupção: a cópia para o anel é feita numa seção crítica curta, que
+// nunca espera por E/S. log_tarefa() roda só no core0.
+//
+// Formatos aceitos: os do printf sem '*' na largura/precisão; %s copia até
+// LOG_TEXTO_MAX caracteres. A mensagem não leva '\n' no fim.
+
+// ================= CONFIGURAÇÃO =================
+#define LOG_NIVEL_NENHUM     0
+#define LOG_NIVEL_ERRO       1
+#define LOG_NIVEL_AVISO      2
+#define LOG_NIVEL_INFO       3
+#define LOG_NIVEL_DEPURACAO  4
+
+// Filtro em tempo de compilação: chamadas acima do nível somem do binário
+#ifndef LOG_NIVEL
+#define LOG_NIVEL LOG_NIVEL_INFO
+#endif
+
+#define LOG_BUFFER_BYTES   2048   // Potência de 2
+#define LOG_REGISTRO_MAX   128    // Cabeçalho + argumentos de uma mensagem
+#define LOG_TEXTO_MAX      32     // Caracteres copiados de cada %s
+#define LOG_LINHA_MAX      192    // Linha formatada na saída
+
+typedef struct {
+    uint32_t gravadas;
+    uint32_t descartadas;        // Anel cheio (saída parada ou lenta)
+    uint32_t escritas;
+    uint32_t truncadas;          // Argumentos além de LOG_REGISTRO_MAX
+    uint32_t ocupacao_max;       // Bytes (marca d'água do anel)
+} log_stats_t;
+
+#if LOG_NIVEL >= LOG_NIVEL_ERRO
+#define LOG_ERRO(...)       log_registrar(LOG_NIVEL_ERRO, __VA_ARGS__)
+#else
+#define LOG_ERRO(...)       do { } while (0)
+#endif
+#if LOG_NIVEL >= LOG_NIVEL_AVISO
+#define LOG_AVISO(...)      log_registrar(LOG_NIVEL_AVISO, __VA_ARGS__)
+#else
+#define LOG_AVISO(...)      do { } while (0)
+#endif
+#if LOG_NIVEL >= LOG_NIVEL_INFO
+#define LOG_INFO(...)       log_registrar(LOG_NIVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...)       do { } while (0)
+#endif
+#if LOG_NIVEL >= LOG_NIVEL_DEPURACAO
+#define LOG_DEPURACAO(...)  log_registrar(LOG_NIVEL_DEPURACAO, __VA_ARGS__)
+#else
+#define LOG_DEPURACAO(...)  do { } while (0)
+#endif
+
+// ================= API =================
+void log_init(void);   // Antes de qualquer mensagem
+void log_registrar(uint8_t nivel, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Formata e envia o que couber na CDC USB; chamar a cada volta do laço
+void log_tarefa(void);
+
+const log_stats_t *log_get_stats(void);
+
+#endif
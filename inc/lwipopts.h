@@ -12,15 +12,24 @@
 #ifndef LWIP_SOCKET
 #define LWIP_SOCKET                 0
 #endif
-#if PICO_CYW43_ARCH_POLL
+#include "memoria.h"
+#if MEMORIA_ESTATICA
+// Heap do lwIP em blocos fixos (lwippools.h). O maior bloco leva um MSS
+// copiado: struct pbuf (16) + cabeçalhos Ethernet/IP/TCP (54) + 1460 = 1530
+#define MEM_LIBC_MALLOC             0
+#define MEM_USE_POOLS               1
+#define MEM_USE_POOLS_TRY_BIGGER_POOL 1
+#define MEMP_USE_CUSTOM_POOLS       1
+#elif PICO_CYW43_ARCH_POLL
 #define MEM_LIBC_MALLOC             1
 #else
 // MEM_LIBC_MALLOC is incompatible with non polling versions
 #define MEM_LIBC_MALLOC             0
 #endif
 #define MEM_ALIGNMENT               4
-#define MEM_SIZE                    4000
+#define MEM_SIZE                    4000    // Só sem MEMORIA_ESTATICA e sem MEM_LIBC_MALLOC
 #define MEMP_NUM_TCP_SEG            32
+#define MEMP_NUM_TCP_PCB            8   // HTTP_MAX_CONEXOES + folga para SYN e TIME_WAIT
 #define MEMP_NUM_ARP_QUEUE          10
 #define PBUF_POOL_SIZE              24
 #define LWIP_ARP                    1
@@ -29,15 +38,19 @@
 #define LWIP_RAW                    1
 #define TCP_WND                     (8 * TCP_MSS)
 #define TCP_MSS                     1460
+#if MEMORIA_ESTATICA
+#define TCP_SND_BUF                 (MEMORIA_SEGMENTOS_POR_CONEXAO * TCP_MSS)
+#else
 #define TCP_SND_BUF                 (8 * TCP_MSS)
+#endif
 #define TCP_SND_QUEUELEN            ((4 * (TCP_SND_BUF) + (TCP_MSS - 1)) / (TCP_MSS))
 #define LWIP_NETIF_STATUS_CALLBACK  1
 #define LWIP_NETIF_LINK_CALLBACK    1
 #define LWIP_NETIF_HOSTNAME         1
 #define LWIP_NETCONN                0
-#define MEM_STATS                   0
+#define MEM_STATS                   0   // Heap do lwIP: pools no MEMP_STATS (MEMORIA_ESTATICA) ou malloc da libc
 #define SYS_STATS                   0
-#define MEMP_STATS                  0
+#define MEMP_STATS                  1   // Uso dos pools exportado em /metrics
 #define LINK_STATS                  0
 // #define ETH_PAD_SIZE                2
 #define LWIP_CHKSUM_ALGORITHM       3
@@ -0,0 +1,31 @@
+// Pools do heap do lwIP no modo MEMORIA_ESTATICA (MEM_USE_POOLS): mem_malloc
+// pega o menor bloco que serve, passando ao tamanho seguinte se ele acabar.
+// Sem guarda de inclusão: o lwIP inclui este arquivo várias vezes (memp_std.h).
+//
+// Quem usa o heap do lwIP aqui (pbufs PBUF_RAM):
+//  - 128:  cabeçalhos de segmentos TCP com dados PBUF_ROM, ACK e RST
+//  - 640:  respostas do DHCP (dhcp_msg_t inteiro), ARP e ICMP
+//  - 1600: dados copiados pelo tcp_write (um MSS + cabeçalhos)
+// O tamanho vai literal no nome do pool (MEMP_POOL_1600); a conta que o
+// justifica está em lwipopts.h.
+
+#include "memoria.h"
+#include "http_server.h"
+
+#if MEM_USE_POOLS
+
+// Cada conexão: segmentos em voo + um ACK/RST pendente; folga para o DHCP/DNS
+#define MEMORIA_LWIP_PEQUENOS  (HTTP_MAX_CONEXOES * (MEMORIA_SEGMENTOS_POR_CONEXAO + 1) + 8)
+#define MEMORIA_LWIP_MEDIOS    4
+// Streams enchem a janela de envio (um pbuf pode ficar meio cheio no fim);
+// as demais conexões mandam um JSON de até dois segmentos
+#define MEMORIA_LWIP_GRANDES   (HTTP_MAX_STREAMS * (MEMORIA_SEGMENTOS_POR_CONEXAO + 1) + \
+                                (HTTP_MAX_CONEXOES - HTTP_MAX_STREAMS) * 2)
+
+LWIP_MALLOC_MEMPOOL_START
+LWIP_MALLOC_MEMPOOL(MEMORIA_LWIP_PEQUENOS, 128)
+LWIP_MALLOC_MEMPOOL(MEMORIA_LWIP_MEDIOS, 640)
+LWIP_MALLOC_MEMPOOL(MEMORIA_LWIP_GRANDES, 1600)
+LWIP_MALLOC_MEMPOOL_END
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef MEMORIA_H
+#define MEMORIA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Memória sem heap: com MEMORIA_ESTATICA o firmware não chama malloc depois
+// do boot. Cada uso tem um pool de tamanho fixo, calculado das quantidades
+// configuradas (displays, conexões e streams HTTP):
+//  - framebuffer do SSD1306 e buffer de envio I2C: vetores estáticos
+//  - conexões e streams HTTP: vetores de http_server.c
+//  - heap do lwIP (mem_malloc): pools de blocos fixos (lwippools.h), sem
+//    fragmentação; memp já era estático
+// Pool cheio vira falha contada, nunca espera nem bloqueia. Ocupação,
+// máximo e falhas de cada pool saem em /metrics (os pools do lwIP pelo
+// MEMP_STATS), junto com o heap da libc que sobrou para o SDK.
+//
+// Este arquivo é incluído por lwipopts.h: só macros e tipos simples.
+
+// ================= CONFIGURAÇÃO =================
+// 0 = heap como antes (calloc/malloc no display, MEM_LIBC_MALLOC no lwIP),
+// para comparar a folga de memória
+#ifndef MEMORIA_ESTATICA
+#define MEMORIA_ESTATICA 1
+#endif
+
+#define MEMORIA_DISPLAYS              1   // Framebuffers do SSD1306
+// Segmentos TCP de dados em voo por conexão (TCP_SND_BUF em MSS); limita
+// os pbufs copiados que cada stream HTTP prende no pool grande
+#define MEMORIA_SEGMENTOS_POR_CONEXAO 3
+
+typedef enum {
+    MEMORIA_FRAMEBUFFER = 0,
+    MEMORIA_HTTP_CONEXAO,
+    MEMORIA_HTTP_STREAM,
+    MEMORIA_POOLS
+} memoria_pool_id_t;
+
+typedef struct {
+    uint16_t total;
+    uint16_t usados;
+    uint16_t max;                // Marca d'água
+    uint32_t falhas;             // Pedidos com o pool cheio
+} memoria_pool_t;
+
+// ================= API =================
+// Cada pool é usado por um só núcleo (o framebuffer no boot do core1, o
+// HTTP no core0), então os contadores não precisam de trava.
+void memoria_definir(memoria_pool_id_t id, uint16_t total);
+void memoria_ocupar(memoria_pool_id_t id);
+void memoria_liberar(memoria_pool_id_t id);
+void memoria_falha(memoria_pool_id_t id);
+
+const memoria_pool_t *memoria_get(memoria_pool_id_t id);
+const char *memoria_nome(memoria_pool_id_t id);
+
+// Heap da libc: bytes em uso e área já tomada do sistema (só cresce, então
+// é o máximo desde o boot)
+size_t memoria_heap_usado(void);
+size_t memoria_heap_max(void);
+
+#endif
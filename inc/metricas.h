@@ -0,0 +1,86 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "rastro.h"
+
+// Instrumentação das etapas do laço: contagem, soma, máximo e histograma
+// em baldes log2 do tempo de cada etapa (timer de 1 MHz do RP2040; o M0+
+// não tem contador de ciclos). Exportado em texto Prometheus por /metrics.
+//
+//   METRICA_INICIO(poll);
+//   cyw43_arch_poll();
+//   METRICA_FIM(poll, ETAPA_CYW43_POLL);
+//
+// Latência de ponta a ponta: cada ação nos atuadores traz o instante da
+// amostra (ou do pedido HTTP) que a originou; a diferença até a execução vai
+// para um histograma por atuador.
+//
+// Cada etapa medida também vai como bloco para o rastro de eventos
+// (rastro.h). Com METRICAS_ATIVAS=0 e RASTRO_ATIVO=0 as macros somem.
+
+// ================= CONFIGURAÇÃO =================
+#ifndef METRICAS_ATIVAS
+#define METRICAS_ATIVAS 1
+#endif
+
+// Balde k: 2^(k-1) <= us < 2^k (o balde 0 guarda 0 us; o último, >= 4.2 s)
+#define METRICAS_BALDES 24
+
+typedef enum {
+    ETAPA_LACO = 0,          // Uma volta do laço principal (sem o sleep)
+    ETAPA_CYW43_POLL,        // Wi-Fi + lwIP, inclui os callbacks HTTP
+    ETAPA_HTTP,              // Tratamento de uma requisição
+    ETAPA_VL53L0X,           // Consulta ao sensor no ciclo de aquisição (I2C)
+    ETAPA_ULTRASSONICO,      // Interrupção de slot do ultrassônico
+    ETAPA_DECISAO,           // Decisão + atuadores + registro das transições
+    ETAPA_DISPLAY,           // Desenho e envio do framebuffer (I2C)
+    ETAPA_PERSISTENCIA,      // Tarefa do log na flash (inclui commits)
+    METRICAS_ETAPAS
+} metricas_etapa_t;
+
+typedef enum {
+    LATENCIA_CANCELA_ABRIR = 0,  // Amostra na zona de atenção -> servo em 90
+    LATENCIA_CANCELA_FECHAR,     // Amostra de fechamento -> servo em 0 (inclui o atraso proposital)
+    LATENCIA_BEEP_MANOBRA,       // Entrada na zona de manobra -> primeiro beep
+    LATENCIA_BEEP_LOCALIZAR,     // Pedido /localizarN -> primeiro beep
+    LATENCIA_HTTP_ESTADO,        // Amostra da transição -> primeiro /status que a mostra
+    METRICAS_LATENCIAS
+} metricas_latencia_t;
+
+typedef struct {
+    uint32_t n;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint32_t baldes[METRICAS_BALDES];
+} metricas_histograma_t;
+
+#if METRICAS_ATIVAS || RASTRO_ATIVO
+#include "hardware/timer.h"
+#define METRICA_INICIO(nome)        uint32_t _metrica_##nome = time_us_32()
+#define METRICA_FIM(nome, etapa)    metricas_etapa((etapa), _metrica_##nome)
+#else
+#define METRICA_INICIO(nome)        do { } while (0)
+#define METRICA_FIM(nome, etapa)    do { } while (0)
+#endif
+
+// ================= API =================
+void metricas_registrar(metricas_etapa_t etapa, uint32_t us);
+void metricas_etapa(metricas_etapa_t etapa, uint32_t inicio_us);   // Fim de METRICA_INICIO
+const metricas_histograma_t *metricas_get(metricas_etapa_t etapa);
+
+// origem_us = 0 é ignorada (ação sem origem conhecida)
+void metricas_latencia(metricas_latencia_t l, uint64_t origem_us);
+// Para ações que só se concluem depois (ex.: o próximo /status): guarda a
+// origem mais antiga ainda pendente e registra ao concluir
+void metricas_latencia_pendente(metricas_latencia_t l, uint64_t origem_us);
+void metricas_latencia_concluir(metricas_latencia_t l);
+const metricas_histograma_t *metricas_get_latencia(metricas_latencia_t l);
+
+// Texto Prometheus linha a linha (para envio em pedaços): escreve a linha
+// 'indice' com '\n' e retorna o tamanho, ou -1 depois da última
+int metricas_linha(uint32_t indice, char *buf, size_t len);
+
+#endif
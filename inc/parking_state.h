@@ -3,10 +3,15 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "pico/time.h"
 
+// Início e fim da ocupação em tempo monotônico: a permanência é calculada
+// na consulta e não depende da duração de cada volta do laço principal.
 typedef struct {
     bool ocupada;
-    uint32_t tempo_ocupada_ms;
+    absolute_time_t ocupada_desde;
+    absolute_time_t liberada_em;
+    uint32_t tempo_anterior_ms;     // Permanência herdada de antes de um reset
 } vaga_status_t;
 
 extern vaga_status_t vaga1_status;
@@ -15,5 +20,11 @@ extern vaga_status_t vaga2_status;
 // parking_state.h - Adicione esta linha no final da struct ou como extern
 extern bool localizar_vaga1;
 extern bool localizar_vaga2;
+extern uint64_t localizar_pedido_us;    // Chegada do primeiro pedido pendente (latência)
+
+void vaga_init(vaga_status_t *vaga);
+bool vaga_atualizar(vaga_status_t *vaga, bool ocupada, absolute_time_t agora);
+uint32_t vaga_tempo_ocupada_ms(const vaga_status_t *vaga);
+void vaga_restaurar(vaga_status_t *vaga, bool ocupada, uint32_t tempo_ocupada_ms);
 
 #endif
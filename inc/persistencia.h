@@ -0,0 +1,39 @@
+#ifndef PERSISTENCIA_H
+#define PERSISTENCIA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "historico.h"
+
+// Log estruturado na flash (FLASH_STORE_LOG_OFFSET): cada página de 256 bytes
+// é um registro com seq, CRC, o estado das vagas e até 14 eventos. As páginas
+// são gravadas em sequência e os setores apagados em rodízio.
+
+// ================= CONFIGURAÇÃO =================
+// Tempo máximo que um evento espera na RAM antes de ser gravado
+#ifndef PERSISTENCIA_COMMIT_MS
+#define PERSISTENCIA_COMMIT_MS 30000
+#endif
+
+typedef struct {
+    uint32_t paginas_gravadas;
+    uint32_t setores_apagados;
+    uint32_t eventos_gravados;
+    uint32_t bytes_eventos;      // Bytes úteis (eventos) enviados à flash
+    uint32_t bytes_flash;        // Bytes realmente programados
+    uint32_t commit_us;          // Último commit (programação + apagamento, se houve)
+    uint32_t commit_max_us;
+    uint32_t recuperacao_us;     // Varredura + restauração no boot
+    uint32_t paginas_lidas;      // Páginas examinadas na recuperação
+    uint32_t falhas;
+    uint32_t eventos_perdidos;   // Descartados com o lote cheio e a flash falhando
+    uint16_t boot;
+} persistencia_stats_t;
+
+// ================= API =================
+void persistencia_init(void);
+void persistencia_evento(const evento_t *evento);
+void persistencia_tarefa(void);
+const persistencia_stats_t *persistencia_get_stats(void);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef RASTRO_H
+#define RASTRO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Rastro de eventos (registro de voo): anel fixo de entradas binárias (instante, id, argumento)
+// para ver o escalonamento do laço (etapas, interrupções, TCP, I2C e o tick
+// de aquisição). Grava sempre, sobrescrevendo os mais antigos; /rastro
+// congela o anel e o despeja na CDC USB em quadros do trace (trace.h).
+// No PC, tools/rastro_chrome.py converte a captura para o formato JSON do
+// Chrome trace / Perfetto.
+//
+// Entrada (8 bytes, little-endian): u32 t_us (32 bits baixos), u32 id << 24 | arg
+//
+// Quadros do despejo:
+//   TRACE_RASTRO_INICIO: u8 versão, u16 entradas, u32 sobrescritas, u64 t_us do congelamento
+//   TRACE_RASTRO:        u16 índice da primeira entrada, até RASTRO_POR_QUADRO entradas
+
+// ================= CONFIGURAÇÃO =================
+#ifndef RASTRO_ATIVO
+#define RASTRO_ATIVO 1
+#endif
+
+#define RASTRO_CAPACIDADE  2048   // Potência de 2 (16 KB): alguns segundos do laço
+#define RASTRO_VERSAO      1
+#define RASTRO_POR_QUADRO  7      // Um quadro por pacote de 64 bytes da CDC
+#define RASTRO_ARG_MAX     0xFFFFFF
+
+// Tipo de cada id (usado pelo conversor):
+//   bloco = arg é a duração em us, o instante é o início
+//   início/fim = par aberto/fechado; instante = ponto
+typedef enum {
+    RASTRO_AQUISICAO_INICIO = 0x01,  // início:  arg = atraso do canal mais atrasado (us)
+    RASTRO_AQUISICAO_FIM,            // fim:     arg = máscara de canais com amostra nova
+    RASTRO_TCP_ACEITE,               // instante: arg = porta remota
+    RASTRO_TCP_FECHA,                // instante: arg = porta remota
+    RASTRO_I2C_INICIO,               // início:  arg = endereço | bytes << 8
+    RASTRO_I2C_FIM,                  // fim:     arg = endereço
+    RASTRO_ETAPA = 0x10              // bloco:   id = RASTRO_ETAPA + metricas_etapa_t
+} rastro_id_t;
+
+typedef struct {
+    uint32_t t_us;
+    uint32_t id_arg;
+} rastro_entrada_t;
+
+#if RASTRO_ATIVO
+#include "hardware/timer.h"
+#define RASTRO(id, arg)     rastro_registrar((id), time_us_32(), (arg))
+#else
+#define RASTRO(id, arg)     do { (void)(id); (void)(arg); } while (0)
+#endif
+
+// ================= API =================
+void rastro_init(void);
+// Pode ser chamada de interrupção e dos dois núcleos; arg acima de RASTRO_ARG_MAX é saturado
+void rastro_registrar(uint8_t id, uint32_t t_us, uint32_t arg);
+
+// Congela o anel e agenda o despejo; false se já há um em andamento
+bool rastro_despejar(void);
+bool rastro_despejando(void);
+// Retira quadros inteiros (até 'max' bytes) do despejo; ao terminar, volta a gravar
+size_t rastro_ler(uint8_t *buf, size_t max);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef RELOGIO_H
+#define RELOGIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/time.h"
+
+// Relógio de parede sem SNTP: o primeiro cliente que abre a página informa
+// a hora (epoch em ms) e o firmware guarda só o deslocamento em relação ao
+// tempo monotônico. Os timestamps internos continuam monotônicos.
+
+// ================= API =================
+bool relogio_definir(uint64_t epoch_ms);
+bool relogio_definido(void);
+uint64_t relogio_epoch_ms(absolute_time_t instante);
+
+#endif
@@ -9,6 +9,45 @@
 #define SDA_SENSOR 0
 #define SCL_SENSOR 1
 
+// O VL53L0X suporta I2C fast mode
+#define SENSOR_I2C_HZ (400 * 1000)
+
+// Tempo máximo para o VL53L0X responder após o power-on
+#define SENSOR_BOOT_TIMEOUT_MS 50
+
+// Vários VL53L0X no mesmo I2C0: cada um tem um pino XSHUT próprio e recebe
+// um endereço a partir de SENSOR_ENDERECO_BASE durante a inicialização.
+#define SENSOR_MAX_VL53L0X   8
+#define SENSOR_ENDERECO_BASE 0x30
+
+// Agendamento da medição contínua entre os sensores do barramento
+typedef enum {
+    SENSOR_AGENDA_PARALELO,    // Todos medem back-to-back; taxa agregada cresce com N
+    SENSOR_AGENDA_INTERCALADO  // Emissores partem defasados (menos crosstalk); taxa agregada ~1/budget
+} sensor_agenda_t;
+
+// Abaixo desta taxa de sinal a medida é tratada como ausência de alvo
+#define SENSOR_SINAL_MIN_MCPS 0.10f
+#define SENSOR_SEM_ALVO 65535
+// Alvo colado ao sensor, abaixo do alcance mínimo (conta como vaga ocupada)
+#define SENSOR_ALVO_MINIMO 0
+
+// Pino GPIO1 do VL53L0X (interrupção, ativo em nível baixo).
+// Com -1 o firmware consulta RESULT_INTERRUPT_STATUS via I2C a cada tick.
+#ifndef SENSOR_INT_PIN
+#define SENSOR_INT_PIN -1
+#endif
+
+// 1 = reaproveita a calibração de SPAD/referência salva na flash
+#ifndef SENSOR_CACHE_CALIBRACAO
+#define SENSOR_CACHE_CALIBRACAO 1
+#endif
+
+// 1 = mede taxa e jitter de cada perfil do VL53L0X na inicialização (diagnóstico)
+#ifndef SENSOR_BENCH_PERFIS
+#define SENSOR_BENCH_PERFIS 0
+#endif
+
 // Buzzer PWM correto (BitDogLab -> BUZZER B = GPIO10)
 #define BUZZER_PWM 10
 
@@ -16,9 +55,50 @@
 #define LED_VERDE 11
 #define LED_VERMELHO 13
 
+// Contadores de atividade do sensor (para comparar modo limiar x amostra contínua)
+typedef struct {
+    uint32_t wakeups;        // Ticks em que o laço precisou falar com o sensor
+    uint32_t amostras;       // Amostras efetivamente lidas
+    uint32_t trocas_modo;    // Reprogramações da interrupção
+    uint32_t descartadas;    // Amostras com falha de status, ignoradas
+    uint32_t leitura_bytes;  // Bytes I2C gastos nas amostras lidas
+    uint32_t leitura_us;     // Tempo total de I2C nas amostras lidas
+    uint32_t leitura_max_us;
+    uint32_t init_us;        // Duração de vl53l0x_init()
+    uint32_t init_transacoes;
+    bool calibracao_cache;   // Init usou a calibração salva na flash
+    uint64_t primeira_leitura_us; // Tempo desde o boot até a primeira distância válida
+} sensor_stats_t;
+
+// Resultado da medição de taxa/jitter de um perfil
+typedef struct {
+    vl53l0x_profile perfil;
+    uint32_t budget_us;
+    uint32_t amostras;
+    float taxa_hz;
+    uint32_t intervalo_medio_us;
+    uint32_t intervalo_min_us;
+    uint32_t intervalo_max_us;
+    uint32_t jitter_us;      // Desvio padrão do intervalo entre amostras
+} sensor_perfil_medida_t;
+
 void sensor_init(vl53l0x_dev *sensor_dev);
+bool sensor_init_multi(vl53l0x_dev *devs, const uint8_t *xshut_pins, uint8_t n, sensor_agenda_t agenda);
+void sensor_commit_calibration(void);
 uint16_t sensor_read_distance(vl53l0x_dev *sensor_dev);
 
+// Zona de atenção: fora dela o sensor só acorda o MCU ao cruzar os limites
+void sensor_set_attention_zone(vl53l0x_dev *sensor_dev, uint16_t parado_mm, uint16_t livre_mm);
+bool sensor_poll_distance(vl53l0x_dev *sensor_dev, uint16_t *distancia_mm);
+bool sensor_poll_next(vl53l0x_dev *devs, uint8_t n, uint8_t *indice, uint16_t *distancia_mm);
+const sensor_stats_t *sensor_get_stats(void);
+
+// Perfis de medição (troca em tempo de execução)
+bool sensor_set_profile(vl53l0x_dev *sensor_dev, vl53l0x_profile perfil);
+bool sensor_measure_profile(vl53l0x_dev *sensor_dev, vl53l0x_profile perfil,
+                            uint32_t n_amostras, sensor_perfil_medida_t *medida);
+float sensor_measure_bus(vl53l0x_dev *devs, uint8_t n, uint32_t duracao_ms);
+
 // Controle do buzzer
 void buzzer_pwm(uint16_t freq, float duty);
 void buzzer_off(void);
@@ -1,13 +1,47 @@
 #ifndef SENSOR_ULTRASONICO_H
 #define SENSOR_ULTRASONICO_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 // ================= CONFIGURAÇÃO =================
 #define TRIG_PIN 18
 #define ECHO_PIN 19
 
+// Uma state machine por canal, todas no mesmo bloco PIO
+#define ULTRASONICO_MAX_CANAIS 4
+
+// Janela de cada disparo: sem alvo o ECHO do HC-SR04 fica alto por ~38 ms,
+// o que também cobre a reverberação de um eco de ~5 m
+#ifndef ULTRASONICO_SLOT_MS
+#define ULTRASONICO_SLOT_MS 40
+#endif
+
+// Canais disparados juntos são os de mesmo (índice % GRUPOS): vizinhos nunca
+// compartilham janela. Com GRUPOS = número de canais o disparo é sequencial.
+#ifndef ULTRASONICO_GRUPOS
+#define ULTRASONICO_GRUPOS 2
+#endif
+
+typedef struct {
+    uint8_t trig;
+    uint8_t echo;
+} ultrasonico_pinos_t;
+
 // ================= API =================
 void sensor_ultrasonico_init(void);
+uint8_t sensor_ultrasonico_init_multi(const ultrasonico_pinos_t *pinos, uint8_t n);
 float sensor_ultrasonico_ler_distancia_cm(void);
 
+// Última medida de um canal; true só quando há medida nova desde a última consulta
+bool sensor_ultrasonico_resultado(uint8_t canal, float *distancia_cm);
+bool sensor_ultrasonico_pendente(uint8_t canal);
+
+// Taxa máxima de atualização de cada canal com o agendamento configurado
+float sensor_ultrasonico_taxa_canal_hz(void);
+
+// Amostragem adaptativa: espaça os disparos de um canal
+void sensor_ultrasonico_set_intervalo(uint8_t canal, uint32_t intervalo_ms);
+uint32_t sensor_ultrasonico_disparos(uint8_t canal);
+
 #endif
-    
\ No newline at end of file
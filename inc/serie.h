@@ -0,0 +1,64 @@
+#ifndef SERIE_H
+#define SERIE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Séries temporais das distâncias brutas, no estilo RRD: por canal, um anel
+// com a taxa cheia e dois anéis de min/média/máx (1 s e 1 min). A memória é
+// fixa (~4 KB por canal) e o mais antigo é sobrescrito.
+//
+// Exportação binária (GET /serie), todos os inteiros em varint LEB128:
+//   u8 versão (1), u8 canal, u8 resolução (serie_resolucao_t)
+//   n    = número de pontos
+//   t0   = bruta: ms desde o boot da 1ª amostra; agregados: índice do
+//          1º período (s ou min desde o boot), um ponto por período
+//   pontos, cada valor como zig-zag da diferença para o ponto anterior
+//   (o 1º relativo a 0):
+//     bruta:     Δt_ms (sem zig-zag, sempre >= 0), Δmm
+//     agregados: Δmin, Δmédia, Δmáx
+// SERIE_SEM_DADO marca amostra sem alvo ou período sem leitura.
+
+// ================= CONFIGURAÇÃO =================
+#define SERIE_CANAIS   2     // Canais de aquisição guardados (índices 0..N-1)
+#define SERIE_BRUTA_N  256   // Amostras na taxa cheia
+#define SERIE_SEG_N    300   // 5 min em 1 s
+#define SERIE_MIN_N    120   // 2 h em 1 min
+
+#define SERIE_SEM_DADO 0xFFFF
+
+typedef enum {
+    SERIE_BRUTA = 0,
+    SERIE_1S,
+    SERIE_1MIN,
+    SERIE_RESOLUCOES
+} serie_resolucao_t;
+
+typedef struct {
+    uint16_t min;
+    uint16_t media;
+    uint16_t max;
+} serie_ponto_t;
+
+// Estado de uma exportação em andamento: o envio pode ser dividido em
+// quantos pedaços forem necessários (um por tcp_sent).
+typedef struct {
+    uint8_t canal;
+    uint8_t resolucao;
+    bool cabecalho_enviado;
+    uint32_t proximo;        // Índice absoluto do próximo ponto
+    uint32_t fim;            // Um após o último ponto a enviar
+    uint32_t t_anterior;
+    uint16_t anterior[3];
+} serie_cursor_t;
+
+// ================= API =================
+// mm == SENSOR_SEM_ALVO entra na bruta como SERIE_SEM_DADO e fica fora dos agregados
+void serie_registrar(uint8_t canal, uint16_t distancia_mm, uint64_t t_us);
+
+bool serie_exportar_iniciar(serie_cursor_t *cursor, uint8_t canal, serie_resolucao_t resolucao);
+size_t serie_exportar(serie_cursor_t *cursor, uint8_t *buf, size_t len);
+bool serie_exportar_fim(const serie_cursor_t *cursor);
+
+#endif
@@ -7,6 +7,8 @@
 #include "hardware/i2c.h"
 #include "ssd1306_font.h"
 #include "ssd1306_i2c.h"
+#include "rastro.h"
+#include "memoria.h"
 
 // Calcular quanto do buffer será destinado à área de renderização
 void calculate_render_area_buffer_length(struct render_area *area) {
@@ -26,6 +28,26 @@ void ssd1306_send_command_list(uint8_t *ssd, int number) {
     }
 }
 
+#if MEMORIA_ESTATICA
+// Um framebuffer por display, com o byte de controle na frente
+static uint8_t framebuffers[MEMORIA_DISPLAYS][ssd1306_buffer_length + 1];
+static uint8_t framebuffers_usados = 0;
+
+// Buffer de envio fixo: área maior que ele vai em mais de uma escrita, cada
+// uma com seu byte de controle (o ponteiro da GDDRAM segue avançando)
+static uint8_t envio[ssd1306_buffer_length + 1];
+
+void ssd1306_send_buffer(uint8_t ssd[], int buffer_length) {
+    envio[0] = 0x40;
+    while (buffer_length > 0) {
+        int n = buffer_length < ssd1306_buffer_length ? buffer_length : ssd1306_buffer_length;
+        memcpy(envio + 1, ssd, n);
+        i2c_write_blocking(i2c1, ssd1306_i2c_address, envio, n + 1, false);
+        ssd += n;
+        buffer_length -= n;
+    }
+}
+#else
 // Copia buffer de referência num novo buffer, a fim de adicionar o byte de controle desde o início
 void ssd1306_send_buffer(uint8_t ssd[], int buffer_length) {
     uint8_t *temp_buffer = malloc(buffer_length + 1);
@@ -37,6 +59,7 @@ void ssd1306_send_buffer(uint8_t ssd[], int buffer_length) {
 
     free(temp_buffer);
 }
+#endif
 
 // Cria a lista de comandos (com base nos endereços definidos em ssd1306_i2c.h) para a inicialização do display
 void ssd1306_init() {
@@ -177,8 +200,10 @@ void ssd1306_draw_string(uint8_t *ssd, int16_t x, int16_t y, char *string) {
 // Comando de configuração com base na estrutura ssd1306_t
 void ssd1306_command(ssd1306_t *ssd, uint8_t command) {
   ssd->port_buffer[1] = command;
+  RASTRO(RASTRO_I2C_INICIO, ssd->address | (2 << 8));
   i2c_write_blocking(
 	ssd->i2c_port, ssd->address, ssd->port_buffer, 2, false );
+  RASTRO(RASTRO_I2C_FIM, ssd->address);
 }
 
 // Função de configuração do display para o caso do bitmap
@@ -218,25 +243,43 @@ void ssd1306_init_bm(ssd1306_t *ssd, uint8_t width, uint8_t height, bool externa
     ssd->address = address;
     ssd->i2c_port = i2c;
     ssd->bufsize = ssd->pages * ssd->width + 1;
+    ssd->port_buffer[0] = 0x80;
+#if MEMORIA_ESTATICA
+    // Sem framebuffer (mais displays ou maior que o configurado) o display
+    // fica desligado: ram_buffer NULL e a falha aparece em /metrics
+    memoria_definir(MEMORIA_FRAMEBUFFER, MEMORIA_DISPLAYS);
+    if (framebuffers_usados >= MEMORIA_DISPLAYS || ssd->bufsize > sizeof(framebuffers[0])) {
+        memoria_falha(MEMORIA_FRAMEBUFFER);
+        ssd->ram_buffer = NULL;
+        return;
+    }
+    ssd->ram_buffer = framebuffers[framebuffers_usados++];
+    memset(ssd->ram_buffer, 0, ssd->bufsize);
+    memoria_ocupar(MEMORIA_FRAMEBUFFER);
+#else
     ssd->ram_buffer = calloc(ssd->bufsize, sizeof(uint8_t));
+#endif
     ssd->ram_buffer[0] = 0x40;
-    ssd->port_buffer[0] = 0x80;
 }
 
 // Envia os dados ao display
 void ssd1306_send_data(ssd1306_t *ssd) {
+    if (!ssd->ram_buffer) return;   // Sem framebuffer (MEMORIA_ESTATICA)
     ssd1306_command(ssd, ssd1306_set_column_address);
     ssd1306_command(ssd, 0);
     ssd1306_command(ssd, ssd->width - 1);
     ssd1306_command(ssd, ssd1306_set_page_address);
     ssd1306_command(ssd, 0);
     ssd1306_command(ssd, ssd->pages - 1);
+    RASTRO(RASTRO_I2C_INICIO, ssd->address | (ssd->bufsize << 8));
     i2c_write_blocking(
     ssd->i2c_port, ssd->address, ssd->ram_buffer, ssd->bufsize, false );
+    RASTRO(RASTRO_I2C_FIM, ssd->address);
 }
 
 // Desenha o bitmap (a ser fornecido em display_oled.c) no display
 void ssd1306_draw_bitmap(ssd1306_t *ssd, const uint8_t *bitmap) {
+    if (!ssd->ram_buffer) return;
     for (int i = 0; i < ssd->bufsize - 1; i++) {
         ssd->ram_buffer[i + 1] = bitmap[i];
 
@@ -0,0 +1,78 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "decisao.h"
+
+// Trace binário das entradas da decisão, enviado pela CDC USB junto com o
+// texto do printf. Sem acesso a hardware: o mesmo módulo decodifica o trace
+// na ferramenta de replay (tools/trace_replay.c).
+//
+// Quadro (little-endian):  0xA5 0x5A tipo len payload[len] crc8(tipo, len, payload)
+//   TRACE_INICIO:  u8 versão, u8 seq, u64 t_us, estado da decisão (DECISAO_ESTADO_BYTES)
+//   TRACE_CICLO:   u8 seq, u32 t_us (32 bits baixos), u16 d1_mm, u16 d2_mm, u8 flags
+//   TRACE_COMANDO: u8 seq, u32 t_us, u8 comando, u8 argumento
+// seq conta quadros (mod 256): uma lacuna indica perda. Após uma perda o
+// próximo quadro é sempre um TRACE_INICIO, que ressincroniza o replay; um
+// TRACE_INICIO periódico cobre as perdas que a placa não vê (na CDC/host).
+// Os quadros TRACE_RASTRO_* são do despejo do rastro de eventos (rastro.h).
+
+// ================= CONFIGURAÇÃO =================
+#define TRACE_BUFFER_BYTES 4096   // Potência de 2; quadros que não cabem são descartados
+#define TRACE_INICIO_CICLOS 64    // Ciclos entre dois TRACE_INICIO
+
+#define TRACE_SYNC0  0xA5
+#define TRACE_SYNC1  0x5A
+#define TRACE_VERSAO 1
+#define TRACE_PAYLOAD_MAX 255
+#define TRACE_QUADRO_EXTRA 5      // sync(2) + tipo + len + crc
+
+typedef enum {
+    TRACE_INICIO = 1,
+    TRACE_CICLO,
+    TRACE_COMANDO,
+    TRACE_RASTRO_INICIO,
+    TRACE_RASTRO
+} trace_tipo_t;
+
+typedef enum {
+    TRACE_CMD_LOCALIZAR = 1      // argumento = vaga (1 ou 2)
+} trace_comando_t;
+
+#define TRACE_FLAG_D2_NOVA 0x01
+
+typedef struct {
+    uint32_t quadros;
+    uint32_t bytes;
+    uint32_t descartados;        // Ciclos perdidos com o buffer cheio
+} trace_stats_t;
+
+// Decodificador byte a byte; ignora tudo que não for um quadro válido
+typedef struct {
+    uint8_t fase;
+    uint8_t tipo;
+    uint8_t len;
+    uint16_t pos;
+    uint8_t payload[TRACE_PAYLOAD_MAX];
+    uint32_t erros_crc;
+} trace_leitor_t;
+
+// ================= API (placa) =================
+void trace_ativar(bool ligado);
+bool trace_ativo(void);
+// Chamada antes de decisao_passo, com o estado anterior ao ciclo
+void trace_registrar_ciclo(const decisao_t *d, const decisao_entrada_t *e);
+// Só quadros inteiros; 0 quando o próximo não cabe em max
+size_t trace_ler(uint8_t *buf, size_t max);
+const trace_stats_t *trace_get_stats(void);
+
+// ================= API (codificação / decodificação) =================
+uint8_t trace_crc8(const uint8_t *dados, size_t len);
+// Monta um quadro completo em buf (len + TRACE_QUADRO_EXTRA bytes); retorna o tamanho
+size_t trace_quadro(uint8_t *buf, trace_tipo_t tipo, const uint8_t *payload, uint8_t len);
+void trace_leitor_init(trace_leitor_t *l);
+bool trace_leitor_byte(trace_leitor_t *l, uint8_t b);   // true = quadro completo em l
+
+#endif
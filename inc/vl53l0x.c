@@ -12,41 +12,309 @@
 
 #include "vl53l0x.h"
 #include "pico/stdlib.h"
+#include "rastro.h"
 #include <string.h>
 
 // --- Funções Helper de Baixo Nível I2C ---
 
+// O VL53L0X incrementa o índice do registrador automaticamente, então
+// registradores contíguos são lidos/escritos em uma única transação.
+#define VL53L0X_MAX_BURST 16
+
+static void write_multi(vl53l0x_dev* dev, uint8_t reg, const uint8_t* data, uint8_t len) {
+    uint8_t buf[VL53L0X_MAX_BURST + 1];
+    buf[0] = reg;
+    memcpy(buf + 1, data, len);
+    dev->i2c_transactions++;
+    dev->i2c_bytes += len + 1;
+    RASTRO(RASTRO_I2C_INICIO, dev->address | ((len + 1) << 8));
+    i2c_write_blocking(dev->i2c, dev->address, buf, len + 1, false);
+    RASTRO(RASTRO_I2C_FIM, dev->address);
+}
+
+static void read_multi(vl53l0x_dev* dev, uint8_t reg, uint8_t* data, uint8_t len) {
+    dev->i2c_transactions++;
+    dev->i2c_bytes += len + 1;
+    RASTRO(RASTRO_I2C_INICIO, dev->address | ((len + 1) << 8));
+    i2c_write_blocking(dev->i2c, dev->address, &reg, 1, true);
+    i2c_read_blocking(dev->i2c, dev->address, data, len, false);
+    RASTRO(RASTRO_I2C_FIM, dev->address);
+}
+
 static void write_reg(vl53l0x_dev* dev, uint8_t reg, uint8_t val) {
-    uint8_t buf[2] = {reg, val};
-    i2c_write_blocking(dev->i2c, dev->address, buf, 2, false);
+    write_multi(dev, reg, &val, 1);
 }
 
 static void write_reg16(vl53l0x_dev* dev, uint8_t reg, uint16_t val) {
-    uint8_t buf[3] = {reg, (val >> 8), (val & 0xFF)};
-    i2c_write_blocking(dev->i2c, dev->address, buf, 3, false);
+    uint8_t buf[2] = {(val >> 8), (val & 0xFF)};
+    write_multi(dev, reg, buf, 2);
+}
+
+static void write_reg32(vl53l0x_dev* dev, uint8_t reg, uint32_t val) {
+    uint8_t buf[4] = {(val >> 24), (val >> 16) & 0xFF, (val >> 8) & 0xFF, (val & 0xFF)};
+    write_multi(dev, reg, buf, 4);
 }
 
 static uint8_t read_reg(vl53l0x_dev* dev, uint8_t reg) {
     uint8_t val;
-    i2c_write_blocking(dev->i2c, dev->address, &reg, 1, true);
-    i2c_read_blocking(dev->i2c, dev->address, &val, 1, false);
+    read_multi(dev, reg, &val, 1);
     return val;
 }
 
 static uint16_t read_reg16(vl53l0x_dev* dev, uint8_t reg) {
     uint8_t buf[2];
-    i2c_write_blocking(dev->i2c, dev->address, &reg, 1, true);
-    i2c_read_blocking(dev->i2c, dev->address, buf, 2, false);
+    read_multi(dev, reg, buf, 2);
     return ((uint16_t)buf[0] << 8) | buf[1];
 }
 
+// Par registrador/valor para sequências de escrita em tabela.
+typedef struct {
+    uint8_t reg;
+    uint8_t val;
+} reg_val;
+
+static void write_reg_list(vl53l0x_dev* dev, const reg_val* list, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        write_reg(dev, list[i].reg, list[i].val);
+    }
+}
+
+
+// Restaura a "stop variable" (página interna 0x91) antes de iniciar medições.
+static void load_stop_variable(vl53l0x_dev* dev) {
+    const reg_val pre[] = {
+        {POWER_MANAGEMENT_GO1_POWER_FORCE, 0x01}, {0xFF, 0x01}, {SYSRANGE_START, 0x00},
+    };
+    const reg_val post[] = {
+        {SYSRANGE_START, 0x01}, {0xFF, 0x00}, {POWER_MANAGEMENT_GO1_POWER_FORCE, 0x00},
+    };
+    write_reg_list(dev, pre, count_of(pre));
+    write_reg(dev, 0x91, dev->stop_variable);
+    write_reg_list(dev, post, count_of(post));
+}
+
+// --- Timing Budget: Conversões e Sequência de Medição ---
+
+// Os períodos de VCSEL são guardados como (pclks / 2) - 1.
+#define decode_vcsel_period(reg_val)      ((uint8_t)(((reg_val) + 1) << 1))
+#define encode_vcsel_period(period_pclks) ((uint8_t)(((period_pclks) >> 1) - 1))
+
+// Período do "macro clock" em ns para um dado período de VCSEL.
+#define calc_macro_period(vcsel_period_pclks) ((((uint32_t)2304 * (vcsel_period_pclks) * 1655) + 500) / 1000)
+
+// Etapas habilitadas em SYSTEM_SEQUENCE_CONFIG.
+typedef struct {
+    bool tcc, msrc, dss, pre_range, final_range;
+} sequence_step_enables;
+
+typedef struct {
+    uint8_t pre_range_vcsel_period_pclks, final_range_vcsel_period_pclks;
+    uint16_t msrc_dss_tcc_mclks, pre_range_mclks, final_range_mclks;
+    uint32_t msrc_dss_tcc_us, pre_range_us, final_range_us;
+} sequence_step_timeouts;
+
+// Timeout no formato do registrador: (LSByte * 2^MSByte) + 1.
+static uint16_t decode_timeout(uint16_t reg_val) {
+    return (uint16_t)((reg_val & 0x00FF) << (uint16_t)((reg_val & 0xFF00) >> 8)) + 1;
+}
+
+static uint16_t encode_timeout(uint32_t timeout_mclks) {
+    if (timeout_mclks == 0) return 0;
+
+    uint32_t ls_byte = timeout_mclks - 1;
+    uint16_t ms_byte = 0;
+    while ((ls_byte & 0xFFFFFF00) > 0) {
+        ls_byte >>= 1;
+        ms_byte++;
+    }
+    return (ms_byte << 8) | (ls_byte & 0xFF);
+}
+
+static uint32_t timeout_mclks_to_us(uint16_t timeout_mclks, uint8_t vcsel_period_pclks) {
+    uint32_t macro_period_ns = calc_macro_period(vcsel_period_pclks);
+    return ((timeout_mclks * macro_period_ns) + 500) / 1000;
+}
+
+static uint32_t timeout_us_to_mclks(uint32_t timeout_us, uint8_t vcsel_period_pclks) {
+    uint32_t macro_period_ns = calc_macro_period(vcsel_period_pclks);
+    return ((timeout_us * 1000) + (macro_period_ns / 2)) / macro_period_ns;
+}
+
+static void get_sequence_step_enables(vl53l0x_dev* dev, sequence_step_enables* enables) {
+    uint8_t sequence_config = read_reg(dev, SYSTEM_SEQUENCE_CONFIG);
+
+    enables->tcc         = (sequence_config >> 4) & 0x1;
+    enables->dss         = (sequence_config >> 3) & 0x1;
+    enables->msrc        = (sequence_config >> 2) & 0x1;
+    enables->pre_range   = (sequence_config >> 6) & 0x1;
+    enables->final_range = (sequence_config >> 7) & 0x1;
+}
+
+static void get_sequence_step_timeouts(vl53l0x_dev* dev, const sequence_step_enables* enables,
+                                       sequence_step_timeouts* timeouts) {
+    // 0x50..0x52 (período + timeout do pre range) e 0x70..0x72 (final range)
+    // são contíguos: uma leitura em rajada para cada bloco.
+    uint8_t pre[3], final[3];
+    read_multi(dev, PRE_RANGE_CONFIG_VCSEL_PERIOD, pre, 3);
+    read_multi(dev, FINAL_RANGE_CONFIG_VCSEL_PERIOD, final, 3);
+
+    timeouts->pre_range_vcsel_period_pclks = decode_vcsel_period(pre[0]);
+
+    timeouts->msrc_dss_tcc_mclks = read_reg(dev, MSRC_CONFIG_TIMEOUT_MACROP) + 1;
+    timeouts->msrc_dss_tcc_us =
+        timeout_mclks_to_us(timeouts->msrc_dss_tcc_mclks, timeouts->pre_range_vcsel_period_pclks);
+
+    timeouts->pre_range_mclks = decode_timeout(((uint16_t)pre[1] << 8) | pre[2]);
+    timeouts->pre_range_us =
+        timeout_mclks_to_us(timeouts->pre_range_mclks, timeouts->pre_range_vcsel_period_pclks);
+
+    timeouts->final_range_vcsel_period_pclks = decode_vcsel_period(final[0]);
+
+    // O timeout do final range inclui o do pre range quando este está habilitado.
+    timeouts->final_range_mclks = decode_timeout(((uint16_t)final[1] << 8) | final[2]);
+    if (enables->pre_range) {
+        timeouts->final_range_mclks -= timeouts->pre_range_mclks;
+    }
+    timeouts->final_range_us =
+        timeout_mclks_to_us(timeouts->final_range_mclks, timeouts->final_range_vcsel_period_pclks);
+}
+
+// Calibração de referência (VHV com 0x40, fase com 0x00).
+static bool perform_single_ref_calibration(vl53l0x_dev* dev, uint8_t vhv_init_byte) {
+    write_reg(dev, SYSRANGE_START, 0x01 | vhv_init_byte);
+
+    uint32_t start = to_ms_since_boot(get_absolute_time());
+    while ((read_reg(dev, RESULT_INTERRUPT_STATUS) & 0x07) == 0) {
+        if (to_ms_since_boot(get_absolute_time()) - start > dev->io_timeout) return false;
+    }
+
+    write_reg(dev, SYSTEM_INTERRUPT_CLEAR, 0x01);
+    write_reg(dev, SYSRANGE_START, 0x00);
+    return true;
+}
+
+
+// --- Calibração de SPAD e de Referência ---
+
+// Lê da NVM a quantidade e o tipo dos SPADs de referência (handshake em 0x83).
+static bool get_spad_info(vl53l0x_dev* dev, uint8_t* count, bool* type_is_aperture) {
+    write_reg(dev, POWER_MANAGEMENT_GO1_POWER_FORCE, 0x01); write_reg(dev, 0xFF, 0x01);
+    write_reg(dev, SYSRANGE_START, 0x00); write_reg(dev, 0xFF, 0x06);
+    write_reg(dev, 0x83, read_reg(dev, 0x83) | 0x04);
+    write_reg(dev, 0xFF, 0x07); write_reg(dev, 0x81, 0x01);
+    write_reg(dev, POWER_MANAGEMENT_GO1_POWER_FORCE, 0x01); write_reg(dev, 0x94, 0x6b);
+    write_reg(dev, 0x83, 0x00);
+    uint32_t start = to_ms_since_boot(get_absolute_time());
+    while (read_reg(dev, 0x83) == 0x00) {
+        if (to_ms_since_boot(get_absolute_time()) - start > dev->io_timeout) return false;
+    }
+    write_reg(dev, 0x83, 0x01);
+    uint8_t tmp = read_reg(dev, 0x92);
+    *count = tmp & 0x7F;
+    *type_is_aperture = (tmp >> 7) & 0x01;
+    write_reg(dev, 0x81, 0x00); write_reg(dev, 0xFF, 0x06);
+    write_reg(dev, 0x83, read_reg(dev, 0x83) & ~0x04);
+    write_reg(dev, 0xFF, 0x01); write_reg(dev, SYSRANGE_START, 0x01);
+    write_reg(dev, 0xFF, 0x00); write_reg(dev, POWER_MANAGEMENT_GO1_POWER_FORCE, 0x00);
+    return true;
+}
+
+// Habilita apenas os primeiros 'count' SPADs bons do tipo indicado.
+static void compute_ref_spad_map(const uint8_t* good_map, uint8_t count, bool type_is_aperture,
+                                 uint8_t* ref_map) {
+    uint8_t first_spad_to_enable = type_is_aperture ? 12 : 0; // 12 é o primeiro SPAD de abertura
+    uint8_t spads_enabled = 0;
+
+    memcpy(ref_map, good_map, VL53L0X_SPAD_MAP_SIZE);
+    for (uint8_t i = 0; i < VL53L0X_SPAD_MAP_SIZE * 8; i++) {
+        if (i < first_spad_to_enable || spads_enabled == count) {
+            ref_map[i / 8] &= ~(1 << (i % 8));
+        } else if ((ref_map[i / 8] >> (i % 8)) & 0x1) {
+            spads_enabled++;
+        }
+    }
+}
+
+static void set_reference_spads(vl53l0x_dev* dev, const uint8_t* ref_map) {
+    const reg_val setup[] = {
+        {0xFF, 0x01},
+        {DYNAMIC_SPAD_REF_EN_START_OFFSET, 0x00},
+        {DYNAMIC_SPAD_NUM_REQUESTED_REF_SPAD, 0x2C},
+        {0xFF, 0x00},
+        {GLOBAL_CONFIG_REF_EN_START_SELECT, 0xB4},
+    };
+    write_reg_list(dev, setup, count_of(setup));
+    write_multi(dev, GLOBAL_CONFIG_SPAD_ENABLES_REF_0, ref_map, VL53L0X_SPAD_MAP_SIZE);
+}
+
+// Resultados da calibração VHV/fase ficam em 0xCB e 0xEE (página interna).
+static void read_ref_calibration(vl53l0x_dev* dev, uint8_t* vhv, uint8_t* phase) {
+    write_reg(dev, 0xFF, 0x01); write_reg(dev, SYSRANGE_START, 0x00); write_reg(dev, 0xFF, 0x00);
+    *vhv = read_reg(dev, 0xCB);
+    *phase = read_reg(dev, 0xEE);
+    write_reg(dev, 0xFF, 0x01); write_reg(dev, SYSRANGE_START, 0x01); write_reg(dev, 0xFF, 0x00);
+}
+
+static void write_ref_calibration(vl53l0x_dev* dev, uint8_t vhv, uint8_t phase) {
+    write_reg(dev, 0xFF, 0x01); write_reg(dev, SYSRANGE_START, 0x00); write_reg(dev, 0xFF, 0x00);
+    write_reg(dev, 0xCB, vhv);
+    write_reg(dev, 0xEE, phase);
+    write_reg(dev, 0xFF, 0x01); write_reg(dev, SYSRANGE_START, 0x01); write_reg(dev, 0xFF, 0x00);
+}
+
+// A calibração salva só vale para o mesmo sensor: mesmo modelo/revisão e o
+// mapa de SPADs bons gravado de fábrica (ou o mapa já programado, se o sensor
+// não foi desligado desde a última inicialização).
+static bool calibration_matches(const vl53l0x_calibration* cal, uint8_t model_id,
+                                uint8_t revision_id, const uint8_t* spad_map) {
+    if (cal->model_id != model_id || cal->revision_id != revision_id) return false;
+    return memcmp(cal->good_spad_map, spad_map, VL53L0X_SPAD_MAP_SIZE) == 0
+        || memcmp(cal->ref_spad_map, spad_map, VL53L0X_SPAD_MAP_SIZE) == 0;
+}
+
 
 // --- Funções Públicas ---
 
+bool vl53l0x_wait_boot(i2c_inst_t* i2c_port, uint8_t address, uint32_t timeout_ms) {
+    // Após o power-on o sensor responde NACK até terminar o boot (tBOOT ~1.2 ms).
+    // Considera pronto quando o registrador de modelo devolve o ID esperado.
+    absolute_time_t limite = make_timeout_time_ms(timeout_ms);
+    uint8_t reg = IDENTIFICATION_MODEL_ID;
+    uint8_t id = 0;
+
+    do {
+        if (i2c_write_blocking(i2c_port, address, &reg, 1, true) == 1 &&
+            i2c_read_blocking(i2c_port, address, &id, 1, false) == 1 &&
+            id == VL53L0X_MODEL_ID) {
+            return true;
+        }
+        sleep_us(250);
+    } while (!time_reached(limite));
+
+    return false;
+}
+
+bool vl53l0x_set_address(vl53l0x_dev* dev, uint8_t new_address) {
+    // O endereço novo vale até o próximo reset (XSHUT em nível baixo ou power-on).
+    // Com vários sensores no barramento, só o que está fora de reset pode ouvir isto.
+    new_address &= 0x7F;
+    write_reg(dev, I2C_SLAVE_DEVICE_ADDRESS, new_address);
+    dev->address = new_address;
+    return read_reg(dev, IDENTIFICATION_MODEL_ID) == VL53L0X_MODEL_ID;
+}
+
 bool vl53l0x_init(vl53l0x_dev* dev, i2c_inst_t* i2c_port) {
+    return vl53l0x_init_with_calibration(dev, i2c_port, NULL, NULL);
+}
+
+bool vl53l0x_init_with_calibration(vl53l0x_dev* dev, i2c_inst_t* i2c_port,
+                                   const vl53l0x_calibration* cached, vl53l0x_calibration* out) {
     dev->i2c = i2c_port;
-    dev->address = VL53L0X_ADDRESS;
+    if (dev->address == 0) dev->address = VL53L0X_ADDRESS; // Mantém o endereço já reprogramado
     dev->io_timeout = 1000; // Timeout de 1 segundo para operações.
+    dev->i2c_transactions = 0;
+    dev->i2c_bytes = 0;
+    dev->calibration_from_cache = false;
 
     // A sequência abaixo é uma implementação complexa e específica do VL53L0X,
     // necessária para calibrar e configurar corretamente o sensor.
@@ -66,44 +334,65 @@ bool vl53l0x_init(vl53l0x_dev* dev, i2c_inst_t* i2c_port) {
     write_reg16(dev, FINAL_RANGE_CONFIG_MIN_COUNT_RATE_RTN_LIMIT, (uint16_t)(0.25 * (1 << 7)));
     write_reg(dev, SYSTEM_SEQUENCE_CONFIG, 0xFF);
 
-    // Calibração de SPAD (Single Photon Avalanche Diode).
-    write_reg(dev, POWER_MANAGEMENT_GO1_POWER_FORCE, 0x01); write_reg(dev, 0xFF, 0x01);
-    write_reg(dev, SYSRANGE_START, 0x00); write_reg(dev, 0xFF, 0x06);
-    write_reg(dev, 0x83, read_reg(dev, 0x83) | 0x04);
-    write_reg(dev, 0xFF, 0x07); write_reg(dev, 0x81, 0x01);
-    write_reg(dev, POWER_MANAGEMENT_GO1_POWER_FORCE, 0x01); write_reg(dev, 0x94, 0x6b);
-    write_reg(dev, 0x83, 0x00);
-    uint32_t start = to_ms_since_boot(get_absolute_time());
-    while (read_reg(dev, 0x83) == 0x00) {
-        if (to_ms_since_boot(get_absolute_time()) - start > dev->io_timeout) return false;
+    // Identidade do sensor: modelo (0xC0) e revisão (0xC2) + mapa de SPADs atual.
+    uint8_t id[3];
+    uint8_t spad_map[VL53L0X_SPAD_MAP_SIZE];
+    read_multi(dev, IDENTIFICATION_MODEL_ID, id, sizeof(id));
+    read_multi(dev, GLOBAL_CONFIG_SPAD_ENABLES_REF_0, spad_map, sizeof(spad_map));
+
+    vl53l0x_calibration cal;
+    bool from_cache = cached && calibration_matches(cached, id[0], id[2], spad_map);
+
+    if (from_cache) {
+        // Reaproveita a calibração salva: pula o handshake de SPAD da NVM.
+        cal = *cached;
+    } else {
+        // Calibração de SPAD (Single Photon Avalanche Diode).
+        cal.model_id = id[0];
+        cal.revision_id = id[2];
+        memcpy(cal.good_spad_map, spad_map, VL53L0X_SPAD_MAP_SIZE);
+        if (!get_spad_info(dev, &cal.spad_count, &cal.spad_type_is_aperture)) return false;
+        compute_ref_spad_map(cal.good_spad_map, cal.spad_count, cal.spad_type_is_aperture, cal.ref_spad_map);
     }
-    write_reg(dev, 0x83, 0x01);
-    read_reg(dev, 0x92);
-    write_reg(dev, 0x81, 0x00); write_reg(dev, 0xFF, 0x06);
-    write_reg(dev, 0x83, read_reg(dev, 0x83) & ~0x04);
-    write_reg(dev, 0xFF, 0x01); write_reg(dev, SYSRANGE_START, 0x01);
-    write_reg(dev, 0xFF, 0x00); write_reg(dev, POWER_MANAGEMENT_GO1_POWER_FORCE, 0x00);
+    set_reference_spads(dev, cal.ref_spad_map);
 
-    // Configuração da interrupção (não usada ativamente, mas parte da sequência).
-    write_reg(dev, SYSTEM_INTERRUPT_CONFIG_GPIO, 0x04);
+    // Configuração da interrupção: GPIO1 ativo em nível baixo, nova amostra.
     write_reg(dev, GPIO_HV_MUX_ACTIVE_HIGH, read_reg(dev, GPIO_HV_MUX_ACTIVE_HIGH) & ~0x10);
-    write_reg(dev, SYSTEM_INTERRUPT_CLEAR, 0x01);
+    vl53l0x_set_interrupt_mode(dev, VL53L0X_INT_NOVA_AMOSTRA, 0, 0);
 
     // Configuração do timing budget (orçamento de tempo por medição).
-    dev->measurement_timing_budget_us = 33000; // 33ms é um bom valor padrão.
+    // Os timeouts de cada etapa são recalculados a partir do budget pedido.
+    dev->continuous = false;
+    dev->continuous_period_ms = 0;
+    dev->profile = VL53L0X_PERFIL_PADRAO;
     write_reg(dev, SYSTEM_SEQUENCE_CONFIG, 0xE8);
-    write_reg16(dev, 0x04, 33000 / 1085); // Valor de aproximação para o período.
+    if (!vl53l0x_set_measurement_timing_budget(dev, 33000)) return false;
+
+    if (from_cache) {
+        write_ref_calibration(dev, cal.vhv_settings, cal.phase_cal);
+        write_reg16(dev, ALGO_PART_TO_PART_RANGE_OFFSET_MM, cal.part_offset);
+    } else {
+        // Calibrações de referência: VHV e fase.
+        write_reg(dev, SYSTEM_SEQUENCE_CONFIG, 0x01);
+        if (!perform_single_ref_calibration(dev, 0x40)) return false;
+        write_reg(dev, SYSTEM_SEQUENCE_CONFIG, 0x02);
+        if (!perform_single_ref_calibration(dev, 0x00)) return false;
+        write_reg(dev, SYSTEM_SEQUENCE_CONFIG, 0xE8);
+
+        read_ref_calibration(dev, &cal.vhv_settings, &cal.phase_cal);
+        cal.part_offset = read_reg16(dev, ALGO_PART_TO_PART_RANGE_OFFSET_MM);
+    }
 
     write_reg(dev, SYSTEM_INTERRUPT_CLEAR, 0x01);
+
+    dev->calibration_from_cache = from_cache;
+    if (out) *out = cal;
     return true;
 }
 
 uint16_t vl53l0x_read_range_single_millimeters(vl53l0x_dev* dev) {
     // Sequência de trigger para medição única.
-    write_reg(dev, POWER_MANAGEMENT_GO1_POWER_FORCE, 0x01);
-    write_reg(dev, 0xFF, 0x01); write_reg(dev, SYSRANGE_START, 0x00);
-    write_reg(dev, 0x91, dev->stop_variable); write_reg(dev, SYSRANGE_START, 0x01);
-    write_reg(dev, 0xFF, 0x00); write_reg(dev, POWER_MANAGEMENT_GO1_POWER_FORCE, 0x00);
+    load_stop_variable(dev);
     write_reg(dev, SYSRANGE_START, 0x01);
 
     // Espera o sensor ficar pronto.
@@ -124,28 +413,269 @@ uint16_t vl53l0x_read_range_single_millimeters(vl53l0x_dev* dev) {
 }
 
 void vl53l0x_start_continuous(vl53l0x_dev* dev, uint32_t period_ms) {
-    write_reg(dev, POWER_MANAGEMENT_GO1_POWER_FORCE, 0x01);
-    write_reg(dev, 0xFF, 0x01); write_reg(dev, SYSRANGE_START, 0x00);
-    write_reg(dev, 0x91, dev->stop_variable); write_reg(dev, SYSRANGE_START, 0x01);
-    write_reg(dev, 0xFF, 0x00); write_reg(dev, POWER_MANAGEMENT_GO1_POWER_FORCE, 0x00);
+    load_stop_variable(dev);
 
     if (period_ms != 0) {
-        // Modo contínuo com intervalo programado.
-        write_reg16(dev, SYSTEM_INTERMEASUREMENT_PERIOD, period_ms * 12 / 13);
+        // Modo contínuo com intervalo programado (em ciclos do oscilador interno).
+        uint16_t osc_calibrate_val = read_reg16(dev, OSC_CALIBRATE_VAL);
+        uint32_t period = period_ms;
+        if (osc_calibrate_val != 0) period *= osc_calibrate_val;
+        write_reg32(dev, SYSTEM_INTERMEASUREMENT_PERIOD, period);
         write_reg(dev, SYSRANGE_START, 0x04);
     } else {
         // Modo contínuo mais rápido possível ("back-to-back").
         write_reg(dev, SYSRANGE_START, 0x02);
     }
+
+    dev->continuous = true;
+    dev->continuous_period_ms = period_ms;
+}
+
+void vl53l0x_stop_continuous(vl53l0x_dev* dev) {
+    write_reg(dev, SYSRANGE_START, 0x01); // Volta ao modo single shot.
+    write_reg(dev, 0xFF, 0x01); write_reg(dev, SYSRANGE_START, 0x00);
+    write_reg(dev, 0x91, 0x00); write_reg(dev, SYSRANGE_START, 0x01);
+    write_reg(dev, 0xFF, 0x00);
+
+    dev->continuous = false;
 }
 
 uint16_t vl53l0x_read_range_continuous_millimeters(vl53l0x_dev* dev) {
     // Espera pelo flag de "dado pronto".
     uint32_t start = to_ms_since_boot(get_absolute_time());
-    while ((read_reg(dev, RESULT_INTERRUPT_STATUS) & 0x07) == 0) {
+    while (!vl53l0x_data_ready(dev)) {
         if ((to_ms_since_boot(get_absolute_time()) - start) > dev->io_timeout) return 65535;
     }
+    return vl53l0x_read_range_ready_millimeters(dev);
+}
+
+// --- Interrupção por Limiar ---
+
+void vl53l0x_set_interrupt_mode(vl53l0x_dev* dev, vl53l0x_int_mode mode,
+                                uint16_t low_mm, uint16_t high_mm) {
+    // Os registradores de limiar guardam a distância em unidades de 2 mm
+    // (ponto fixo 16.16 deslocado 17 bits, como na API da ST).
+    uint16_t low = (low_mm >> 1) & 0x0FFF;
+    uint16_t high = (high_mm >> 1) & 0x0FFF;
+
+    // 0x0A..0x0F em uma única escrita: modo do GPIO, clear (descarta o evento
+    // pendente da configuração anterior), THRESH_HIGH e THRESH_LOW.
+    uint8_t buf[6] = {
+        mode, 0x01,
+        (high >> 8), (high & 0xFF),
+        (low >> 8), (low & 0xFF),
+    };
+    write_multi(dev, SYSTEM_INTERRUPT_CONFIG_GPIO, buf, sizeof(buf));
+    dev->int_mode = mode;
+}
+
+bool vl53l0x_data_ready(vl53l0x_dev* dev) {
+    // Nos modos de limiar este flag só sobe quando a condição programada ocorre.
+    return (read_reg(dev, RESULT_INTERRUPT_STATUS) & 0x07) != 0;
+}
+
+bool vl53l0x_read_result(vl53l0x_dev* dev, vl53l0x_result* result) {
+    // Bloco de resultados 0x13..0x1F em uma leitura: status da interrupção,
+    // status da medida, SPADs efetivos, taxa de sinal, ambiente e distância.
+    uint8_t buf[13];
+    read_multi(dev, RESULT_INTERRUPT_STATUS, buf, sizeof(buf));
+    if ((buf[0] & 0x07) == 0) return false;
+
+    result->range_status    = buf[1];
+    result->spad_count      = ((uint16_t)buf[3] << 8) | buf[4];
+    result->signal_rate     = ((uint16_t)buf[7] << 8) | buf[8];
+    result->ambient_rate    = ((uint16_t)buf[9] << 8) | buf[10];
+    result->range_mm        = ((uint16_t)buf[11] << 8) | buf[12];
+
+    write_reg(dev, SYSTEM_INTERRUPT_CLEAR, 0x01);
+    return true;
+}
+
+uint16_t vl53l0x_read_range_ready_millimeters(vl53l0x_dev* dev) {
+    // Deve ser chamada somente depois de vl53l0x_data_ready() (ou do pino GPIO1).
     uint16_t range = read_reg16(dev, RESULT_RANGE_MM);
     write_reg(dev, SYSTEM_INTERRUPT_CLEAR, 0x01);
     return range;
 }
+
+
+// --- Timing Budget e Perfis ---
+
+bool vl53l0x_set_signal_rate_limit(vl53l0x_dev* dev, float limit_mcps) {
+    if (limit_mcps < 0 || limit_mcps > 511.99f) return false;
+
+    // Ponto fixo Q9.7.
+    write_reg16(dev, FINAL_RANGE_CONFIG_MIN_COUNT_RATE_RTN_LIMIT, (uint16_t)(limit_mcps * (1 << 7)));
+    return true;
+}
+
+// Sobrecargas fixas de cada etapa da sequência (µs), conforme a API da ST.
+#define BUDGET_START_OVERHEAD       1910
+#define BUDGET_END_OVERHEAD          960
+#define BUDGET_MSRC_OVERHEAD         660
+#define BUDGET_TCC_OVERHEAD          590
+#define BUDGET_DSS_OVERHEAD          690
+#define BUDGET_PRE_RANGE_OVERHEAD    660
+#define BUDGET_FINAL_RANGE_OVERHEAD  550
+
+// Soma o tempo gasto pelas etapas que antecedem o final range.
+static uint32_t budget_used_before_final(const sequence_step_enables* enables,
+                                         const sequence_step_timeouts* timeouts) {
+    uint32_t used_us = BUDGET_START_OVERHEAD + BUDGET_END_OVERHEAD;
+
+    if (enables->tcc) used_us += timeouts->msrc_dss_tcc_us + BUDGET_TCC_OVERHEAD;
+
+    if (enables->dss) used_us += 2 * (timeouts->msrc_dss_tcc_us + BUDGET_DSS_OVERHEAD);
+    else if (enables->msrc) used_us += timeouts->msrc_dss_tcc_us + BUDGET_MSRC_OVERHEAD;
+
+    if (enables->pre_range) used_us += timeouts->pre_range_us + BUDGET_PRE_RANGE_OVERHEAD;
+
+    return used_us;
+}
+
+bool vl53l0x_set_measurement_timing_budget(vl53l0x_dev* dev, uint32_t budget_us) {
+    sequence_step_enables enables;
+    sequence_step_timeouts timeouts;
+
+    get_sequence_step_enables(dev, &enables);
+    get_sequence_step_timeouts(dev, &enables, &timeouts);
+
+    if (!enables.final_range) return true;
+
+    // O que sobra do budget depois das demais etapas vai para o final range.
+    uint32_t used_us = budget_used_before_final(&enables, &timeouts) + BUDGET_FINAL_RANGE_OVERHEAD;
+    if (used_us > budget_us) return false; // Budget pequeno demais.
+
+    uint32_t final_range_timeout_mclks =
+        timeout_us_to_mclks(budget_us - used_us, timeouts.final_range_vcsel_period_pclks);
+    if (enables.pre_range) final_range_timeout_mclks += timeouts.pre_range_mclks;
+
+    write_reg16(dev, FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI, encode_timeout(final_range_timeout_mclks));
+    dev->measurement_timing_budget_us = budget_us;
+    return true;
+}
+
+uint32_t vl53l0x_get_measurement_timing_budget(vl53l0x_dev* dev) {
+    sequence_step_enables enables;
+    sequence_step_timeouts timeouts;
+
+    get_sequence_step_enables(dev, &enables);
+    get_sequence_step_timeouts(dev, &enables, &timeouts);
+
+    uint32_t budget_us = budget_used_before_final(&enables, &timeouts);
+    if (enables.final_range) budget_us += timeouts.final_range_us + BUDGET_FINAL_RANGE_OVERHEAD;
+
+    dev->measurement_timing_budget_us = budget_us;
+    return budget_us;
+}
+
+uint8_t vl53l0x_get_vcsel_pulse_period(vl53l0x_dev* dev, vl53l0x_vcsel_period_type type) {
+    if (type == VL53L0X_VCSEL_PRE_RANGE) {
+        return decode_vcsel_period(read_reg(dev, PRE_RANGE_CONFIG_VCSEL_PERIOD));
+    }
+    return decode_vcsel_period(read_reg(dev, FINAL_RANGE_CONFIG_VCSEL_PERIOD));
+}
+
+bool vl53l0x_set_vcsel_pulse_period(vl53l0x_dev* dev, vl53l0x_vcsel_period_type type, uint8_t period_pclks) {
+    uint8_t vcsel_period_reg = encode_vcsel_period(period_pclks);
+    sequence_step_enables enables;
+    sequence_step_timeouts timeouts;
+
+    get_sequence_step_enables(dev, &enables);
+    get_sequence_step_timeouts(dev, &enables, &timeouts);
+
+    if (type == VL53L0X_VCSEL_PRE_RANGE) {
+        // Janela de fase válida para cada período (valores da API da ST).
+        switch (period_pclks) {
+            case 12: write_reg(dev, PRE_RANGE_CONFIG_VALID_PHASE_HIGH, 0x18); break;
+            case 14: write_reg(dev, PRE_RANGE_CONFIG_VALID_PHASE_HIGH, 0x30); break;
+            case 16: write_reg(dev, PRE_RANGE_CONFIG_VALID_PHASE_HIGH, 0x40); break;
+            case 18: write_reg(dev, PRE_RANGE_CONFIG_VALID_PHASE_HIGH, 0x50); break;
+            default: return false;
+        }
+        write_reg(dev, PRE_RANGE_CONFIG_VALID_PHASE_LOW, 0x08);
+        write_reg(dev, PRE_RANGE_CONFIG_VCSEL_PERIOD, vcsel_period_reg);
+
+        // Mantém os timeouts em µs: converte para o novo macro período.
+        uint32_t pre_range_mclks = timeout_us_to_mclks(timeouts.pre_range_us, period_pclks);
+        write_reg16(dev, PRE_RANGE_CONFIG_TIMEOUT_MACROP_HI, encode_timeout(pre_range_mclks));
+
+        uint32_t msrc_mclks = timeout_us_to_mclks(timeouts.msrc_dss_tcc_us, period_pclks);
+        write_reg(dev, MSRC_CONFIG_TIMEOUT_MACROP, (msrc_mclks > 256) ? 255 : (msrc_mclks - 1));
+    } else {
+        uint8_t phase_high, vcsel_width, phasecal_timeout, phasecal_lim;
+        switch (period_pclks) {
+            case 8:  phase_high = 0x10; vcsel_width = 0x02; phasecal_timeout = 0x0C; phasecal_lim = 0x30; break;
+            case 10: phase_high = 0x28; vcsel_width = 0x03; phasecal_timeout = 0x09; phasecal_lim = 0x20; break;
+            case 12: phase_high = 0x38; vcsel_width = 0x03; phasecal_timeout = 0x08; phasecal_lim = 0x20; break;
+            case 14: phase_high = 0x48; vcsel_width = 0x03; phasecal_timeout = 0x07; phasecal_lim = 0x20; break;
+            default: return false;
+        }
+        write_reg(dev, FINAL_RANGE_CONFIG_VALID_PHASE_HIGH, phase_high);
+        write_reg(dev, FINAL_RANGE_CONFIG_VALID_PHASE_LOW, 0x08);
+        write_reg(dev, GLOBAL_CONFIG_VCSEL_WIDTH, vcsel_width);
+        write_reg(dev, ALGO_PHASECAL_CONFIG_TIMEOUT, phasecal_timeout);
+        write_reg(dev, 0xFF, 0x01);
+        write_reg(dev, ALGO_PHASECAL_LIM, phasecal_lim);
+        write_reg(dev, 0xFF, 0x00);
+
+        write_reg(dev, FINAL_RANGE_CONFIG_VCSEL_PERIOD, vcsel_period_reg);
+
+        uint32_t final_range_mclks = timeout_us_to_mclks(timeouts.final_range_us, period_pclks);
+        if (enables.pre_range) final_range_mclks += timeouts.pre_range_mclks;
+        write_reg16(dev, FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI, encode_timeout(final_range_mclks));
+    }
+
+    // Reaplica o budget com os novos períodos e refaz a calibração de fase.
+    vl53l0x_set_measurement_timing_budget(dev, dev->measurement_timing_budget_us);
+
+    uint8_t sequence_config = read_reg(dev, SYSTEM_SEQUENCE_CONFIG);
+    write_reg(dev, SYSTEM_SEQUENCE_CONFIG, 0x02);
+    bool ok = perform_single_ref_calibration(dev, 0x00);
+    write_reg(dev, SYSTEM_SEQUENCE_CONFIG, sequence_config);
+    return ok;
+}
+
+typedef struct {
+    uint32_t budget_us;
+    float signal_rate_limit_mcps;
+    uint8_t pre_range_vcsel_pclks;
+    uint8_t final_range_vcsel_pclks;
+} vl53l0x_profile_config;
+
+static const vl53l0x_profile_config profiles[VL53L0X_NUM_PERFIS] = {
+    [VL53L0X_PERFIL_RAPIDO]        = {  20000, 0.25f, 14, 10 },
+    [VL53L0X_PERFIL_PADRAO]        = {  33000, 0.25f, 14, 10 },
+    [VL53L0X_PERFIL_PRECISAO]      = { 200000, 0.25f, 14, 10 },
+    [VL53L0X_PERFIL_LONGO_ALCANCE] = {  33000, 0.10f, 18, 14 },
+};
+
+bool vl53l0x_set_profile(vl53l0x_dev* dev, vl53l0x_profile profile) {
+    if (profile >= VL53L0X_NUM_PERFIS) return false;
+    const vl53l0x_profile_config* cfg = &profiles[profile];
+
+    // Os registradores de timing só podem mudar com o sensor parado.
+    bool was_continuous = dev->continuous;
+    if (was_continuous) vl53l0x_stop_continuous(dev);
+
+    // A calibração de fase espera o flag de "nova amostra", que não sobe
+    // nos modos de limiar.
+    if (dev->int_mode != VL53L0X_INT_NOVA_AMOSTRA) {
+        write_reg(dev, SYSTEM_INTERRUPT_CONFIG_GPIO, VL53L0X_INT_NOVA_AMOSTRA);
+    }
+
+    // O budget vem primeiro: os períodos de VCSEL o reaplicam ao final.
+    bool ok = vl53l0x_set_signal_rate_limit(dev, cfg->signal_rate_limit_mcps)
+           && vl53l0x_set_measurement_timing_budget(dev, cfg->budget_us)
+           && vl53l0x_set_vcsel_pulse_period(dev, VL53L0X_VCSEL_PRE_RANGE, cfg->pre_range_vcsel_pclks)
+           && vl53l0x_set_vcsel_pulse_period(dev, VL53L0X_VCSEL_FINAL_RANGE, cfg->final_range_vcsel_pclks);
+    if (ok) dev->profile = profile;
+
+    if (dev->int_mode != VL53L0X_INT_NOVA_AMOSTRA) {
+        write_reg(dev, SYSTEM_INTERRUPT_CONFIG_GPIO, dev->int_mode);
+        write_reg(dev, SYSTEM_INTERRUPT_CLEAR, 0x01);
+    }
+
+    if (was_continuous) vl53l0x_start_continuous(dev, dev->continuous_period_ms);
+    return ok;
+}
@@ -18,6 +18,7 @@
 #include "hardware/i2c.h"
 
 #define VL53L0X_ADDRESS 0x29
+#define VL53L0X_MODEL_ID 0xEE
 
 /**
  * @brief Enumeração completa dos registradores do VL53L0X.
@@ -74,8 +75,76 @@ enum regAddr {
   ALGO_PHASECAL_LIM                           = 0x30,
   ALGO_PHASECAL_CONFIG_TIMEOUT                = 0x30,
   RESULT_RANGE_MM                             = 0x1E, 
+  DYNAMIC_SPAD_REF_EN_START_OFFSET            = 0x4F,
+  DYNAMIC_SPAD_NUM_REQUESTED_REF_SPAD         = 0x4E,
+  GLOBAL_CONFIG_REF_EN_START_SELECT           = 0xB6,
+  GLOBAL_CONFIG_SPAD_ENABLES_REF_0            = 0xB0,
 };
 
+#define VL53L0X_SPAD_MAP_SIZE 6
+
+/**
+ * @brief Resultado da calibração de SPAD e de referência (VHV/fase).
+ * Pode ser salvo e reaplicado para evitar recalibrar a cada boot.
+ */
+typedef struct {
+    uint8_t model_id;
+    uint8_t revision_id;
+    uint8_t good_spad_map[VL53L0X_SPAD_MAP_SIZE]; // Mapa de fábrica (identifica o sensor)
+    uint8_t ref_spad_map[VL53L0X_SPAD_MAP_SIZE];  // Mapa programado após a calibração
+    uint8_t spad_count;
+    bool spad_type_is_aperture;
+    uint8_t vhv_settings;
+    uint8_t phase_cal;
+    uint16_t part_offset;                         // ALGO_PART_TO_PART_RANGE_OFFSET_MM
+} vl53l0x_calibration;
+
+
+/**
+ * @brief Funções do pino GPIO1 do sensor (registrador SYSTEM_INTERRUPT_CONFIG_GPIO).
+ * Nos modos de limiar o sensor continua medindo, mas só sinaliza a amostra
+ * quando a distância cruza os limites programados em SYSTEM_THRESH_LOW/HIGH.
+ */
+typedef enum {
+  VL53L0X_INT_DESLIGADA    = 0x00,
+  VL53L0X_INT_ABAIXO       = 0x01, // distância < limite inferior
+  VL53L0X_INT_ACIMA        = 0x02, // distância > limite superior
+  VL53L0X_INT_FORA_JANELA  = 0x03, // distância < inferior ou > superior
+  VL53L0X_INT_NOVA_AMOSTRA = 0x04, // toda nova medição (padrão)
+} vl53l0x_int_mode;
+
+/**
+ * @brief Perfis de medição: trocam exatidão por taxa de amostragem.
+ * Cada perfil define timing budget, períodos de pulso do VCSEL e limite de sinal.
+ */
+typedef enum {
+  VL53L0X_PERFIL_RAPIDO = 0,     // ~20 ms por medição
+  VL53L0X_PERFIL_PADRAO,         // 33 ms (configuração de fábrica)
+  VL53L0X_PERFIL_PRECISAO,       // ~200 ms, menor ruído
+  VL53L0X_PERFIL_LONGO_ALCANCE,  // 33 ms, VCSEL 18/14 e limite de sinal 0.1 MCPS
+  VL53L0X_NUM_PERFIS
+} vl53l0x_profile;
+
+typedef enum {
+  VL53L0X_VCSEL_PRE_RANGE,
+  VL53L0X_VCSEL_FINAL_RANGE
+} vl53l0x_vcsel_period_type;
+
+/**
+ * @brief Bloco de resultado de uma medição, lido em uma única transação.
+ * Taxas em MCPS no formato Q9.7; SPADs efetivos em Q8.8.
+ */
+typedef struct {
+    uint16_t range_mm;
+    uint8_t range_status;   // Bits 6:3 = status do dispositivo (11 = medida válida)
+    uint16_t signal_rate;
+    uint16_t ambient_rate;
+    uint16_t spad_count;
+} vl53l0x_result;
+
+#define VL53L0X_RANGE_STATUS(r)   (((r)->range_status >> 3) & 0x0F)
+#define VL53L0X_STATUS_VALIDO     11
+#define VL53L0X_MCPS_Q7(mcps)     ((uint16_t)((mcps) * (1 << 7)))
 
 typedef struct {
     i2c_inst_t* i2c;
@@ -83,12 +152,39 @@ typedef struct {
     uint16_t io_timeout;
     uint8_t stop_variable;
     uint32_t measurement_timing_budget_us;
+    vl53l0x_int_mode int_mode;
+    vl53l0x_profile profile;
+    bool calibration_from_cache;
+    bool continuous;           // Medição contínua em andamento
+    uint32_t continuous_period_ms;
+    uint32_t i2c_transactions; // Contador de transações no barramento (diagnóstico).
+    uint32_t i2c_bytes;        // Bytes de dados trocados (inclui o índice do registrador).
 } vl53l0x_dev;
 
 // Funções públicas
+bool vl53l0x_wait_boot(i2c_inst_t* i2c_port, uint8_t address, uint32_t timeout_ms);
+bool vl53l0x_set_address(vl53l0x_dev* dev, uint8_t new_address);
 bool vl53l0x_init(vl53l0x_dev* dev, i2c_inst_t* i2c_port);
+bool vl53l0x_init_with_calibration(vl53l0x_dev* dev, i2c_inst_t* i2c_port,
+                                   const vl53l0x_calibration* cached, vl53l0x_calibration* out);
 uint16_t vl53l0x_read_range_single_millimeters(vl53l0x_dev* dev);
 void vl53l0x_start_continuous(vl53l0x_dev* dev, uint32_t period_ms);
+void vl53l0x_stop_continuous(vl53l0x_dev* dev);
 uint16_t vl53l0x_read_range_continuous_millimeters(vl53l0x_dev* dev);
 
+// Timing budget e perfis de medição
+bool vl53l0x_set_signal_rate_limit(vl53l0x_dev* dev, float limit_mcps);
+bool vl53l0x_set_measurement_timing_budget(vl53l0x_dev* dev, uint32_t budget_us);
+uint32_t vl53l0x_get_measurement_timing_budget(vl53l0x_dev* dev);
+bool vl53l0x_set_vcsel_pulse_period(vl53l0x_dev* dev, vl53l0x_vcsel_period_type type, uint8_t period_pclks);
+uint8_t vl53l0x_get_vcsel_pulse_period(vl53l0x_dev* dev, vl53l0x_vcsel_period_type type);
+bool vl53l0x_set_profile(vl53l0x_dev* dev, vl53l0x_profile profile);
+
+// Interrupção por limiar (janela de distância)
+void vl53l0x_set_interrupt_mode(vl53l0x_dev* dev, vl53l0x_int_mode mode,
+                                uint16_t low_mm, uint16_t high_mm);
+bool vl53l0x_data_ready(vl53l0x_dev* dev);
+bool vl53l0x_read_result(vl53l0x_dev* dev, vl53l0x_result* result);
+uint16_t vl53l0x_read_range_ready_millimeters(vl53l0x_dev* dev);
+
 #endif
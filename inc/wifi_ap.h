@@ -1,6 +1,12 @@
 #ifndef WIFI_AP_H
 #define WIFI_AP_H
 
+#include "dhcp_lease.h"
+#include "dnsserver.h"
+
 void wifi_ap_init(void);
+void wifi_ap_tarefa(void);
+const dhcp_lease_tabela_t *wifi_ap_leases(void);
+const dns_server_stats_t *wifi_ap_dns_stats(void);
 
 #endif
@@ -3,6 +3,9 @@
 #include "pico/stdlib.h"
 #include "hardware/pwm.h"
 #include "pico/cyw43_arch.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+#include "tusb.h"
 
 // === WIFI / HTTP ===
 #include "wifi_ap.h"
@@ -13,6 +16,18 @@
 #include "sensor_ultrasonico.h"
 #include "display.h"
 #include "parking_state.h"
+#include "boot.h"
+#include "aquisicao.h"
+#include "historico.h"
+#include "persistencia.h"
+#include "dhcp_persistencia.h"
+#include "estatisticas.h"
+#include "serie.h"
+#include "decisao.h"
+#include "trace.h"
+#include "rastro.h"
+#include "log.h"
+#include "metricas.h"
 
 // === PINOS ===
 #define SERVO_PIN 16
@@ -20,18 +35,9 @@
 #define BUZZER_LOC 10        // Localização
 
 
-// === LIMITES SERVO (Cancela) ===
-// LIMITE_FECHAR: Distância onde o carro já está estacionado ou saiu de vez
-// LIMITE_ABRIR: Distância da zona de "Atenção" onde a cancela deve subir
-#define LIMITE_FECHAR_MM 150 
-#define LIMITE_ABRIR_MM  600
-
-// === LIMITES BUZZER ===
-#define ZONA_LIVRE_MM    800  
-#define ZONA_PARADO_MM   150  
+// Limites da cancela e das zonas do buzzer: decisao.h
 
 // === INTERVALOS (ms) ===
-#define SENSOR_INTERVAL_MS   100 
 #define DISPLAY_INTERVAL_MS  500
 #define WIFI_LOOP_DELAY_MS   5
 
@@ -79,14 +85,58 @@ void buzzer_som(bool ligado) {
     else pwm_set_gpio_level(BUZZER_PIN, 0);
 }
 
+// ============================================================
+// BOOT (core1): sensores e display em paralelo com o Wi-Fi
+// ============================================================
+static vl53l0x_dev sensor_vlx;
+static ssd1306_t oled;
+static volatile bool core1_pronto = false;
+
+static void boot_core1(void) {
+    boot_fase_inicio(BOOT_FASE_SENSORES);
+    sensor_init(&sensor_vlx);
+#if SENSOR_BENCH_PERFIS
+    LOG_INFO("Barramento VL53L0X: %.1f amostras/s", sensor_measure_bus(&sensor_vlx, 1, 1000));
+#endif
+    sensor_set_attention_zone(&sensor_vlx, ZONA_PARADO_MM, ZONA_LIVRE_MM);
+#if SENSOR_BENCH_PERFIS
+    static const char *nomes_perfis[] = { "rapido", "padrao", "precisao", "longo" };
+    for (int p = 0; p < VL53L0X_NUM_PERFIS; p++) {
+        sensor_perfil_medida_t m;
+        sensor_measure_profile(&sensor_vlx, p, 50, &m);
+        LOG_INFO("Perfil %-8s budget=%luus taxa=%.1fHz intervalo=%lu [%lu..%lu]us jitter=%luus",
+               nomes_perfis[p], m.budget_us, m.taxa_hz, m.intervalo_medio_us,
+               m.intervalo_min_us, m.intervalo_max_us, m.jitter_us);
+    }
+#endif
+    boot_fase_fim(BOOT_FASE_SENSORES);
+
+    // Display (i2c1) não disputa o barramento do sensor (i2c0)
+    boot_fase_inicio(BOOT_FASE_DISPLAY);
+    display_init(&oled);
+    boot_fase_fim(BOOT_FASE_DISPLAY);
+
+    __dmb();
+    core1_pronto = true;
+    __sev();
+}
+
 // ============================================================
 // MAIN
 // ============================================================
 int main() {
+    log_init();
+    rastro_init();
+    vaga_init(&vaga1_status);
+    vaga_init(&vaga2_status);
+    boot_fase_inicio(BOOT_FASE_STDIO);
     stdio_init_all();
+#if !BOOT_RAPIDO
     sleep_ms(2000);
+#endif
+    boot_fase_fim(BOOT_FASE_STDIO);
 
-    printf("=== Sistema de Cancela Ativa ===\n");
+    LOG_INFO("=== Sistema de Cancela Ativa ===");
 
     // GPIOs
     gpio_init(LED_VERDE);
@@ -94,167 +144,193 @@ int main() {
     gpio_init(LED_VERMELHO);
     gpio_set_dir(LED_VERMELHO, GPIO_OUT);
 
+    // Sensores e display sobem no core1 enquanto o core0 carrega o firmware do CYW43
+    multicore_launch_core1(boot_core1);
+
     // WiFi
+    boot_fase_inicio(BOOT_FASE_WIFI);
     if (cyw43_arch_init()) {
         printf("Erro CYW43\n");
         return -1;
     }
     wifi_ap_init();
-    http_server_init();
-
-    // Sensores
-    vl53l0x_dev sensor_vlx;
-    sensor_init(&sensor_vlx);
-    sensor_ultrasonico_init();
+    boot_fase_fim(BOOT_FASE_WIFI);
 
-    // Display
-    ssd1306_t oled;
-    display_init(&oled);
+    boot_fase_inicio(BOOT_FASE_HTTP);
+    http_server_init();
+    boot_fase_fim(BOOT_FASE_HTTP);
 
     // Atuadores
+    boot_fase_inicio(BOOT_FASE_ATUADORES);
     servo_init();
     buzzer_init_pwm(); 
-
-    //  SERVO
-    servo_set_angle(0);   
+    servo_set_angle(0);
+#if !BOOT_RAPIDO
+    //  SERVO (autoteste)
     sleep_ms(1000);
     servo_set_angle(90);  
     sleep_ms(1000);
     servo_set_angle(0);   
+#endif
+    boot_fase_fim(BOOT_FASE_ATUADORES);
+
+    // O timer que agenda os disparos do ultrassônico precisa ficar no core0
+    sensor_ultrasonico_init();
 
-    bool servo_fechado = false;
-    absolute_time_t last_beep_time = 0;
-    bool beep_on = false;
-    absolute_time_t last_sensor_time = 0;
+    // Espera o core1 mantendo o AP atendendo (DHCP/DNS/HTTP)
+    boot_fase_inicio(BOOT_FASE_ESPERA_CORE1);
+    while (!core1_pronto) {
+        cyw43_arch_poll();
+        log_tarefa();
+    }
+    __dmb();
+    multicore_reset_core1();
+    boot_fase_fim(BOOT_FASE_ESPERA_CORE1);
+
+    // Com o core1 parado a flash pode ser gravada com segurança
+    sensor_commit_calibration();
+
+    // Estado das vagas e histórico de antes do último reset
+    boot_fase_inicio(BOOT_FASE_RECUPERACAO);
+    persistencia_init();
+    estatisticas_init(1, vaga1_status.ocupada, vaga_tempo_ocupada_ms(&vaga1_status));
+    estatisticas_init(2, vaga2_status.ocupada, vaga_tempo_ocupada_ms(&vaga2_status));
+    boot_fase_fim(BOOT_FASE_RECUPERACAO);
+
+    // Canais de aquisição: disparados juntos a cada tick
+    int canal_vaga1 = aquisicao_adicionar_vl53l0x(&sensor_vlx);
+    int canal_vaga2 = aquisicao_adicionar_ultrassonico(0);
+    aquisicao_set_zonas(ZONA_PARADO_MM, ZONA_LIVRE_MM);
+
+    boot_fase_inicio(BOOT_FASE_PRIMEIRA_DECISAO);
+    bool boot_impresso = false;
+
+    static decisao_t decisao;
+    decisao_init(&decisao);
+    uint8_t servo_graus = 0;
     absolute_time_t last_display_time = 0;
 
     uint16_t d1 = 9999; 
     uint16_t d2 = 9999; 
-    static int leituras_vaga_ocupada = 0;
-    static uint16_t d2_estavel = 9999;
 
     while (true) {
+        METRICA_INICIO(laco);
+
+        METRICA_INICIO(poll);
         cyw43_arch_poll();
+        wifi_ap_tarefa();
+        METRICA_FIM(poll, ETAPA_CYW43_POLL);
 
-        if (absolute_time_diff_us(last_sensor_time, get_absolute_time()) >= SENSOR_INTERVAL_MS * 1000) {
-            last_sensor_time = get_absolute_time();
+        // Cada canal tem seu próprio ritmo: rápido em manobra, lento com a vaga estável
+        if (!aquisicao_em_andamento() && aquisicao_devida()) {
+            aquisicao_iniciar();
+        }
 
-            // Leitura Vaga 1 (Laser)
-            d1 = sensor_read_distance(&sensor_vlx);
-            float ultra_cm = sensor_ultrasonico_ler_distancia_cm();
-            uint16_t d2_atual;
+        // A lógica roda quando o conjunto de leituras do tick está completo
+        aquisicao_conjunto_t amostras;
+        if (aquisicao_coletar(&amostras)) {
+            METRICA_INICIO(decisao);
 
-            // 1. Tratamento de erro 
-            if (ultra_cm <= 2.0f || ultra_cm > 40.0f) { 
-                d2_atual = 9999; 
-            } else {
-                d2_atual = (uint16_t)(ultra_cm * 10.0f); 
-            }
+            bool amostra_vlx = amostras.canal[canal_vaga1].nova;
 
-            // 2. Filtro de Confirmação (Igual ao comportamento do VLX, mas sem ruído)
-            if (abs(d2_atual - d2_estavel) > 50) { // Diferença maior que 5cm
-                leituras_vaga_ocupada++;
-                if (leituras_vaga_ocupada >= 3) { // Só aceita a nova distância após 3 leituras consistentes
-                    d2_estavel = d2_atual;
-                    leituras_vaga_ocupada = 0;
+            // Séries temporais com as distâncias brutas, antes de qualquer filtro
+            for (uint8_t i = 0; i < amostras.n_canais; i++) {
+                if (amostras.canal[i].nova) {
+                    serie_registrar(i, amostras.canal[i].distancia_mm, amostras.canal[i].t_us);
                 }
-            } else {
-                d2_estavel = d2_atual; // Se for parecido, atualiza direto para manter precisão
-                leituras_vaga_ocupada = 0;
             }
 
-            d2 = d2_estavel;
-
-            vaga1_status.ocupada = (d1 < ZONA_PARADO_MM);
-            if (vaga1_status.ocupada) vaga1_status.tempo_ocupada_ms += SENSOR_INTERVAL_MS;
-            else vaga1_status.tempo_ocupada_ms = 0;
-
-            vaga2_status.ocupada = (d2 < ZONA_PARADO_MM);
-            if (vaga2_status.ocupada) vaga2_status.tempo_ocupada_ms += SENSOR_INTERVAL_MS;
-            else vaga2_status.tempo_ocupada_ms = 0;
-
-            // --- LÓGICA DE LOCALIZAÇÃO ---
-            static absolute_time_t localizar_timeout = 0;
-            static int localizar_beeps = 0;
-
-            if (localizar_vaga1 || localizar_vaga2) {
-                if ((localizar_vaga1 && vaga1_status.ocupada) || (localizar_vaga2 && vaga2_status.ocupada)) {
-                    localizar_beeps = 6; 
-                }
-                localizar_vaga1 = false; 
-                localizar_vaga2 = false;
+            // Entradas do ciclo: fora da zona de atenção o laser mantém a última
+            // distância válida; o ultrassônico só conta quando há eco novo.
+            decisao_entrada_t entrada = {
+                .t_us = amostras.fim_us,
+                .d1_mm = amostras.canal[canal_vaga1].distancia_mm,
+                .d2_mm = amostras.canal[canal_vaga2].distancia_mm,
+                .d2_nova = amostras.canal[canal_vaga2].nova,
+                .localizar = { localizar_vaga1, localizar_vaga2 },
+                .d1_t_us = amostras.canal[canal_vaga1].t_us,
+                .d2_t_us = amostras.canal[canal_vaga2].t_us,
+                .localizar_us = localizar_pedido_us,
+            };
+            localizar_vaga1 = false;
+            localizar_vaga2 = false;
+            localizar_pedido_us = 0;
+
+            // O trace guarda exatamente o que a decisão recebe (replay no PC)
+            trace_registrar_ciclo(&decisao, &entrada);
+            const decisao_saida_t *saida = decisao_passo(&decisao, &entrada);
+            d1 = saida->d1_mm;
+            d2 = saida->d2_mm;
+
+            // Transições marcadas com o instante do ciclo; a permanência é calculada na consulta
+            absolute_time_t agora_ciclo = from_us_since_boot(amostras.fim_us);
+            historico_observar(1, d1);
+            historico_observar(2, d2);
+            if (vaga_atualizar(&vaga1_status, saida->vaga_ocupada[0], agora_ciclo)) {
+                metricas_latencia_pendente(LATENCIA_HTTP_ESTADO, saida->d1_t_us);
+                estatisticas_transicao(1, vaga1_status.ocupada, amostras.fim_us);
+                persistencia_evento(historico_registrar(1, vaga1_status.ocupada ? EVENTO_CHEGADA : EVENTO_SAIDA,
+                                                        amostras.fim_us));
             }
-
-            if (localizar_beeps > 0) {
-                if (absolute_time_diff_us(localizar_timeout, get_absolute_time()) >= 200 * 1000) {
-                    localizar_timeout = get_absolute_time();
-                    if (localizar_beeps % 2 != 0) pwm_set_gpio_level(BUZZER_LOC, 1000); 
-                    else { pwm_set_gpio_level(BUZZER_LOC, 0); pwm_set_gpio_level(BUZZER_PIN, 0); }
-                    localizar_beeps--;
-                    if (localizar_beeps == 0) {
-                        pwm_set_gpio_level(BUZZER_LOC, 0);
-                        pwm_set_gpio_level(BUZZER_PIN, 0);
-                        beep_on = false;
-                    }
-                }
+            if (vaga_atualizar(&vaga2_status, saida->vaga_ocupada[1], agora_ciclo)) {
+                metricas_latencia_pendente(LATENCIA_HTTP_ESTADO, saida->d2_t_us);
+                estatisticas_transicao(2, vaga2_status.ocupada, amostras.fim_us);
+                persistencia_evento(historico_registrar(2, vaga2_status.ocupada ? EVENTO_CHEGADA : EVENTO_SAIDA,
+                                                        amostras.fim_us));
             }
 
-            // --- LÓGICA DA CANCELA (4 MOVIMENTOS) ---
-            
-            // Filtro para o laser (65535 vira 9999)
-            uint16_t d1_limpo = (d1 >= 60000) ? 9999 : d1;
-            uint16_t d2_limpo = d2;
-
-            // Detecta se o carro está na zona de "Atenção" (entre estacionado e livre)
-            bool movendo_s1 = (d1_limpo > LIMITE_FECHAR_MM && d1_limpo < LIMITE_ABRIR_MM);
-            bool movendo_s2 = (d2_limpo > LIMITE_FECHAR_MM && d2_limpo < LIMITE_ABRIR_MM);
-
-            if (movendo_s1 || movendo_s2) {
-                // ABRE na entrada ou na saída (quando detecta movimento na zona de atenção)
-                if (!servo_fechado) {
-                    servo_set_angle(90);
-                    servo_fechado = true;
-                }
-            } 
-            else if (d1_limpo <= LIMITE_FECHAR_MM || d2_limpo <= LIMITE_FECHAR_MM || 
-                    (d1_limpo >= LIMITE_ABRIR_MM && d2_limpo >= LIMITE_ABRIR_MM)) {
-                // FECHA quando estacionar ou quando sair completamente
-                if (servo_fechado) {
-                    sleep_ms(300); // Garante que o carro terminou o movimento
-                    servo_set_angle(0);
-                    servo_fechado = false;
-                }
+            // --- ATUADORES ---
+            if (saida->servo_graus != servo_graus) {
+                servo_graus = saida->servo_graus;
+                servo_set_angle(servo_graus);
             }
+            gpio_put(LED_VERMELHO, saida->led_vermelho);
+            gpio_put(LED_VERDE, saida->led_verde);
+            buzzer_som(saida->buzzer_manobra);
+            pwm_set_gpio_level(BUZZER_LOC, saida->buzzer_localizar ? 1000 : 0);
+
+            // Latência de ponta a ponta: amostra (ou pedido) -> atuador já comandado
+            metricas_latencia(LATENCIA_CANCELA_ABRIR, saida->origem_abrir_us);
+            metricas_latencia(LATENCIA_CANCELA_FECHAR, saida->origem_fechar_us);
+            metricas_latencia(LATENCIA_BEEP_MANOBRA, saida->origem_beep_us);
+            metricas_latencia(LATENCIA_BEEP_LOCALIZAR, saida->origem_localizar_us);
+
+            // Primeira decisão tomada com uma amostra real do laser
+            if (amostra_vlx && !boot_concluido()) boot_fase_fim(BOOT_FASE_PRIMEIRA_DECISAO);
+            METRICA_FIM(decisao, ETAPA_DECISAO);
+        }
 
-            // --- LÓGICA DO LED (CORRIGIDA) ---
-            // Se qualquer vaga estiver abaixo do limite de "Livre", o LED fica vermelho
-            if (d1_limpo < ZONA_LIVRE_MM || d2_limpo < ZONA_LIVRE_MM) {
-                gpio_put(LED_VERMELHO, 1);
-                gpio_put(LED_VERDE, 0);
-            } else {
-                // Se ambas as vagas estiverem livres (acima de 800mm)
-                gpio_put(LED_VERMELHO, 0);
-                gpio_put(LED_VERDE, 1);
-            }
+        // Lotes de eventos e estado das vagas vão para a flash página a página
+        METRICA_INICIO(persistencia);
+        persistencia_tarefa();
+        dhcp_persistencia_tarefa();
+        METRICA_FIM(persistencia, ETAPA_PERSISTENCIA);
+
+        // Mensagens de log pendentes, só o que couber na CDC sem esperar
+        log_tarefa();
+
+        // Trace binário na CDC USB (ligado por /trace?ligar=1), um pacote por volta;
+        // o despejo do rastro de eventos (/rastro) usa as voltas em que o trace está vazio.
+        // Só quadros inteiros e só o que cabe na CDC agora: putchar_raw não espera.
+        if (stdio_usb_connected()) {
+            uint8_t pedaco[64];
+            uint32_t livre = tud_cdc_write_available();
+            size_t max = (livre < sizeof(pedaco)) ? livre : sizeof(pedaco);
+            size_t n = trace_ler(pedaco, max);
+            if (n == 0) n = rastro_ler(pedaco, max);
+            for (size_t i = 0; i < n; i++) putchar_raw(pedaco[i]);
+        }
 
-            // --- BUZZER MANOBRA ---
-            if (d1 <= ZONA_PARADO_MM || d2 <= ZONA_PARADO_MM) {
-                buzzer_som(false); beep_on = false;
-            } else if ((d1 > ZONA_PARADO_MM && d1 < ZONA_LIVRE_MM) || (d2 > ZONA_PARADO_MM && d2 < ZONA_LIVRE_MM)) {
-                uint16_t dist = (d1 < d2) ? d1 : d2;
-                int intervalo = dist / 1.5f;
-                if (intervalo < 40) intervalo = 40;
-                if (absolute_time_diff_us(last_beep_time, get_absolute_time()) >= intervalo * 1000) {
-                    beep_on = !beep_on; buzzer_som(beep_on); last_beep_time = get_absolute_time();
-                }
-            } else {
-                buzzer_som(false); beep_on = false;
-            }
+        // Relatório de boot assim que houver um terminal USB conectado
+        if (!boot_impresso && boot_concluido() && stdio_usb_connected()) {
+            boot_imprimir();
+            boot_impresso = true;
         }
 
         // --- DISPLAY ---
-        if (absolute_time_diff_us(last_display_time, get_absolute_time()) >= DISPLAY_INTERVAL_MS * 1000) {
+        if (oled.ram_buffer && absolute_time_diff_us(last_display_time, get_absolute_time()) >= DISPLAY_INTERVAL_MS * 1000) {
             last_display_time = get_absolute_time();
+            METRICA_INICIO(display);
 
             memset(oled.ram_buffer + 1, 0, oled.bufsize - 1);
             char txt1[32], txt2[32];
@@ -267,8 +343,11 @@ int main() {
             ssd1306_draw_string(oled.ram_buffer + 1, 5, 10, txt1);
             ssd1306_draw_string(oled.ram_buffer + 1, 5, 40, txt2);
             ssd1306_send_data(&oled); 
+            METRICA_FIM(display, ETAPA_DISPLAY);
         }
 
+        METRICA_FIM(laco, ETAPA_LACO);
+
         sleep_ms(WIFI_LOOP_DELAY_MS);
     }
 }
\ No newline at end of file
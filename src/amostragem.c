@@ -0,0 +1,91 @@
+#include "amostragem.h"
+
+// Rápido na zona de atenção; fora dela o intervalo dobra a cada
+// AMOSTRAGEM_ESTAVEIS amostras na mesma zona, até AMOSTRAGEM_LENTA_MAX_MS.
+// Qualquer troca de zona volta imediatamente para o intervalo rápido.
+
+static amostragem_zona_t classificar(const amostragem_canal_t *c, uint16_t mm) {
+    if (mm <= c->parado_mm) return AMOSTRAGEM_ZONA_PARADO;
+    if (mm >= c->livre_mm) return AMOSTRAGEM_ZONA_LIVRE;
+    return AMOSTRAGEM_ZONA_ATENCAO;
+}
+
+void amostragem_init(amostragem_canal_t *c, uint16_t parado_mm, uint16_t livre_mm) {
+    c->parado_mm = parado_mm;
+    c->livre_mm = livre_mm;
+    c->zona = AMOSTRAGEM_ZONA_ATENCAO;   // Até a primeira amostra, trata como manobra
+    c->intervalo_ms = AMOSTRAGEM_RAPIDA_MS;
+    c->estaveis = 0;
+    c->inicio_us = 0;
+    c->ultima_us = 0;
+    c->proxima_us = 0;
+    c->amostras = 0;
+    c->transicoes = 0;
+    c->atraso_max_us = 0;
+}
+
+bool amostragem_devida(const amostragem_canal_t *c, uint64_t agora_us) {
+    return agora_us >= c->proxima_us;
+}
+
+// Mais uma confirmação de que o canal segue na mesma zona fora da atenção
+static void estavel(amostragem_canal_t *c) {
+    if (++c->estaveis >= AMOSTRAGEM_ESTAVEIS) {
+        c->estaveis = 0;
+        c->intervalo_ms *= 2;
+        if (c->intervalo_ms > AMOSTRAGEM_LENTA_MAX_MS) c->intervalo_ms = AMOSTRAGEM_LENTA_MAX_MS;
+    }
+}
+
+// Registra uma amostra e agenda a próxima. Retorna true se o intervalo mudou.
+bool amostragem_registrar(amostragem_canal_t *c, uint16_t mm, uint64_t agora_us) {
+    amostragem_zona_t zona = classificar(c, mm);
+    uint32_t anterior = c->intervalo_ms;
+
+    if (c->amostras == 0) {
+        c->inicio_us = agora_us;
+    } else if (zona != c->zona) {
+        // A troca aconteceu em algum ponto desde a amostra anterior:
+        // o intervalo entre as duas é o pior caso do atraso de detecção.
+        uint32_t atraso = (uint32_t)(agora_us - c->ultima_us);
+        if (atraso > c->atraso_max_us) c->atraso_max_us = atraso;
+        c->transicoes++;
+    }
+    c->amostras++;
+
+    if (zona == AMOSTRAGEM_ZONA_ATENCAO || zona != c->zona) {
+        c->intervalo_ms = AMOSTRAGEM_RAPIDA_MS;
+        c->estaveis = 0;
+    } else {
+        estavel(c);
+    }
+
+    c->zona = zona;
+    c->ultima_us = agora_us;
+    c->proxima_us = agora_us + (uint64_t)c->intervalo_ms * 1000;
+    return c->intervalo_ms != anterior;
+}
+
+// Consulta sem amostra nova: só agenda a próxima, sem contar amostra nem
+// avançar o backoff (a distância conhecida é a mesma de antes)
+void amostragem_adiar(amostragem_canal_t *c, uint64_t agora_us) {
+    c->proxima_us = agora_us + (uint64_t)c->intervalo_ms * 1000;
+}
+
+// Consulta sem amostra com o sensor num modo de limiar: ele só gera amostra
+// ao cruzar o limite da zona, então o silêncio confirma a zona atual e o
+// backoff avança como se uma amostra igual tivesse chegado. Retorna true se
+// o intervalo mudou.
+bool amostragem_confirmar(amostragem_canal_t *c, uint64_t agora_us) {
+    uint32_t anterior = c->intervalo_ms;
+
+    if (c->amostras > 0 && c->zona != AMOSTRAGEM_ZONA_ATENCAO) estavel(c);
+    amostragem_adiar(c, agora_us);
+    return c->intervalo_ms != anterior;
+}
+
+// Quantas amostras a taxa fixa antiga teria feito no mesmo período
+uint32_t amostragem_base(const amostragem_canal_t *c, uint64_t agora_us) {
+    if (c->amostras == 0) return 0;
+    return (uint32_t)((agora_us - c->inicio_us) / (AMOSTRAGEM_BASE_MS * 1000)) + 1;
+}
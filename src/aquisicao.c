@@ -0,0 +1,200 @@
+#include <string.h>
+#include "pico/stdlib.h"
+
+#include "aquisicao.h"
+#include "sensor.h"
+#include "sensor_ultrasonico.h"
+#include "amostragem.h"
+#include "metricas.h"
+
+// Todos os canais são consultados juntos e concluem de forma independente:
+// a latência do ciclo é a do canal mais lento, não a soma de todos.
+// VL53L0X e ultrassônicos medem sozinhos (modo contínuo / agendamento do PIO).
+// Com zonas definidas, cada canal segue a própria política de amostragem:
+// só é consultado (VL53L0X) ou disparado (ultrassônico) quando está na hora.
+
+typedef struct {
+    canal_tipo_t tipo;
+    vl53l0x_dev *dev;        // Só para CANAL_VL53L0X
+    uint8_t canal_ultra;     // Só para CANAL_ULTRASSONICO
+    amostragem_canal_t politica;
+    bool devido;             // Participa do ciclo atual
+    bool concluido;
+} canal_t;
+
+static canal_t canais[AQUISICAO_MAX_CANAIS];
+static uint8_t n_canais = 0;
+
+static aquisicao_conjunto_t atual;
+static bool em_andamento = false;
+static aquisicao_stats_t stats;
+static bool adaptativo = false;
+
+// ================= CANAIS =================
+
+static int adicionar(canal_tipo_t tipo, vl53l0x_dev *dev, uint8_t canal_ultra) {
+    if (n_canais >= AQUISICAO_MAX_CANAIS) return -1;
+
+    canais[n_canais].tipo = tipo;
+    canais[n_canais].dev = dev;
+    canais[n_canais].canal_ultra = canal_ultra;
+    atual.canal[n_canais].distancia_mm = SENSOR_SEM_ALVO;
+    return n_canais++;
+}
+
+int aquisicao_adicionar_vl53l0x(vl53l0x_dev *dev) {
+    return adicionar(CANAL_VL53L0X, dev, 0);
+}
+
+int aquisicao_adicionar_ultrassonico(uint8_t canal_ultra) {
+    return adicionar(CANAL_ULTRASSONICO, NULL, canal_ultra);
+}
+
+void aquisicao_set_zonas(uint16_t parado_mm, uint16_t livre_mm) {
+    for (int i = 0; i < n_canais; i++) {
+        amostragem_init(&canais[i].politica, parado_mm, livre_mm);
+        if (canais[i].tipo == CANAL_ULTRASSONICO) {
+            sensor_ultrasonico_set_intervalo(canais[i].canal_ultra, canais[i].politica.intervalo_ms);
+        }
+    }
+    adaptativo = true;
+}
+
+const amostragem_canal_t *aquisicao_get_amostragem(int canal) {
+    return (canal >= 0 && canal < n_canais) ? &canais[canal].politica : NULL;
+}
+
+// ================= CICLO =================
+
+// O ultrassônico entra no ciclo quando o PIO entrega um eco novo (os disparos
+// já seguem a política); o VL53L0X quando chega a hora da próxima consulta.
+static bool canal_devido(const canal_t *c, uint64_t agora) {
+    if (c->tipo == CANAL_ULTRASSONICO) return sensor_ultrasonico_pendente(c->canal_ultra);
+    return amostragem_devida(&c->politica, agora);
+}
+
+bool aquisicao_devida(void) {
+    uint64_t agora = time_us_64();
+    for (int i = 0; i < n_canais; i++) {
+        if (canal_devido(&canais[i], agora)) return true;
+    }
+    return false;
+}
+
+void aquisicao_iniciar(void) {
+    atual.inicio_us = time_us_64();
+    atual.n_canais = n_canais;
+
+    uint64_t atraso = 0;     // Quanto o tick escorregou (canal consultado mais atrasado)
+    for (int i = 0; i < n_canais; i++) {
+        canais[i].devido = canal_devido(&canais[i], atual.inicio_us);
+        canais[i].concluido = !canais[i].devido;
+        atual.canal[i].nova = false;
+        if (canais[i].devido && canais[i].tipo == CANAL_VL53L0X &&
+            atual.inicio_us - canais[i].politica.proxima_us > atraso) {
+            atraso = atual.inicio_us - canais[i].politica.proxima_us;
+        }
+    }
+    RASTRO(RASTRO_AQUISICAO_INICIO, (uint32_t)(atraso > RASTRO_ARG_MAX ? RASTRO_ARG_MAX : atraso));
+    em_andamento = true;
+}
+
+// Alimenta a política com a distância corrente do canal e repassa ao
+// ultrassônico o novo espaçamento dos disparos.
+static void atualizar_politica(canal_t *c, uint16_t mm, uint64_t agora) {
+    if (!adaptativo) {
+        c->politica.proxima_us = agora + AMOSTRAGEM_BASE_MS * 1000;
+        return;
+    }
+    if (amostragem_registrar(&c->politica, mm, agora) && c->tipo == CANAL_ULTRASSONICO) {
+        sensor_ultrasonico_set_intervalo(c->canal_ultra, c->politica.intervalo_ms);
+    }
+}
+
+// Consulta que não trouxe amostra: a próxima fica para depois do intervalo
+// atual. Num modo de limiar o VL53L0X só gera amostra ao cruzar a zona, então
+// o silêncio conta como confirmação da zona e o backoff avança.
+static void adiar_politica(canal_t *c, uint64_t agora) {
+    if (!adaptativo) {
+        c->politica.proxima_us = agora + AMOSTRAGEM_BASE_MS * 1000;
+        return;
+    }
+    if (c->dev->int_mode != VL53L0X_INT_NOVA_AMOSTRA) {
+        amostragem_confirmar(&c->politica, agora);
+    } else {
+        amostragem_adiar(&c->politica, agora);
+    }
+}
+
+bool aquisicao_em_andamento(void) {
+    return em_andamento;
+}
+
+static bool coletar_canal(int i) {
+    canal_t *c = &canais[i];
+    leitura_t *l = &atual.canal[i];
+
+    switch (c->tipo) {
+        case CANAL_VL53L0X: {
+            // Sem amostra pronta (ou fora da zona de atenção) mantém a anterior.
+            // Nos modos de limiar "sem amostra" também significa "sem mudança de zona".
+            uint16_t mm;
+            METRICA_INICIO(vl53l0x);
+            bool pronta = sensor_poll_distance(c->dev, &mm);
+            METRICA_FIM(vl53l0x, ETAPA_VL53L0X);
+            if (pronta) {
+                l->distancia_mm = mm;
+                l->nova = true;
+                l->t_us = time_us_64();
+                atualizar_politica(c, mm, l->t_us);
+            } else {
+                adiar_politica(c, time_us_64());
+            }
+            return true;
+        }
+        case CANAL_ULTRASSONICO: {
+            // Os disparos seguem o agendamento do PIO; aqui só se recolhe o último eco.
+            float cm;
+            if (sensor_ultrasonico_resultado(c->canal_ultra, &cm)) {
+                l->distancia_mm = (cm < 0) ? SENSOR_SEM_ALVO : (uint16_t)(cm * 10.0f);
+                l->nova = true;
+                l->t_us = time_us_64();
+                atualizar_politica(c, l->distancia_mm, l->t_us);
+            }
+            return true;
+        }
+    }
+    return true;
+}
+
+bool aquisicao_coletar(aquisicao_conjunto_t *conjunto) {
+    if (!em_andamento) return false;
+
+    bool todos = true;
+    for (int i = 0; i < n_canais; i++) {
+        if (!canais[i].concluido) canais[i].concluido = coletar_canal(i);
+        todos &= canais[i].concluido;
+    }
+    if (!todos) return false;
+
+    atual.fim_us = time_us_64();
+    em_andamento = false;
+
+    uint32_t novas = 0;
+    for (int i = 0; i < n_canais; i++) {
+        if (atual.canal[i].nova) novas |= 1u << i;
+    }
+    RASTRO(RASTRO_AQUISICAO_FIM, novas);
+
+    uint32_t latencia = (uint32_t)(atual.fim_us - atual.inicio_us);
+    stats.ciclos++;
+    stats.latencia_total_us += latencia;
+    if (latencia > stats.latencia_max_us) stats.latencia_max_us = latencia;
+
+    *conjunto = atual;
+    return true;
+}
+
+const aquisicao_stats_t *aquisicao_get_stats(void) {
+    return &stats;
+}
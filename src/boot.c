@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+#include "boot.h"
+
+// Instantes (µs desde o power-on) de início e fim de cada fase
+typedef struct {
+    uint64_t inicio_us;
+    uint64_t fim_us;
+} boot_marca_t;
+
+static volatile boot_marca_t marcas[BOOT_NUM_FASES];
+
+static const char *nomes[BOOT_NUM_FASES] = {
+    [BOOT_FASE_STDIO]            = "stdio",
+    [BOOT_FASE_WIFI]             = "wifi ap",
+    [BOOT_FASE_HTTP]             = "http",
+    [BOOT_FASE_SENSORES]         = "sensores (core1)",
+    [BOOT_FASE_DISPLAY]          = "display (core1)",
+    [BOOT_FASE_ATUADORES]        = "atuadores",
+    [BOOT_FASE_ESPERA_CORE1]     = "espera core1",
+    [BOOT_FASE_RECUPERACAO]      = "recuperacao log",
+    [BOOT_FASE_PRIMEIRA_DECISAO] = "primeira decisao",
+};
+
+// ================= MARCAÇÃO =================
+// Cada fase é escrita por um único núcleo, então não há disputa.
+
+void boot_fase_inicio(boot_fase_t fase) {
+    marcas[fase].inicio_us = time_us_64();
+}
+
+void boot_fase_fim(boot_fase_t fase) {
+    marcas[fase].fim_us = time_us_64();
+}
+
+bool boot_concluido(void) {
+    return marcas[BOOT_FASE_PRIMEIRA_DECISAO].fim_us != 0;
+}
+
+// ================= RELATÓRIO =================
+
+void boot_imprimir(void) {
+    printf("=== Tempos de boot (ms desde o power-on) ===\n");
+    for (int i = 0; i < BOOT_NUM_FASES; i++) {
+        uint64_t ini = marcas[i].inicio_us, fim = marcas[i].fim_us;
+        printf("%-18s %7.1f -> %7.1f  (%6.1f ms)\n", nomes[i],
+               ini / 1000.0f, fim / 1000.0f, (fim >= ini) ? (fim - ini) / 1000.0f : 0.0f);
+    }
+}
@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "decisao.h"
+
+#define LOCALIZAR_BEEPS        6
+#define LOCALIZAR_PERIODO_US   (200 * 1000)
+#define BEEP_INTERVALO_MIN_MS  40
+
+void decisao_init(decisao_t *d) {
+    memset(d, 0, sizeof(*d));
+    d->d2_estavel = DECISAO_SEM_LEITURA;
+    d->saida.d1_mm = DECISAO_SEM_LEITURA;
+    d->saida.d2_mm = DECISAO_SEM_LEITURA;
+}
+
+// ================= FILTRO DO ULTRASSÔNICO =================
+
+// Só ecos novos contam: o ciclo pode ter sido disparado pelo laser.
+// O instante de uma mudança aceita é o da primeira leitura divergente.
+static uint16_t filtrar_d2(decisao_t *d, const decisao_entrada_t *e) {
+    if (!e->d2_nova) return d->d2_estavel; // Mantém o valor confirmado
+
+    // 1. Tratamento de erro (sem eco, perto demais ou fora do alcance útil)
+    uint16_t d2_atual = (e->d2_mm == 0xFFFF || e->d2_mm <= 20 || e->d2_mm > 400)
+                      ? DECISAO_SEM_LEITURA : e->d2_mm;
+
+    // 2. Filtro de confirmação: diferença maior que 5 cm só é aceita após 3 leituras
+    if (abs(d2_atual - d->d2_estavel) > 50) {
+        if (d->leituras_divergentes == 0) d->d2_divergente_us = e->d2_t_us;
+        if (++d->leituras_divergentes >= 3) {
+            d->d2_estavel = d2_atual;
+            d->d2_estavel_us = d->d2_divergente_us;
+            d->leituras_divergentes = 0;
+        }
+    } else {
+        d->d2_estavel = d2_atual; // Se for parecido, atualiza direto para manter precisão
+        d->d2_estavel_us = e->d2_t_us;
+        d->leituras_divergentes = 0;
+    }
+    return d->d2_estavel;
+}
+
+// ================= PASSO =================
+
+static uint64_t mais_antiga(uint64_t a, uint64_t b) {
+    return (a < b) ? a : b;
+}
+
+static uint64_t mais_recente(uint64_t a, uint64_t b) {
+    return (a > b) ? a : b;
+}
+
+const decisao_saida_t *decisao_passo(decisao_t *d, const decisao_entrada_t *e) {
+    decisao_saida_t *s = &d->saida;
+    uint16_t d1 = e->d1_mm;
+    uint16_t d2 = filtrar_d2(d, e);
+
+    s->d1_mm = d1;
+    s->d2_mm = d2;
+    s->d1_t_us = e->d1_t_us;
+    s->d2_t_us = d->d2_estavel_us;
+    s->vaga_ocupada[0] = d1 < ZONA_PARADO_MM;
+    s->vaga_ocupada[1] = d2 < ZONA_PARADO_MM;
+    s->origem_abrir_us = s->origem_fechar_us = 0;
+    s->origem_beep_us = s->origem_localizar_us = 0;
+
+    // --- LOCALIZAÇÃO ---
+    if ((e->localizar[0] && s->vaga_ocupada[0]) || (e->localizar[1] && s->vaga_ocupada[1])) {
+        d->localizar_beeps = LOCALIZAR_BEEPS;
+        d->localizar_origem_us = e->localizar_us;
+    }
+    if (d->localizar_beeps > 0 && e->t_us - d->localizar_ultimo_us >= LOCALIZAR_PERIODO_US) {
+        d->localizar_ultimo_us = e->t_us;
+        if (d->localizar_beeps % 2 != 0) {
+            s->buzzer_localizar = true;
+            s->origem_localizar_us = d->localizar_origem_us;
+            d->localizar_origem_us = 0;
+        } else {
+            s->buzzer_localizar = false;
+            s->buzzer_manobra = false;
+        }
+        if (--d->localizar_beeps == 0) {
+            s->buzzer_localizar = false;
+            s->buzzer_manobra = false;
+            d->beep_on = false;
+        }
+    }
+
+    // --- CANCELA (4 MOVIMENTOS) ---
+    // Filtro para o laser (65535 vira 9999)
+    uint16_t d1_limpo = (d1 >= 60000) ? DECISAO_SEM_LEITURA : d1;
+    uint16_t d2_limpo = d2;
+
+    // Carro na zona de "Atenção" (entre estacionado e livre)
+    bool movendo_s1 = (d1_limpo > LIMITE_FECHAR_MM && d1_limpo < LIMITE_ABRIR_MM);
+    bool movendo_s2 = (d2_limpo > LIMITE_FECHAR_MM && d2_limpo < LIMITE_ABRIR_MM);
+
+    if (d->fechando && e->t_us >= d->fechar_em_us) {
+        s->servo_graus = 0;
+        s->origem_fechar_us = d->fechar_origem_us;
+        d->cancela_aberta = false;
+        d->fechando = false;
+    }
+
+    if (movendo_s1 || movendo_s2) {
+        // ABRE na entrada ou na saída
+        if (!d->cancela_aberta) {
+            s->servo_graus = 90;
+            s->origem_abrir_us = (movendo_s1 && movendo_s2) ? mais_antiga(s->d1_t_us, s->d2_t_us)
+                               : movendo_s1 ? s->d1_t_us : s->d2_t_us;
+            d->cancela_aberta = true;
+        }
+    } else if (d1_limpo <= LIMITE_FECHAR_MM || d2_limpo <= LIMITE_FECHAR_MM ||
+               (d1_limpo >= LIMITE_ABRIR_MM && d2_limpo >= LIMITE_ABRIR_MM)) {
+        // FECHA quando estacionar ou sair completamente, depois do atraso
+        if (d->cancela_aberta && !d->fechando) {
+            d->fechando = true;
+            d->fechar_em_us = e->t_us + DECISAO_FECHAR_ATRASO_US;
+            // Saída completa: vale a leitura mais recente, a que completou a condição
+            d->fechar_origem_us = (d1_limpo <= LIMITE_FECHAR_MM) ? s->d1_t_us
+                                : (d2_limpo <= LIMITE_FECHAR_MM) ? s->d2_t_us
+                                : mais_recente(s->d1_t_us, s->d2_t_us);
+        }
+    }
+
+    // --- LED ---
+    // Qualquer vaga abaixo do limite de "Livre" deixa o LED vermelho
+    s->led_vermelho = (d1_limpo < ZONA_LIVRE_MM || d2_limpo < ZONA_LIVRE_MM);
+    s->led_verde = !s->led_vermelho;
+
+    // --- BUZZER MANOBRA ---
+    bool zona_manobra = false;
+    if (d1 <= ZONA_PARADO_MM || d2 <= ZONA_PARADO_MM) {
+        s->buzzer_manobra = false;
+        d->beep_on = false;
+    } else if ((d1 > ZONA_PARADO_MM && d1 < ZONA_LIVRE_MM) || (d2 > ZONA_PARADO_MM && d2 < ZONA_LIVRE_MM)) {
+        uint16_t dist = (d1 < d2) ? d1 : d2;
+        zona_manobra = true;
+        if (!d->zona_manobra) d->beep_origem_us = (d1 < d2) ? s->d1_t_us : s->d2_t_us;
+
+        uint32_t intervalo_ms = dist * 2u / 3u; // dist / 1.5
+        if (intervalo_ms < BEEP_INTERVALO_MIN_MS) intervalo_ms = BEEP_INTERVALO_MIN_MS;
+        if (e->t_us - d->ultimo_beep_us >= (uint64_t)intervalo_ms * 1000) {
+            d->beep_on = !d->beep_on;
+            s->buzzer_manobra = d->beep_on;
+            d->ultimo_beep_us = e->t_us;
+            if (d->beep_on) {
+                s->origem_beep_us = d->beep_origem_us;
+                d->beep_origem_us = 0;
+            }
+        }
+    } else {
+        s->buzzer_manobra = false;
+        d->beep_on = false;
+    }
+    d->zona_manobra = zona_manobra;
+
+    return s;
+}
+
+// ================= SERIALIZAÇÃO =================
+
+static uint8_t *put_u64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) *p++ = (uint8_t)(v >> (8 * i));
+    return p;
+}
+
+static const uint8_t *get_u64(const uint8_t *p, uint64_t *v) {
+    *v = 0;
+    for (int i = 0; i < 8; i++) *v |= (uint64_t)*p++ << (8 * i);
+    return p;
+}
+
+// Campo a campo (little-endian): não depende do layout da struct na placa ou no PC
+void decisao_exportar(const decisao_t *d, uint8_t buf[DECISAO_ESTADO_BYTES]) {
+    const decisao_saida_t *s = &d->saida;
+    uint8_t *p = buf;
+
+    memset(buf, 0, DECISAO_ESTADO_BYTES);
+    *p++ = (uint8_t)d->d2_estavel;
+    *p++ = (uint8_t)(d->d2_estavel >> 8);
+    *p++ = d->leituras_divergentes;
+    *p++ = d->localizar_beeps;
+    p = put_u64(p, d->localizar_ultimo_us);
+    *p++ = d->cancela_aberta | (d->fechando << 1) | (d->beep_on << 2);
+    p = put_u64(p, d->fechar_em_us);
+    p = put_u64(p, d->ultimo_beep_us);
+    *p++ = s->servo_graus;
+    *p++ = s->led_vermelho | (s->led_verde << 1) | (s->buzzer_manobra << 2) |
+           (s->buzzer_localizar << 3) | (s->vaga_ocupada[0] << 4) | (s->vaga_ocupada[1] << 5);
+    *p++ = (uint8_t)s->d1_mm;
+    *p++ = (uint8_t)(s->d1_mm >> 8);
+    *p++ = (uint8_t)s->d2_mm;
+    *p++ = (uint8_t)(s->d2_mm >> 8);
+}
+
+void decisao_importar(decisao_t *d, const uint8_t buf[DECISAO_ESTADO_BYTES]) {
+    decisao_saida_t *s = &d->saida;
+    const uint8_t *p = buf;
+    uint8_t f;
+
+    d->d2_estavel = p[0] | (p[1] << 8);
+    d->leituras_divergentes = p[2];
+    d->localizar_beeps = p[3];
+    p = get_u64(p + 4, &d->localizar_ultimo_us);
+    f = *p++;
+    d->cancela_aberta = f & 1;
+    d->fechando = (f >> 1) & 1;
+    d->beep_on = (f >> 2) & 1;
+    p = get_u64(p, &d->fechar_em_us);
+    p = get_u64(p, &d->ultimo_beep_us);
+    s->servo_graus = *p++;
+    f = *p++;
+    s->led_vermelho = f & 1;
+    s->led_verde = (f >> 1) & 1;
+    s->buzzer_manobra = (f >> 2) & 1;
+    s->buzzer_localizar = (f >> 3) & 1;
+    s->vaga_ocupada[0] = (f >> 4) & 1;
+    s->vaga_ocupada[1] = (f >> 5) & 1;
+    s->d1_mm = p[0] | (p[1] << 8);
+    s->d2_mm = p[2] | (p[3] << 8);
+}
@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+#include "pico/stdlib.h"
+
+#include "dhcp_persistencia.h"
+#include "flash_store.h"
+#include "log.h"
+
+#define DHCP_PERSIST_MAGIC   0x53504844  // "DHPS"
+#define DHCP_PERSIST_VERSAO  1
+
+typedef struct {
+    uint8_t mac[6];
+    uint8_t indice;
+    uint8_t reservado;
+    uint32_t restante_s;         // Tempo de lease que faltava na gravação
+} dhcp_persist_lease_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t versao;
+    uint16_t n;
+    dhcp_persist_lease_t lease[DHCPS_MAX_IP];
+    uint32_t crc;
+} dhcp_persist_registro_t;
+
+#define SLOT_PAGINAS      ((sizeof(dhcp_persist_registro_t) + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE)
+#define SLOT_BYTES        (SLOT_PAGINAS * FLASH_PAGE_SIZE)
+#define SLOTS_POR_SETOR   (FLASH_SECTOR_SIZE / SLOT_BYTES)
+#define TOTAL_SLOTS       (FLASH_STORE_DHCP_SETORES * SLOTS_POR_SETOR)
+
+static_assert(SLOTS_POR_SETOR >= 1, "registro dos leases maior que um setor");
+
+#if DHCP_PERSISTENCIA
+// Páginas programadas direto da RAM
+static union {
+    dhcp_persist_registro_t reg;
+    uint8_t bytes[SLOT_BYTES];
+} copia;
+
+static dhcp_lease_tabela_t *tabela = NULL;
+static uint32_t proximo_slot = 0;
+static uint32_t alteracoes_gravadas = 0;
+static uint32_t alterado_ms = 0;          // Primeira mudança ainda não gravada (0 = nenhuma)
+static uint32_t ultima_gravacao_ms = 0;
+#endif
+static dhcp_persistencia_stats_t stats;
+
+#if DHCP_PERSISTENCIA
+
+static uint32_t slot_offset(uint32_t slot) {
+    return FLASH_STORE_DHCP_OFFSET + (slot / SLOTS_POR_SETOR) * FLASH_SECTOR_SIZE + (slot % SLOTS_POR_SETOR) * SLOT_BYTES;
+}
+
+static const dhcp_persist_registro_t *ler_slot(uint32_t slot) {
+    return (const dhcp_persist_registro_t *)flash_store_ptr(slot_offset(slot));
+}
+
+static bool slot_valido(const dhcp_persist_registro_t *r) {
+    if (r->magic != DHCP_PERSIST_MAGIC || r->versao != DHCP_PERSIST_VERSAO || r->n > DHCPS_MAX_IP) return false;
+    return flash_store_crc32(r, offsetof(dhcp_persist_registro_t, crc)) == r->crc;
+}
+
+static bool slot_apagado(uint32_t slot) {
+    const uint32_t *w = (const uint32_t *)ler_slot(slot);
+    for (size_t i = 0; i < SLOT_BYTES / sizeof(uint32_t); i++) {
+        if (w[i] != 0xFFFFFFFF) return false;
+    }
+    return true;
+}
+
+// ================= RECUPERAÇÃO =================
+
+void dhcp_persistencia_init(dhcp_lease_tabela_t *t) {
+    int ultimo = -1;
+    uint32_t agora_ms = to_ms_since_boot(get_absolute_time());
+
+    tabela = t;
+    for (uint32_t s = 0; s < TOTAL_SLOTS; s++) {
+        const dhcp_persist_registro_t *r = ler_slot(s);
+        if (slot_valido(r) && (ultimo < 0 || r->seq > stats.seq)) {
+            ultimo = (int)s;
+            stats.seq = r->seq;
+        }
+    }
+
+    if (ultimo >= 0) {
+        const dhcp_persist_registro_t *r = ler_slot((uint32_t)ultimo);
+        for (uint16_t i = 0; i < r->n; i++) {
+            const dhcp_persist_lease_t *l = &r->lease[i];
+            if (dhcp_lease_restaurar(t, l->mac, l->indice, agora_ms, l->restante_s)) stats.restaurados++;
+        }
+
+        // Slot com gravação interrompida (nem íntegro nem apagado) é pulado até o próximo setor
+        proximo_slot = ((uint32_t)ultimo + 1) % TOTAL_SLOTS;
+        while (proximo_slot % SLOTS_POR_SETOR != 0 && !slot_apagado(proximo_slot)) {
+            proximo_slot = (proximo_slot + 1) % TOTAL_SLOTS;
+        }
+    }
+
+    // A tabela restaurada é igual à da flash: nada a gravar
+    alteracoes_gravadas = t->alteracoes;
+    ultima_gravacao_ms = agora_ms;
+
+    LOG_INFO("DHCP: %u leases restaurados da flash (seq %lu)", stats.restaurados, stats.seq);
+}
+
+// ================= GRAVAÇÃO =================
+
+static void gravar(uint32_t agora_ms) {
+    uint64_t t0 = time_us_64();
+    uint32_t offset = slot_offset(proximo_slot);
+
+    memset(&copia, 0xFF, sizeof(copia));
+    copia.reg.magic = DHCP_PERSIST_MAGIC;
+    copia.reg.seq = stats.seq + 1;
+    copia.reg.versao = DHCP_PERSIST_VERSAO;
+    copia.reg.n = 0;
+    for (uint16_t i = 0; i < tabela->n; i++) {
+        const dhcp_lease_t *l = &tabela->lease[i];
+        if (l->estado != DHCP_LEASE_ATIVO) continue;
+        int32_t restante_ms = (int32_t)(l->expira_ms - agora_ms);
+        if (restante_ms <= 0) continue;
+        dhcp_persist_lease_t *p = &copia.reg.lease[copia.reg.n++];
+        memcpy(p->mac, l->mac, sizeof(p->mac));
+        p->indice = (uint8_t)i;
+        p->reservado = 0;
+        p->restante_s = (uint32_t)restante_ms / 1000;
+    }
+    copia.reg.crc = flash_store_crc32(&copia.reg, offsetof(dhcp_persist_registro_t, crc));
+
+    ultima_gravacao_ms = agora_ms;
+    if (proximo_slot % SLOTS_POR_SETOR == 0 && !flash_store_erase_sector(offset)) {
+        stats.falhas++;
+        return; // Tenta de novo depois do intervalo
+    }
+    for (uint32_t p = 0; p < SLOT_PAGINAS; p++) {
+        if (!flash_store_program_page(offset + p * FLASH_PAGE_SIZE, copia.bytes + p * FLASH_PAGE_SIZE)) {
+            stats.falhas++;
+            proximo_slot = (proximo_slot + 1) % TOTAL_SLOTS; // Slot possivelmente sujo
+            return;
+        }
+    }
+
+    proximo_slot = (proximo_slot + 1) % TOTAL_SLOTS;
+    stats.seq = copia.reg.seq;
+    stats.gravacoes++;
+    stats.gravacao_us = (uint32_t)(time_us_64() - t0);
+    alteracoes_gravadas = tabela->alteracoes;
+    alterado_ms = 0;
+}
+
+void dhcp_persistencia_tarefa(void) {
+    if (!tabela) return;
+    uint32_t agora_ms = to_ms_since_boot(get_absolute_time());
+
+    if (tabela->alteracoes == alteracoes_gravadas) return;
+    if (!alterado_ms) alterado_ms = agora_ms ? agora_ms : 1;
+
+    if (agora_ms - alterado_ms >= DHCP_PERSISTENCIA_ESPERA_MS &&
+        agora_ms - ultima_gravacao_ms >= DHCP_PERSISTENCIA_INTERVALO_MS) {
+        gravar(agora_ms);
+    }
+}
+
+#else
+
+void dhcp_persistencia_init(dhcp_lease_tabela_t *t) {
+    (void)t;
+}
+
+void dhcp_persistencia_tarefa(void) {
+}
+
+#endif
+
+const dhcp_persistencia_stats_t *dhcp_persistencia_get_stats(void) {
+    return &stats;
+}
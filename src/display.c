@@ -13,6 +13,7 @@ void display_init(ssd1306_t *oled) {
     ssd1306_init_bm(oled, OLED_WIDTH, OLED_HEIGHT, false, ssd1306_i2c_address, I2C_DISPLAY);
     ssd1306_config(oled);
     ssd1306_init();
+    if (!oled->ram_buffer) return;
 
     memset(oled->ram_buffer + 1, 0, oled->bufsize - 1);
     ssd1306_draw_string(oled->ram_buffer + 1, 15, 25, "SISTEMA OK");
@@ -20,6 +21,7 @@ void display_init(ssd1306_t *oled) {
 }
 
 void display_update_vagas(ssd1306_t *oled, uint16_t d1, uint16_t d2) {
+    if (!oled->ram_buffer) return;
     memset(oled->ram_buffer + 1, 0, oled->bufsize - 1);
 
     char txt1[32], txt2[32];
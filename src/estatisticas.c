@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <math.h>
+#include "pico/stdlib.h"
+
+#include "estatisticas.h"
+
+#define US_POR_HORA 3600000000ULL
+
+static estat_vaga_t vagas[ESTAT_VAGAS];
+
+static estat_vaga_t *obter(uint8_t vaga) {
+    return (vaga >= 1 && vaga <= ESTAT_VAGAS) ? &vagas[vaga - 1] : NULL;
+}
+
+// ================= AGREGADOS =================
+
+static void welford_adicionar(estat_welford_t *w, uint32_t x) {
+    w->n++;
+    double delta = x - w->media;
+    w->media += delta / w->n;
+    w->m2 += delta * (x - w->media);
+    if (w->n == 1 || x < w->min) w->min = x;
+    if (x > w->max) w->max = x;
+}
+
+// Balde da hora pedida; reaproveita a posição do anel se ela for de 24 h atrás
+static estat_hora_t *balde(estat_vaga_t *v, uint32_t hora) {
+    estat_hora_t *b = &v->horas[hora % ESTAT_HORAS];
+    if (b->hora != hora) {
+        b->hora = hora;
+        b->ocupado_ms = 0;
+        b->chegadas = 0;
+    }
+    return b;
+}
+
+// Espalha o intervalo ocupado [de, ate) pelas horas que ele cruza.
+// Só as últimas ESTAT_HORAS interessam, então o laço é limitado.
+static void distribuir(estat_vaga_t *v, uint64_t de, uint64_t ate) {
+    if (ate <= de) return;
+    if (ate - de > ESTAT_HORAS * US_POR_HORA) de = ate - ESTAT_HORAS * US_POR_HORA;
+
+    while (de < ate) {
+        uint32_t hora = (uint32_t)(de / US_POR_HORA);
+        uint64_t fim_hora = (uint64_t)(hora + 1) * US_POR_HORA;
+        uint64_t fim = (ate < fim_hora) ? ate : fim_hora;
+        balde(v, hora)->ocupado_ms += (uint32_t)((fim - de) / 1000);
+        de = fim;
+    }
+}
+
+// Estado inicial após o boot (possivelmente recuperado do log na flash)
+void estatisticas_init(uint8_t vaga, bool ocupada, uint32_t tempo_ocupada_ms) {
+    estat_vaga_t *v = obter(vaga);
+    if (!v) return;
+
+    uint64_t agora = time_us_64();
+    v->ocupada = ocupada;
+    v->desde_us = (int64_t)agora - (int64_t)tempo_ocupada_ms * 1000;
+    v->inicio_conhecido = ocupada && tempo_ocupada_ms > 0;
+    v->contabilizado_us = agora;
+}
+
+void estatisticas_transicao(uint8_t vaga, bool ocupada, uint64_t t_us) {
+    estat_vaga_t *v = obter(vaga);
+    if (!v || ocupada == v->ocupada) return;
+
+    uint32_t duracao_ms = (uint32_t)(((int64_t)t_us - v->desde_us) / 1000);
+
+    if (ocupada) {
+        if (v->inicio_conhecido) welford_adicionar(&v->vacancia, duracao_ms);
+        balde(v, (uint32_t)(t_us / US_POR_HORA))->chegadas++;
+        v->contabilizado_us = t_us;
+    } else {
+        welford_adicionar(&v->permanencia, duracao_ms);
+        distribuir(v, v->contabilizado_us, t_us);
+        v->contabilizado_us = t_us;
+    }
+
+    v->ocupada = ocupada;
+    v->desde_us = (int64_t)t_us;
+    v->inicio_conhecido = true;
+}
+
+// ================= /stats =================
+
+static double desvio(const estat_welford_t *w) {
+    return (w->n > 1) ? sqrt(w->m2 / (w->n - 1)) : 0.0;
+}
+
+// Tempo ocupado dentro de uma hora, incluindo a ocupação ainda em andamento
+static uint32_t ocupado_na_hora(const estat_vaga_t *v, uint32_t hora, uint64_t agora) {
+    const estat_hora_t *b = &v->horas[hora % ESTAT_HORAS];
+    uint32_t ms = (b->hora == hora) ? b->ocupado_ms : 0;
+
+    if (v->ocupada) {
+        uint64_t ini = (uint64_t)hora * US_POR_HORA;
+        uint64_t fim = ini + US_POR_HORA;
+        if (v->contabilizado_us > ini) ini = v->contabilizado_us;
+        if (agora < fim) fim = agora;
+        if (fim > ini) ms += (uint32_t)((fim - ini) / 1000);
+    }
+    return ms;
+}
+
+// Monta o JSON direto dos agregados: nenhuma varredura do histórico.
+// Vetores por hora vão da mais antiga para a atual (parcial).
+int estatisticas_json(char *buf, size_t len) {
+    uint64_t agora = time_us_64();
+    uint32_t hora_atual = (uint32_t)(agora / US_POR_HORA);
+    uint32_t n_horas = (hora_atual + 1 < ESTAT_HORAS) ? hora_atual + 1 : ESTAT_HORAS;
+    size_t pos = 0;
+
+#define JSON(...) do { \
+        int _n = (pos < len) ? snprintf(buf + pos, len - pos, __VA_ARGS__) : 0; \
+        if (_n > 0) pos += (size_t)_n; \
+    } while (0)
+
+    JSON("{\"horas\":%lu", n_horas);
+    for (uint8_t i = 0; i < ESTAT_VAGAS; i++) {
+        const estat_vaga_t *v = &vagas[i];
+
+        JSON(",\"vaga%u\":{\"ocupada\":%s,", i + 1, v->ocupada ? "true" : "false");
+        const estat_welford_t *w[2] = { &v->permanencia, &v->vacancia };
+        const char *nomes[2] = { "permanencia", "vacancia" };
+        for (int j = 0; j < 2; j++) {
+            JSON("\"%s\":{\"n\":%lu,\"media_s\":%.1f,\"desvio_s\":%.1f,\"min_s\":%lu,\"max_s\":%lu},",
+                 nomes[j], w[j]->n, w[j]->media / 1000.0, desvio(w[j]) / 1000.0,
+                 w[j]->min / 1000, w[j]->max / 1000);
+        }
+
+        // Previsão simples de liberação: permanência média menos o tempo já decorrido
+        if (v->ocupada && v->permanencia.n > 0) {
+            double decorrido_ms = ((int64_t)agora - v->desde_us) / 1000.0;
+            double resta_s = (v->permanencia.media - decorrido_ms) / 1000.0;
+            JSON("\"previsao_livre_s\":%.0f,", resta_s > 0 ? resta_s : 0.0);
+        } else {
+            JSON("\"previsao_livre_s\":null,");
+        }
+
+        JSON("\"ocupacao_pct\":[");
+        for (uint32_t k = 0; k < n_horas; k++) {
+            uint32_t hora = hora_atual - (n_horas - 1) + k;
+            uint64_t duracao = (hora == hora_atual) ? agora - (uint64_t)hora * US_POR_HORA : US_POR_HORA;
+            uint32_t pct = duracao ? (uint32_t)((uint64_t)ocupado_na_hora(v, hora, agora) * 100000 / duracao) : 0;
+            JSON("%s%lu", k ? "," : "", pct > 100 ? 100 : pct);
+        }
+        JSON("],\"chegadas\":[");
+        for (uint32_t k = 0; k < n_horas; k++) {
+            uint32_t hora = hora_atual - (n_horas - 1) + k;
+            const estat_hora_t *b = &v->horas[hora % ESTAT_HORAS];
+            JSON("%s%u", k ? "," : "", (b->hora == hora) ? b->chegadas : 0);
+        }
+        JSON("]}");
+    }
+    JSON("}");
+
+#undef JSON
+    return (int)pos;
+}
@@ -0,0 +1,88 @@
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+
+#include "flash_store.h"
+
+// Timeout para o outro núcleo liberar a flash (só relevante com o core1 ativo)
+#define FLASH_SAFE_TIMEOUT_MS 100
+
+typedef struct {
+    uint32_t offset;
+    const uint8_t *data;
+    size_t len;
+} flash_op_t;
+
+// Última página parcial: a flash só é programada em páginas inteiras.
+static uint8_t pagina[FLASH_PAGE_SIZE];
+
+// ================= ACESSO =================
+
+const uint8_t *flash_store_ptr(uint32_t offset) {
+    return (const uint8_t *)(XIP_BASE + offset);
+}
+
+// Executa com XIP parado: nada aqui pode ler código ou dados da flash.
+static void __not_in_flash_func(flash_op_sector)(void *param) {
+    const flash_op_t *op = param;
+    size_t inteiras = op->len - (op->len % FLASH_PAGE_SIZE);
+
+    flash_range_erase(op->offset, FLASH_SECTOR_SIZE);
+    if (inteiras) flash_range_program(op->offset, op->data, inteiras);
+    if (inteiras < op->len) flash_range_program(op->offset + inteiras, pagina, FLASH_PAGE_SIZE);
+}
+
+bool flash_store_write_sector(uint32_t offset, const void *data, size_t len) {
+    if (len > FLASH_SECTOR_SIZE || (offset % FLASH_SECTOR_SIZE) != 0) return false;
+
+    flash_op_t op = { offset, data, len };
+    size_t inteiras = len - (len % FLASH_PAGE_SIZE);
+    memset(pagina, 0xFF, sizeof(pagina));
+    memcpy(pagina, (const uint8_t *)data + inteiras, len - inteiras);
+
+    return flash_safe_execute(flash_op_sector, &op, FLASH_SAFE_TIMEOUT_MS) == PICO_OK;
+}
+
+// Apagar e programar em chamadas separadas: cada uma para o XIP pelo mínimo
+// necessário (~45 ms para um setor, <1 ms para uma página).
+static void __not_in_flash_func(flash_op_erase)(void *param) {
+    const flash_op_t *op = param;
+    flash_range_erase(op->offset, FLASH_SECTOR_SIZE);
+}
+
+static void __not_in_flash_func(flash_op_page)(void *param) {
+    const flash_op_t *op = param;
+    flash_range_program(op->offset, op->data, FLASH_PAGE_SIZE);
+}
+
+bool flash_store_erase_sector(uint32_t offset) {
+    if ((offset % FLASH_SECTOR_SIZE) != 0) return false;
+
+    flash_op_t op = { offset, NULL, 0 };
+    return flash_safe_execute(flash_op_erase, &op, FLASH_SAFE_TIMEOUT_MS) == PICO_OK;
+}
+
+// A página precisa estar apagada; data deve ficar na RAM (FLASH_PAGE_SIZE bytes).
+bool flash_store_program_page(uint32_t offset, const void *data) {
+    if ((offset % FLASH_PAGE_SIZE) != 0) return false;
+
+    flash_op_t op = { offset, data, FLASH_PAGE_SIZE };
+    return flash_safe_execute(flash_op_page, &op, FLASH_SAFE_TIMEOUT_MS) == PICO_OK;
+}
+
+// ================= CRC =================
+
+// CRC-32 (IEEE 802.3) bit a bit: poucos bytes por registro, sem tabela em RAM.
+uint32_t flash_store_crc32(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (len--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
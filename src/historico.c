@@ -0,0 +1,93 @@
+#include <stddef.h>
+
+#include "historico.h"
+
+#define HISTORICO_MAX_VAGAS 8
+
+static evento_t anel[HISTORICO_CAPACIDADE];
+static uint32_t proximo_seq = 1;
+static uint32_t primeiro_seq = 1;   // Nenhum evento antes deste (seq retomado após reset)
+static uint8_t boot_atual = 0;
+
+// Mínimo/máximo acumulados por vaga desde o último evento dela
+static uint16_t dist_min[HISTORICO_MAX_VAGAS];
+static uint16_t dist_max[HISTORICO_MAX_VAGAS];
+static bool observada[HISTORICO_MAX_VAGAS];
+
+// ================= ESCRITA (laço de controle) =================
+
+void historico_observar(uint8_t vaga, uint16_t distancia_mm) {
+    if (vaga >= HISTORICO_MAX_VAGAS || distancia_mm >= HISTORICO_SEM_LEITURA) return;
+
+    if (!observada[vaga]) {
+        dist_min[vaga] = dist_max[vaga] = distancia_mm;
+        observada[vaga] = true;
+    } else {
+        if (distancia_mm < dist_min[vaga]) dist_min[vaga] = distancia_mm;
+        if (distancia_mm > dist_max[vaga]) dist_max[vaga] = distancia_mm;
+    }
+}
+
+// O(1): sobrescreve o evento mais antigo quando o anel está cheio
+const evento_t *historico_registrar(uint8_t vaga, evento_tipo_t tipo, uint64_t t_us) {
+    if (vaga >= HISTORICO_MAX_VAGAS) return NULL;
+
+    evento_t *e = &anel[proximo_seq & (HISTORICO_CAPACIDADE - 1)];
+    e->seq = proximo_seq++;
+    e->t_ms = (uint32_t)(t_us / 1000);
+    e->vaga = vaga;
+    e->tipo = (uint8_t)tipo;
+    e->dist_min_mm = observada[vaga] ? dist_min[vaga] : HISTORICO_SEM_LEITURA;
+    e->dist_max_mm = observada[vaga] ? dist_max[vaga] : HISTORICO_SEM_LEITURA;
+    e->boot = boot_atual;
+    e->reservado = 0;
+
+    observada[vaga] = false;
+    return e;
+}
+
+void historico_set_boot(uint8_t boot) {
+    boot_atual = boot;
+}
+
+uint8_t historico_boot(void) {
+    return boot_atual;
+}
+
+// Os eventos chegam em ordem crescente de seq; o próximo novo continua a sequência
+void historico_restaurar(const evento_t *evento) {
+    if (evento->seq < proximo_seq) return; // Já presente
+    if (proximo_seq == primeiro_seq) primeiro_seq = evento->seq;  // Anel vazio: o histórico começa aqui
+
+    anel[evento->seq & (HISTORICO_CAPACIDADE - 1)] = *evento;
+    proximo_seq = evento->seq + 1;
+}
+
+// Último seq usado antes do reset, mesmo que o evento já não esteja no log:
+// os próximos eventos continuam depois dele. Se faltam eventos entre os
+// restaurados e esse seq, o anel recomeça vazio a partir dele.
+void historico_continuar(uint32_t ultimo_seq) {
+    if (ultimo_seq < proximo_seq) return;
+    proximo_seq = ultimo_seq + 1;
+    primeiro_seq = proximo_seq;
+}
+
+// ================= LEITURA =================
+
+// 0 quando ainda não há eventos
+uint32_t historico_ultimo_seq(void) {
+    return proximo_seq - 1;
+}
+
+// Evento mais antigo ainda presente no anel
+uint32_t historico_primeiro_seq(void) {
+    uint32_t seq = (proximo_seq > HISTORICO_CAPACIDADE) ? proximo_seq - HISTORICO_CAPACIDADE : 1;
+    return (seq > primeiro_seq) ? seq : primeiro_seq;
+}
+
+bool historico_ler(uint32_t seq, evento_t *evento) {
+    if (seq < historico_primeiro_seq() || seq >= proximo_seq) return false;
+
+    *evento = anel[seq & (HISTORICO_CAPACIDADE - 1)];
+    return true;
+}
@@ -1,63 +1,640 @@
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <assert.h>
 
 #include "pico/stdlib.h"
 #include "lwip/tcp.h"
+#include "http_server.h"
 #include "parking_state.h"
+#include "relogio.h"
+#include "historico.h"
+#include "estatisticas.h"
+#include "serie.h"
+#include "trace.h"
+#include "metricas.h"
+#include "rastro.h"
+#include "log.h"
+#include "memoria.h"
+#include "pico/stdio_usb.h"
 
 // ======================================================
 static struct tcp_pcb *server_pcb = NULL;
 
+// /history e /serie são enviados em pedaços conforme o TCP libera espaço
+// (tcp_sent): nenhuma resposta precisa caber num buffer único.
+#define HISTORY_LIMITE_PADRAO  50
+#define SERIE_PEDACO_BYTES     256
+
+typedef enum {
+    STREAM_HISTORY = 0,
+    STREAM_SERIE,
+    STREAM_METRICAS
+} stream_tipo_t;
+
+// Requisições por rota, exportadas em /metrics
+typedef enum {
+    ROTA_LOCALIZAR1 = 0,
+    ROTA_LOCALIZAR2,
+    ROTA_RELOGIO,
+    ROTA_HISTORY,
+    ROTA_TRACE,
+    ROTA_RASTRO,
+    ROTA_SERIE,
+    ROTA_STATS,
+    ROTA_METRICS,
+    ROTA_STATUS,
+    ROTA_PAGINA,
+    ROTA_OUTRAS,
+    N_ROTAS
+} rota_t;
+
+static const char *const nomes_rotas[N_ROTAS] = {
+    "/localizar1", "/localizar2", "/relogio", "/history", "/trace", "/rastro", "/serie",
+    "/stats", "/metrics", "/status", "/", "outras"
+};
+static uint32_t requisicoes[N_ROTAS];
+
+// Sondas de portal cativo, contadas por sistema e também exportadas em /metrics
+typedef enum {
+    SONDA_ANDROID = 0,
+    SONDA_APPLE,
+    SONDA_WINDOWS,
+    SONDA_FIREFOX,
+    N_SONDAS
+} sonda_t;
+
+static const char *const nomes_sondas[N_SONDAS] = { "android", "apple", "windows", "firefox" };
+static uint32_t sondas[N_SONDAS];
+
+typedef enum {
+    STREAM_CABECALHO = 0,
+    STREAM_EVENTOS,
+    STREAM_RODAPE,
+    STREAM_FIM
+} stream_fase_t;
+
+typedef struct {
+    bool em_uso;
+    stream_tipo_t tipo;
+    stream_fase_t fase;
+    // /history (e /metrics: próxima linha)
+    uint32_t proximo;        // Próximo seq a enviar
+    uint32_t restantes;      // Eventos que ainda cabem no limit
+    uint32_t ultimo;         // Último seq enviado (o cliente usa como próximo since)
+    bool primeiro;
+    // /serie
+    serie_cursor_t serie;
+} http_stream_t;
+
+static http_stream_t streams[HTTP_MAX_STREAMS];
+
+#if defined(MEMP_NUM_TCP_PCB) && HTTP_MAX_CONEXOES >= MEMP_NUM_TCP_PCB
+#error "HTTP_MAX_CONEXOES precisa deixar pcbs livres para o RST do excesso"
+#endif
+
+// Cada conexão aceita ocupa uma entrada (tcp_arg) até ser fechada ou abortada
+typedef struct {
+    bool em_uso;
+    struct tcp_pcb *pcb;
+    uint32_t ip;
+    uint8_t ociosa;          // Chamadas do tcp_poll sem tráfego
+    http_stream_t *stream;   // Envio em pedaços em andamento
+} http_conexao_t;
+
+static http_conexao_t conexoes[HTTP_MAX_CONEXOES];
+
+// Balde de fichas por IP de origem (milésimos de ficha); entradas reaproveitadas
+// pela mais antiga quando aparece um IP novo
+typedef struct {
+    uint32_t ip;
+    uint32_t fichas_mil;
+    uint32_t ultimo_ms;
+} http_balde_t;
+
+static http_balde_t baldes[HTTP_BALDES_IP];
+
+typedef enum {
+    CONEXAO_ACEITA = 0,
+    CONEXAO_LIMITE_GLOBAL,
+    CONEXAO_LIMITE_IP,
+    CONEXAO_TAXA,
+    CONEXAO_OCIOSA,
+    N_RESULTADOS_CONEXAO
+} conexao_resultado_t;
+
+static const char *const nomes_resultados_conexao[N_RESULTADOS_CONEXAO] = {
+    "aceita", "limite_global", "limite_ip", "taxa", "ociosa"
+};
+static uint32_t conexoes_total[N_RESULTADOS_CONEXAO];
+
 // ======================================================
+// data fica na flash (literal): o lwIP aponta para ela em vez de copiar
 static void send_response(struct tcp_pcb *tpcb, const char *data) {
+    tcp_write(tpcb, data, strlen(data), 0);
+    tcp_output(tpcb);
+}
+
+// Texto montado num buffer que não sobrevive ao retorno: vai copiado
+static void send_response_copia(struct tcp_pcb *tpcb, const char *data) {
     tcp_write(tpcb, data, strlen(data), TCP_WRITE_FLAG_COPY);
     tcp_output(tpcb);
 }
 
+// Início da ocupação em epoch (ms), ou null sem relógio definido
+static void format_desde(char *buf, size_t len, const vaga_status_t *vaga) {
+    if (vaga->ocupada && relogio_definido()) {
+        snprintf(buf, len, "%llu",
+                 (unsigned long long)(relogio_epoch_ms(vaga->ocupada_desde) - vaga->tempo_anterior_ms));
+    } else {
+        snprintf(buf, len, "null");
+    }
+}
+
+// ======================================================
+// Valor numérico de um parâmetro da query string (ex.: "since=")
+static uint32_t query_u32(const char *req, const char *nome, uint32_t padrao) {
+    const char *fim = strstr(req, " HTTP/");
+    const char *arg = strstr(req, nome);
+    if (!arg || (fim && arg > fim)) return padrao;
+    return strtoul(arg + strlen(nome), NULL, 10);
+}
+
+static int format_evento(char *buf, size_t len, const evento_t *e, bool primeiro) {
+    char epoch[24];
+    if (relogio_definido() && e->boot == historico_boot()) {
+        snprintf(epoch, sizeof(epoch), "%llu",
+                 (unsigned long long)relogio_epoch_ms(from_us_since_boot((uint64_t)e->t_ms * 1000)));
+    } else {
+        snprintf(epoch, sizeof(epoch), "null");
+    }
+    return snprintf(buf, len,
+        "%s{\"seq\":%lu,\"vaga\":%u,\"tipo\":\"%s\",\"boot\":%u,\"t\":%lu,\"epoch\":%s,\"min\":%u,\"max\":%u}",
+        primeiro ? "" : ",",
+        e->seq, e->vaga, e->tipo == EVENTO_CHEGADA ? "chegada" : "saida",
+        e->boot, e->t_ms, epoch, e->dist_min_mm, e->dist_max_mm);
+}
+
+// Escreve o quanto couber no buffer de envio. Retorna true ao terminar.
+static bool history_enviar(struct tcp_pcb *tpcb, http_stream_t *st) {
+    char buf[160];
+
+    while (st->fase != STREAM_FIM) {
+        int n;
+        evento_t e;
+
+        if (st->fase == STREAM_CABECALHO) {
+            n = snprintf(buf, sizeof(buf),
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Type: application/json\r\n\r\n"
+                "{\"primeiro\":%lu,\"eventos\":[", historico_primeiro_seq());
+        } else if (st->fase == STREAM_EVENTOS) {
+            if (st->restantes == 0 || st->proximo > historico_ultimo_seq()) {
+                st->fase = STREAM_RODAPE;
+                continue;
+            }
+            if (!historico_ler(st->proximo, &e)) {
+                // Sobrescrito durante o envio: continua do mais antigo ainda presente
+                st->proximo = historico_primeiro_seq();
+                continue;
+            }
+            n = format_evento(buf, sizeof(buf), &e, st->primeiro);
+        } else {
+            n = snprintf(buf, sizeof(buf), "],\"ultimo\":%lu}", st->ultimo);
+        }
+
+        if (tcp_sndbuf(tpcb) < n) break;  // Continua quando o cliente confirmar dados
+        if (tcp_write(tpcb, buf, n, TCP_WRITE_FLAG_COPY) != ERR_OK) break;
+
+        if (st->fase == STREAM_EVENTOS) {
+            st->ultimo = st->proximo++;
+            st->restantes--;
+            st->primeiro = false;
+        } else {
+            st->fase++;
+        }
+    }
+
+    tcp_output(tpcb);
+    return st->fase == STREAM_FIM;
+}
+
+// Binário: cabeçalho HTTP e depois pedaços de serie_exportar até o fim
+static bool serie_enviar(struct tcp_pcb *tpcb, http_stream_t *st) {
+    static const char cabecalho[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/octet-stream\r\n\r\n";
+    uint8_t buf[SERIE_PEDACO_BYTES];
+
+    if (st->fase == STREAM_CABECALHO) {
+        if (tcp_sndbuf(tpcb) >= sizeof(cabecalho) - 1 &&
+            tcp_write(tpcb, cabecalho, sizeof(cabecalho) - 1, 0) == ERR_OK) {
+            st->fase = STREAM_EVENTOS;
+        }
+    }
+
+    while (st->fase == STREAM_EVENTOS) {
+        if (serie_exportar_fim(&st->serie)) {
+            st->fase = STREAM_FIM;
+            break;
+        }
+
+        size_t livre = tcp_sndbuf(tpcb);
+        serie_cursor_t antes = st->serie;
+        size_t n = serie_exportar(&st->serie, buf, livre < sizeof(buf) ? livre : sizeof(buf));
+        if (n == 0) break;  // Continua quando o cliente confirmar dados
+        if (tcp_write(tpcb, buf, n, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+            st->serie = antes; // Sem memória agora: recodifica no próximo tcp_sent
+            break;
+        }
+    }
+
+    tcp_output(tpcb);
+    return st->fase == STREAM_FIM;
+}
+
+// Linhas dos contadores por rota, por sonda e de conexões; depois delas vêm as de metricas_linha
+static int rota_linha(uint32_t i, char *buf, size_t len) {
+    if (i == 0) return snprintf(buf, len, "# TYPE estacionamento_http_requisicoes_total counter\n");
+    if (i <= N_ROTAS) {
+        return snprintf(buf, len, "estacionamento_http_requisicoes_total{rota=\"%s\"} %lu\n",
+                        nomes_rotas[i - 1], requisicoes[i - 1]);
+    }
+    i -= N_ROTAS + 1;
+    if (i == 0) return snprintf(buf, len, "# TYPE estacionamento_http_sondas_total counter\n");
+    if (i <= N_SONDAS) {
+        return snprintf(buf, len, "estacionamento_http_sondas_total{so=\"%s\"} %lu\n",
+                        nomes_sondas[i - 1], sondas[i - 1]);
+    }
+    i -= N_SONDAS + 1;
+    if (i == 0) return snprintf(buf, len, "# TYPE estacionamento_http_conexoes_total counter\n");
+    if (i <= N_RESULTADOS_CONEXAO) {
+        return snprintf(buf, len, "estacionamento_http_conexoes_total{resultado=\"%s\"} %lu\n",
+                        nomes_resultados_conexao[i - 1], conexoes_total[i - 1]);
+    }
+    i -= N_RESULTADOS_CONEXAO + 1;
+    if (i == 0) return snprintf(buf, len, "# TYPE estacionamento_http_conexoes_abertas gauge\n");
+    if (i == 1) return snprintf(buf, len, "estacionamento_http_conexoes_abertas %u\n", memoria_get(MEMORIA_HTTP_CONEXAO)->usados);
+    if (i == 2) return snprintf(buf, len, "# TYPE estacionamento_http_conexoes_abertas_max gauge\n");
+    if (i == 3) return snprintf(buf, len, "estacionamento_http_conexoes_abertas_max %u\n", memoria_get(MEMORIA_HTTP_CONEXAO)->max);
+    return metricas_linha(i - 4, buf, len);
+}
+
+// Texto Prometheus, uma linha por tcp_write conforme o buffer de envio libera
+static bool metricas_enviar(struct tcp_pcb *tpcb, http_stream_t *st) {
+    char buf[160];
+
+    while (st->fase != STREAM_FIM) {
+        int n;
+
+        if (st->fase == STREAM_CABECALHO) {
+            n = snprintf(buf, sizeof(buf),
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Type: text/plain; version=0.0.4\r\n\r\n");
+        } else {
+            n = rota_linha(st->proximo, buf, sizeof(buf));
+            if (n < 0) {
+                st->fase = STREAM_FIM;
+                break;
+            }
+        }
+
+        if (tcp_sndbuf(tpcb) < n) break;  // Continua quando o cliente confirmar dados
+        if (tcp_write(tpcb, buf, n, TCP_WRITE_FLAG_COPY) != ERR_OK) break;
+
+        if (st->fase == STREAM_CABECALHO) st->fase = STREAM_EVENTOS;
+        else st->proximo++;
+    }
+
+    tcp_output(tpcb);
+    return st->fase == STREAM_FIM;
+}
+
+static bool stream_enviar(struct tcp_pcb *tpcb, http_stream_t *st) {
+    switch (st->tipo) {
+        case STREAM_SERIE:    return serie_enviar(tpcb, st);
+        case STREAM_METRICAS: return metricas_enviar(tpcb, st);
+        default:              return history_enviar(tpcb, st);
+    }
+}
+
+static void stream_liberar(http_conexao_t *c) {
+    if (!c->stream) return;
+    c->stream->em_uso = false;
+    c->stream = NULL;
+    memoria_liberar(MEMORIA_HTTP_STREAM);
+    if (c->pcb) tcp_sent(c->pcb, NULL);
+}
+
+// Devolve a entrada da conexão; o pcb deixa de chamar qualquer callback nosso
+static void conexao_liberar(http_conexao_t *c) {
+    stream_liberar(c);
+    if (c->pcb) {
+        tcp_arg(c->pcb, NULL);
+        tcp_recv(c->pcb, NULL);
+        tcp_err(c->pcb, NULL);
+        tcp_poll(c->pcb, NULL, 0);
+    }
+    c->em_uso = false;
+    c->pcb = NULL;
+    memoria_liberar(MEMORIA_HTTP_CONEXAO);
+}
+
+// ERR_ABRT quando o fechamento normal falhou e o pcb foi abortado (quem
+// chamou de dentro de um callback do lwIP deve devolver esse valor)
+static err_t conexao_fechar(http_conexao_t *c) {
+    struct tcp_pcb *tpcb = c->pcb;
+    RASTRO(RASTRO_TCP_FECHA, tpcb->remote_port);
+    conexao_liberar(c);
+    if (tcp_close(tpcb) != ERR_OK) {
+        tcp_abort(tpcb);
+        return ERR_ABRT;
+    }
+    return ERR_OK;
+}
+
+static err_t stream_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    http_conexao_t *c = arg;
+    if (!c || !c->stream) return ERR_OK;
+
+    c->ociosa = 0;
+    if (stream_enviar(tpcb, c->stream)) return conexao_fechar(c);
+    return ERR_OK;
+}
+
+static void conexao_err_callback(void *arg, err_t err) {
+    // O pcb já foi liberado pelo lwIP
+    http_conexao_t *c = arg;
+    if (!c) return;
+    c->pcb = NULL;
+    conexao_liberar(c);
+}
+
+// A cada HTTP_POLL_INTERVALO: retoma um envio parado por falta de memória e
+// derruba conexões sem tráfego (cliente que abriu e não pediu nada, ou que
+// parou de confirmar os dados de um envio em pedaços)
+static err_t conexao_poll_callback(void *arg, struct tcp_pcb *tpcb) {
+    http_conexao_t *c = arg;
+    if (!c) return ERR_OK;
+
+    if (++c->ociosa * HTTP_POLL_INTERVALO >= HTTP_OCIOSA_S * 2) {
+        conexoes_total[CONEXAO_OCIOSA]++;
+        conexao_liberar(c);
+        tcp_abort(tpcb);
+        return ERR_ABRT;
+    }
+    if (c->stream && stream_enviar(tpcb, c->stream)) return conexao_fechar(c);
+    return ERR_OK;
+}
+
+// Só encontra uma entrada livre: ela é ocupada (e contada no pool) em
+// stream_iniciar, então uma rota que desiste antes disso não precisa devolvê-la
+static http_stream_t *stream_alocar(http_conexao_t *c) {
+    for (int i = 0; i < HTTP_MAX_STREAMS; i++) {
+        if (!streams[i].em_uso) return &streams[i];
+    }
+    memoria_falha(MEMORIA_HTTP_STREAM);
+    send_response(c->pcb, "HTTP/1.1 503 Service Unavailable\r\nContent-Type: text/plain\r\n\r\nOCUPADO");
+    return NULL;
+}
+
+// Envia o primeiro pedaço; retorna true se a conexão continua aberta para o restante
+static bool stream_iniciar(http_conexao_t *c, http_stream_t *st, stream_tipo_t tipo) {
+    st->em_uso = true;
+    memoria_ocupar(MEMORIA_HTTP_STREAM);
+    st->tipo = tipo;
+    st->fase = STREAM_CABECALHO;
+
+    c->stream = st;
+    tcp_sent(c->pcb, stream_sent_callback);
+
+    if (stream_enviar(c->pcb, st)) {
+        stream_liberar(c);
+        return false;
+    }
+    return true;
+}
+
+static bool history_iniciar(http_conexao_t *c, const char *req) {
+    http_stream_t *st = stream_alocar(c);
+    if (!st) return false;
+
+    uint32_t since = query_u32(req, "since=", 0);
+    uint32_t limite = query_u32(req, "limit=", HISTORY_LIMITE_PADRAO);
+    if (limite == 0 || limite > HISTORICO_CAPACIDADE) limite = HISTORICO_CAPACIDADE;
+
+    st->proximo = (since + 1 > historico_primeiro_seq()) ? since + 1 : historico_primeiro_seq();
+    st->restantes = limite;
+    st->ultimo = since;
+    st->primeiro = true;
+    return stream_iniciar(c, st, STREAM_HISTORY);
+}
+
+// canal = índice de aquisição; res = bruta (padrão), 1s ou 1min
+static bool serie_iniciar(http_conexao_t *c, const char *req) {
+    serie_resolucao_t res = SERIE_BRUTA;
+    if (strstr(req, "res=1min")) res = SERIE_1MIN;
+    else if (strstr(req, "res=1s")) res = SERIE_1S;
+
+    http_stream_t *st = stream_alocar(c);
+    if (!st) return false;
+
+    if (!serie_exportar_iniciar(&st->serie, (uint8_t)query_u32(req, "canal=", 0), res)) {
+        send_response(c->pcb, "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n\r\nCANAL INVALIDO");
+        return false;
+    }
+    return stream_iniciar(c, st, STREAM_SERIE);
+}
+
+static bool metricas_iniciar(http_conexao_t *c) {
+    http_stream_t *st = stream_alocar(c);
+    if (!st) return false;
+
+    st->proximo = 0;
+    return stream_iniciar(c, st, STREAM_METRICAS);
+}
+
+// ================= SONDAS DE PORTAL CATIVO =================
+// Respostas prontas (constantes na flash, enviadas sem cópia); a requisição
+// só é comparada com os caminhos conhecidos, antes de qualquer rota.
+
+#define RESPOSTA_SONDA(status, tipo, corpo) \
+    "HTTP/1.1 " status "\r\nContent-Type: " tipo "\r\nContent-Length: " corpo "\r\nConnection: close\r\n\r\n"
+
+#if HTTP_PORTAL_CATIVO
+static const char redireciona[] =
+    "HTTP/1.1 302 Found\r\nLocation: http://192.168.4.1/\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+#define RESPOSTA(sem_portal) redireciona
+#else
+#define RESPOSTA(sem_portal) sem_portal
+#endif
+
+static const struct {
+    const char *caminho;         // Depois de "GET "
+    uint8_t caminho_len;
+    sonda_t sonda;
+    const char *resposta;
+    uint16_t resposta_len;
+} sondas_conhecidas[] = {
+#define SONDA(caminho, sonda, resposta) { caminho, sizeof(caminho) - 1, sonda, resposta, sizeof(resposta) - 1 }
+    SONDA("/generate_204", SONDA_ANDROID,
+          RESPOSTA("HTTP/1.1 204 No Content\r\nContent-Length: 0\r\nConnection: close\r\n\r\n")),
+    SONDA("/gen_204", SONDA_ANDROID,
+          RESPOSTA("HTTP/1.1 204 No Content\r\nContent-Length: 0\r\nConnection: close\r\n\r\n")),
+    SONDA("/hotspot-detect.html", SONDA_APPLE,
+          RESPOSTA(RESPOSTA_SONDA("200 OK", "text/html", "68")
+                   "<HTML><HEAD><TITLE>Success</TITLE></HEAD><BODY>Success</BODY></HTML>")),
+    SONDA("/library/test/success.html", SONDA_APPLE,
+          RESPOSTA(RESPOSTA_SONDA("200 OK", "text/html", "68")
+                   "<HTML><HEAD><TITLE>Success</TITLE></HEAD><BODY>Success</BODY></HTML>")),
+    SONDA("/connecttest.txt", SONDA_WINDOWS,
+          RESPOSTA(RESPOSTA_SONDA("200 OK", "text/plain", "22") "Microsoft Connect Test")),
+    SONDA("/ncsi.txt", SONDA_WINDOWS,
+          RESPOSTA(RESPOSTA_SONDA("200 OK", "text/plain", "14") "Microsoft NCSI")),
+    SONDA("/success.txt", SONDA_FIREFOX,
+          RESPOSTA(RESPOSTA_SONDA("200 OK", "text/plain", "8") "success\n")),
+#undef SONDA
+};
+
+// true se a requisição era uma sonda (já respondida)
+static bool sonda_responder(struct tcp_pcb *tpcb, const char *req, size_t len) {
+    if (len < 6 || memcmp(req, "GET /", 5) != 0) return false;
+
+    for (size_t i = 0; i < sizeof(sondas_conhecidas) / sizeof(sondas_conhecidas[0]); i++) {
+        size_t n = sondas_conhecidas[i].caminho_len;
+        // Primeira letra do caminho descarta quase todas sem memcmp
+        if (req[5] != sondas_conhecidas[i].caminho[1] || len < 4 + n + 1) continue;
+        if (memcmp(req + 4, sondas_conhecidas[i].caminho, n) != 0) continue;
+        if (req[4 + n] != ' ' && req[4 + n] != '?') continue;
+
+        sondas[sondas_conhecidas[i].sonda]++;
+        tcp_write(tpcb, sondas_conhecidas[i].resposta, sondas_conhecidas[i].resposta_len, 0);
+        return true;
+    }
+    return false;
+}
+
 // ======================================================
 static err_t http_recv_callback(void *arg,
                                 struct tcp_pcb *tpcb,
                                 struct pbuf *p,
                                 err_t err) {
 
+    http_conexao_t *c = arg;
+
     if (!p) {
-        tcp_close(tpcb);
-        return ERR_OK;
+        // Cliente fechou o lado dele
+        return c ? conexao_fechar(c) : ERR_OK;
     }
 
     tcp_recved(tpcb, p->tot_len);
     char *req = (char *)p->payload;
+    bool manter_aberta = false;
 
+    // Conexão no meio de um envio em pedaços: o envio segue pelo tcp_sent
+    if (!c || c->stream) {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+    c->ociosa = 0;
+
+    METRICA_INICIO(http);
+
+    // ---------- SONDAS DE PORTAL CATIVO (antes de qualquer rota) ----------
+    if (sonda_responder(tpcb, req, p->len)) {
+        // Respondida com o texto pronto
+    }
     // ---------- ROTA LOCALIZAR 1 ----------
-    if (strstr(req, "GET /localizar1")) {
+    else if (strstr(req, "GET /localizar1")) {
+        requisicoes[ROTA_LOCALIZAR1]++;
         localizar_vaga1 = true; // Flag tratada no main.c
+        if (!localizar_pedido_us) localizar_pedido_us = time_us_64();
         send_response(tpcb, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\nOK");
     } 
     // ---------- ROTA LOCALIZAR 2 ----------
     else if (strstr(req, "GET /localizar2")) {
+        requisicoes[ROTA_LOCALIZAR2]++;
         localizar_vaga2 = true; // Flag tratada no main.c
+        if (!localizar_pedido_us) localizar_pedido_us = time_us_64();
         send_response(tpcb, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\nOK");
     }
+    // ---------- ROTA /relogio?epoch=<ms> ----------
+    else if (strstr(req, "GET /relogio")) {
+        requisicoes[ROTA_RELOGIO]++;
+        // O primeiro cliente define a hora; os seguintes são ignorados
+        char *arg = strstr(req, "epoch=");
+        bool ok = arg && relogio_definir(strtoull(arg + 6, NULL, 10));
+        send_response(tpcb, ok ? "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\nOK"
+                               : "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\nIGNORADO");
+    }
+    // ---------- ROTA /history?since=<seq>&limit=N (JSON em pedaços) ----------
+    else if (strstr(req, "GET /history")) {
+        requisicoes[ROTA_HISTORY]++;
+        manter_aberta = history_iniciar(c, req);
+    }
+    // ---------- ROTA /trace?ligar=1|0 (trace binário na USB) ----------
+    else if (strstr(req, "GET /trace")) {
+        requisicoes[ROTA_TRACE]++;
+        trace_ativar(query_u32(req, "ligar=", 1) != 0);
+        send_response(tpcb, trace_ativo() ? "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\nLIGADO"
+                                          : "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\nDESLIGADO");
+    }
+    // ---------- ROTA /rastro (despejo do rastro de eventos na USB) ----------
+    else if (strstr(req, "GET /rastro")) {
+        requisicoes[ROTA_RASTRO]++;
+        bool ok = stdio_usb_connected() && rastro_despejar();
+        send_response(tpcb, ok ? "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\nDESPEJANDO"
+                               : "HTTP/1.1 503 Service Unavailable\r\nContent-Type: text/plain\r\n\r\nSEM USB OU DESPEJO EM ANDAMENTO");
+    }
+    // ---------- ROTA /serie?canal=N&res=bruta|1s|1min (binário em pedaços) ----------
+    else if (strstr(req, "GET /serie")) {
+        requisicoes[ROTA_SERIE]++;
+        manter_aberta = serie_iniciar(c, req);
+    }
+    // ---------- ROTA /stats (agregados de ocupação) ----------
+    else if (strstr(req, "GET /stats")) {
+        requisicoes[ROTA_STATS]++;
+        static char json[1536];
+        int n = snprintf(json, sizeof(json),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: application/json\r\n\r\n");
+        estatisticas_json(json + n, sizeof(json) - n);
+        send_response_copia(tpcb, json);
+    }
+    // ---------- ROTA /metrics (texto Prometheus em pedaços) ----------
+    else if (strstr(req, "GET /metrics")) {
+        requisicoes[ROTA_METRICS]++;
+        manter_aberta = metricas_iniciar(c);
+    }
     // ---------- ROTA /status (JSON) ----------
     else if (strstr(req, "GET /status")) {
-        char json[256];
+        requisicoes[ROTA_STATUS]++;
+        char json[320];
+        char desde1[24], desde2[24];
+        format_desde(desde1, sizeof(desde1), &vaga1_status);
+        format_desde(desde2, sizeof(desde2), &vaga2_status);
         snprintf(json, sizeof(json),
             "HTTP/1.1 200 OK\r\n"
             "Content-Type: application/json\r\n\r\n"
             "{"
-              "\"vaga1\": {\"ocupada\": %s, \"tempo\": %lu},"
-              "\"vaga2\": {\"ocupada\": %s, \"tempo\": %lu}"
+              "\"vaga1\": {\"ocupada\": %s, \"tempo\": %lu, \"desde\": %s},"
+              "\"vaga2\": {\"ocupada\": %s, \"tempo\": %lu, \"desde\": %s}"
             "}",
             vaga1_status.ocupada ? "true" : "false",
-            vaga1_status.tempo_ocupada_ms / 1000,
+            vaga_tempo_ocupada_ms(&vaga1_status) / 1000,
+            desde1,
             vaga2_status.ocupada ? "true" : "false",
-            vaga2_status.tempo_ocupada_ms / 1000
+            vaga_tempo_ocupada_ms(&vaga2_status) / 1000,
+            desde2
         );
-        send_response(tpcb, json);
+        send_response_copia(tpcb, json);
+        // Primeira resposta que já mostra a transição pendente
+        metricas_latencia_concluir(LATENCIA_HTTP_ESTADO);
     } 
     // ---------- ROTA PRINCIPAL (HTML) ----------
     else if (strstr(req, "GET / ")) {
-        const char *html =
+        requisicoes[ROTA_PAGINA]++;
+        static const char html[] =
         "HTTP/1.1 200 OK\r\n"
         "Content-Type: text/html; charset=utf-8\r\n\r\n"
         "<!DOCTYPE html>"
@@ -91,6 +668,7 @@ static err_t http_recv_callback(void *arg,
         "  </div>"
         "</div>"
         "<script>"
+        "  fetch('/relogio?epoch=' + Date.now());"
         "  function localizar(id) { fetch('/localizar' + id); }"
         "  function formatarTempo(seg){"
         "    const h=Math.floor(seg/3600), m=Math.floor((seg%3600)/60), s=seg%60;"
@@ -109,25 +687,106 @@ static err_t http_recv_callback(void *arg,
         "  }"
         "  setInterval(atualizar, 1000); atualizar();"
         "</script></body></html>";
+        // Vai sem cópia, inteira na janela de envio
+        static_assert(sizeof(html) - 1 <= TCP_SND_BUF, "pagina maior que TCP_SND_BUF");
         send_response(tpcb, html);
     }
+    else {
+        requisicoes[ROTA_OUTRAS]++;
+    }
 
+    METRICA_FIM(http, ETAPA_HTTP);
     pbuf_free(p);
-    tcp_close(tpcb);
+    if (!manter_aberta) return conexao_fechar(c);
     return ERR_OK;
 }
 
+// ================= ADMISSÃO =================
+
+// Tira uma ficha do balde do IP; false se o IP passou da taxa
+static bool balde_retirar(uint32_t ip, uint32_t agora_ms) {
+    http_balde_t *b = NULL;
+    http_balde_t *mais_antigo = &baldes[0];
+
+    for (int i = 0; i < HTTP_BALDES_IP; i++) {
+        if (baldes[i].ip == ip) {
+            b = &baldes[i];
+            break;
+        }
+        if ((int32_t)(baldes[i].ultimo_ms - mais_antigo->ultimo_ms) < 0) mais_antigo = &baldes[i];
+    }
+    if (!b) {
+        b = mais_antigo;
+        b->ip = ip;
+        b->fichas_mil = HTTP_RAJADA * 1000;
+    } else {
+        uint32_t dt = agora_ms - b->ultimo_ms;
+        if (dt > HTTP_RAJADA * 1000) dt = HTTP_RAJADA * 1000;
+        uint32_t novas = dt * HTTP_CONEXOES_POR_S;
+        b->fichas_mil = (novas >= HTTP_RAJADA * 1000 - b->fichas_mil) ? HTTP_RAJADA * 1000 : b->fichas_mil + novas;
+    }
+    b->ultimo_ms = agora_ms;
+
+    if (b->fichas_mil < 1000) return false;
+    b->fichas_mil -= 1000;
+    return true;
+}
+
+// O limite global é política de admissão e já conta em conexoes_total: o pool
+// de conexões nunca chega a recusar um pedido (falhas fica em 0)
+static conexao_resultado_t admitir(uint32_t ip) {
+    if (memoria_get(MEMORIA_HTTP_CONEXAO)->usados >= HTTP_MAX_CONEXOES) return CONEXAO_LIMITE_GLOBAL;
+
+    uint16_t do_ip = 0;
+    for (int i = 0; i < HTTP_MAX_CONEXOES; i++) {
+        if (conexoes[i].em_uso && conexoes[i].ip == ip) do_ip++;
+    }
+    if (do_ip >= HTTP_MAX_CONEXOES_POR_IP) return CONEXAO_LIMITE_IP;
+
+    if (!balde_retirar(ip, to_ms_since_boot(get_absolute_time()))) return CONEXAO_TAXA;
+    return CONEXAO_ACEITA;
+}
+
 // ======================================================
 static err_t http_accept_callback(void *arg, struct tcp_pcb *newpcb, err_t err) {
+    if (err != ERR_OK || !newpcb) return ERR_VAL;
+    RASTRO(RASTRO_TCP_ACEITE, newpcb->remote_port);
+
+    // Excesso sai com RST na hora: nenhum buffer fica preso com quem não vai ser atendido
+    uint32_t ip = ip_addr_get_ip4_u32(&newpcb->remote_ip);
+    conexao_resultado_t r = admitir(ip);
+    conexoes_total[r]++;
+    if (r != CONEXAO_ACEITA) {
+        tcp_abort(newpcb);
+        return ERR_ABRT;
+    }
+
+    http_conexao_t *c = NULL;
+    for (int i = 0; i < HTTP_MAX_CONEXOES && !c; i++) {
+        if (!conexoes[i].em_uso) c = &conexoes[i];
+    }
+    c->em_uso = true;
+    c->pcb = newpcb;
+    c->ip = ip;
+    c->ociosa = 0;
+    c->stream = NULL;
+    memoria_ocupar(MEMORIA_HTTP_CONEXAO);
+
+    tcp_arg(newpcb, c);
     tcp_recv(newpcb, http_recv_callback);
+    tcp_err(newpcb, conexao_err_callback);
+    tcp_poll(newpcb, conexao_poll_callback, HTTP_POLL_INTERVALO);
     return ERR_OK;
 }
 
 // ======================================================
 void http_server_init(void) {
+    memoria_definir(MEMORIA_HTTP_CONEXAO, HTTP_MAX_CONEXOES);
+    memoria_definir(MEMORIA_HTTP_STREAM, HTTP_MAX_STREAMS);
+
     server_pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
     tcp_bind(server_pcb, IP_ANY_TYPE, 80);
     server_pcb = tcp_listen(server_pcb);
     tcp_accept(server_pcb, http_accept_callback);
-    printf("HTTP ativo em http://192.168.4.1\n");
+    LOG_INFO("HTTP ativo em http://192.168.4.1");
 }
\ No newline at end of file
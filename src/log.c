@@ -0,0 +1,261 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "pico/critical_section.h"
+#include "tusb.h"
+
+#include "log.h"
+
+#define MENSAGENS_POR_TAREFA 4
+
+// Registro no anel: u8 tamanho, u8 nível, u8 truncado, u32 t_ms, ponteiro do formato, argumentos
+#define CABECALHO_BYTES (3 + 4 + sizeof(const char *))
+
+typedef enum {
+    ARG_NENHUM = 0,   // "%%"
+    ARG_INT,
+    ARG_LONGLONG,
+    ARG_DOUBLE,
+    ARG_TEXTO,
+    ARG_PONTEIRO
+} arg_tipo_t;
+
+static uint8_t anel[LOG_BUFFER_BYTES];
+static volatile uint32_t escrita = 0;   // Contadores livres; a posição é & (LOG_BUFFER_BYTES - 1)
+static volatile uint32_t leitura = 0;
+static critical_section_t secao;
+static uint32_t descartadas_informadas = 0;
+static log_stats_t stats;
+
+static const char letras[] = { '-', 'E', 'A', 'I', 'D' };
+
+// ================= FORMATO =================
+
+// Classifica a conversão que começa em p ('%'); retorna o ponteiro logo depois dela
+static const char *conversao(const char *p, arg_tipo_t *tipo) {
+    int longos = 0;
+    bool tamanho = false;
+
+    p++;
+    while (*p && strchr("-+ #0123456789.", *p)) p++;
+    while (*p && strchr("hlLzjt", *p)) {
+        if (*p == 'l') longos++;
+        if (*p == 'z' || *p == 'j' || *p == 't') tamanho = true;
+        p++;
+    }
+
+    switch (*p) {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+        // long e size_t têm 32 bits na placa; no PC (ferramentas) podem ter 64
+        if (longos >= 2 || (longos == 1 && sizeof(long) == 8) || (tamanho && sizeof(size_t) == 8)) {
+            *tipo = ARG_LONGLONG;
+        } else {
+            *tipo = ARG_INT;
+        }
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        *tipo = ARG_DOUBLE;
+        break;
+    case 's': *tipo = ARG_TEXTO; break;
+    case 'p': *tipo = ARG_PONTEIRO; break;
+    default:  *tipo = ARG_NENHUM; break;
+    }
+    return *p ? p + 1 : p;
+}
+
+// ================= REGISTRO =================
+
+void log_init(void) {
+    critical_section_init(&secao);
+}
+
+static void put(const void *dados, size_t len) {
+    const uint8_t *b = dados;
+    uint32_t pos = escrita;
+    for (size_t i = 0; i < len; i++) anel[(pos + i) & (LOG_BUFFER_BYTES - 1)] = b[i];
+    escrita = pos + len;   // Publicado só com o registro inteiro no anel
+}
+
+void log_registrar(uint8_t nivel, const char *fmt, ...) {
+    uint8_t reg[LOG_REGISTRO_MAX];
+    size_t n = CABECALHO_BYTES;
+    bool truncado = false;
+    va_list ap;
+
+    // Argumentos em binário, na ordem do formato
+    va_start(ap, fmt);
+    for (const char *p = fmt; *p && !truncado; ) {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+        arg_tipo_t tipo;
+        p = conversao(p, &tipo);
+
+        union { int i; long long ll; double d; void *ptr; } v;
+        const void *dados = &v;
+        size_t len = 0;
+        const char *texto;
+        uint8_t texto_len;
+
+        switch (tipo) {
+        case ARG_INT:       v.i = va_arg(ap, int);           len = sizeof(int); break;
+        case ARG_LONGLONG:  v.ll = va_arg(ap, long long);    len = sizeof(long long); break;
+        case ARG_DOUBLE:    v.d = va_arg(ap, double);        len = sizeof(double); break;
+        case ARG_PONTEIRO:  v.ptr = va_arg(ap, void *);      len = sizeof(void *); break;
+        case ARG_TEXTO:
+            // O texto pode estar na pilha de quem chamou: vai copiado
+            texto = va_arg(ap, const char *);
+            if (!texto) texto = "(null)";
+            texto_len = (uint8_t)strnlen(texto, LOG_TEXTO_MAX);
+            if (n + 1 + texto_len > sizeof(reg)) {
+                truncado = true;
+                break;
+            }
+            reg[n++] = texto_len;
+            memcpy(reg + n, texto, texto_len);
+            n += texto_len;
+            break;
+        default:
+            break;
+        }
+        if (len) {
+            if (n + len > sizeof(reg)) {
+                truncado = true;
+            } else {
+                memcpy(reg + n, dados, len);
+                n += len;
+            }
+        }
+    }
+    va_end(ap);
+
+    uint32_t t_ms = to_ms_since_boot(get_absolute_time());
+    reg[0] = (uint8_t)n;
+    reg[1] = nivel;
+    reg[2] = truncado;
+    memcpy(reg + 3, &t_ms, 4);
+    memcpy(reg + 7, &fmt, sizeof(fmt));
+
+    // Só a cópia fica na seção crítica: o registro já foi montado na pilha
+    critical_section_enter_blocking(&secao);
+    if (LOG_BUFFER_BYTES - (escrita - leitura) < n) {
+        stats.descartadas++;
+    } else {
+        put(reg, n);
+        stats.gravadas++;
+        if (truncado) stats.truncadas++;
+        if (escrita - leitura > stats.ocupacao_max) stats.ocupacao_max = escrita - leitura;
+    }
+    critical_section_exit(&secao);
+}
+
+// ================= SAÍDA =================
+
+static void get(uint32_t pos, void *dados, size_t len) {
+    uint8_t *b = dados;
+    for (size_t i = 0; i < len; i++) b[i] = anel[(pos + i) & (LOG_BUFFER_BYTES - 1)];
+}
+
+// Refaz a mensagem a partir do registro, uma conversão por vez
+static int formatar(const uint8_t *reg, char *linha, size_t max) {
+    uint32_t t_ms;
+    const char *fmt;
+    memcpy(&t_ms, reg + 3, 4);
+    memcpy(&fmt, reg + 7, sizeof(fmt));
+
+    size_t n = (size_t)snprintf(linha, max, "[%6lu.%03lu] %c ", (unsigned long)(t_ms / 1000),
+                                (unsigned long)(t_ms % 1000), letras[reg[1] < sizeof(letras) ? reg[1] : 0]);
+    size_t pos = CABECALHO_BYTES;
+    const size_t fim_reg = reg[0];
+    const size_t limite = max - 3;   // Espaço para "\r\n" e o terminador
+
+    for (const char *p = fmt; *p && n < limite; ) {
+        if (*p != '%') {
+            linha[n++] = *p++;
+            continue;
+        }
+        const char *inicio = p;
+        arg_tipo_t tipo;
+        p = conversao(p, &tipo);
+
+        char spec[16];
+        size_t spec_len = (size_t)(p - inicio);
+        if (spec_len >= sizeof(spec)) spec_len = sizeof(spec) - 1;
+        memcpy(spec, inicio, spec_len);
+        spec[spec_len] = '\0';
+
+        union { int i; long long ll; double d; void *ptr; } v;
+        size_t len = (tipo == ARG_INT) ? sizeof(int) : (tipo == ARG_LONGLONG) ? sizeof(long long)
+                   : (tipo == ARG_DOUBLE) ? sizeof(double) : (tipo == ARG_PONTEIRO) ? sizeof(void *) : 0;
+        if (tipo == ARG_TEXTO) len = (pos < fim_reg) ? 1u + reg[pos] : 1;
+
+        // Argumentos que não couberam no registro: a linha termina em "..."
+        if (tipo != ARG_NENHUM && pos + len > fim_reg) break;
+
+        int escrito;
+        switch (tipo) {
+        case ARG_INT:       memcpy(&v.i, reg + pos, len);   escrito = snprintf(linha + n, limite - n, spec, v.i); break;
+        case ARG_LONGLONG:  memcpy(&v.ll, reg + pos, len);  escrito = snprintf(linha + n, limite - n, spec, v.ll); break;
+        case ARG_DOUBLE:    memcpy(&v.d, reg + pos, len);   escrito = snprintf(linha + n, limite - n, spec, v.d); break;
+        case ARG_PONTEIRO:  memcpy(&v.ptr, reg + pos, len); escrito = snprintf(linha + n, limite - n, spec, v.ptr); break;
+        case ARG_TEXTO: {
+            char texto[LOG_TEXTO_MAX + 1];
+            memcpy(texto, reg + pos + 1, reg[pos]);
+            texto[reg[pos]] = '\0';
+            escrito = snprintf(linha + n, limite - n, spec, texto);
+            break;
+        }
+        default:
+            // "%%" vira '%'; uma conversão desconhecida sai como está
+            escrito = snprintf(linha + n, limite - n, "%s", strcmp(spec, "%%") ? spec : "%");
+            break;
+        }
+        pos += len;
+        if (escrito > 0) n += (size_t)escrito;
+    }
+    if (n > limite) n = limite;
+    if (reg[2] && n + 3 < limite) n += (size_t)snprintf(linha + n, limite - n, "...");
+    linha[n++] = '\r';
+    linha[n++] = '\n';
+    linha[n] = '\0';
+    return (int)n;
+}
+
+// Só escreve o que cabe agora no buffer da CDC: a linha fica no anel até lá
+static bool escrever(const char *linha, int n) {
+    if (tud_cdc_write_available() < (uint32_t)n) return false;
+    for (int i = 0; i < n; i++) putchar_raw(linha[i]);
+    stats.escritas++;
+    return true;
+}
+
+void log_tarefa(void) {
+    static char linha[LOG_LINHA_MAX];
+    uint8_t reg[LOG_REGISTRO_MAX];
+
+    // Sem terminal as mensagens esperam no anel (as do boot aparecem ao conectar)
+    if (!stdio_usb_connected()) return;
+
+    if (stats.descartadas != descartadas_informadas) {
+        uint32_t novas = stats.descartadas - descartadas_informadas;
+        uint32_t t_ms = to_ms_since_boot(get_absolute_time());
+        int n = snprintf(linha, sizeof(linha), "[%6lu.%03lu] A log: %lu mensagens descartadas (anel cheio)\r\n",
+                         (unsigned long)(t_ms / 1000), (unsigned long)(t_ms % 1000), (unsigned long)novas);
+        if (!escrever(linha, n)) return;
+        descartadas_informadas += novas;
+    }
+
+    for (int m = 0; m < MENSAGENS_POR_TAREFA && leitura != escrita; m++) {
+        get(leitura, reg, 1);
+        get(leitura, reg, reg[0]);
+        if (!escrever(linha, formatar(reg, linha, sizeof(linha)))) return;
+        leitura += reg[0];
+    }
+}
+
+const log_stats_t *log_get_stats(void) {
+    return &stats;
+}
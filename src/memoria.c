@@ -0,0 +1,46 @@
+#include <malloc.h>
+
+#include "memoria.h"
+
+static memoria_pool_t pools[MEMORIA_POOLS];
+
+static const char *const nomes[MEMORIA_POOLS] = {
+    "framebuffer", "http_conexao", "http_stream"
+};
+
+void memoria_definir(memoria_pool_id_t id, uint16_t total) {
+    pools[id].total = total;
+}
+
+void memoria_ocupar(memoria_pool_id_t id) {
+    memoria_pool_t *p = &pools[id];
+    p->usados++;
+    if (p->usados > p->max) p->max = p->usados;
+}
+
+void memoria_liberar(memoria_pool_id_t id) {
+    if (pools[id].usados) pools[id].usados--;
+}
+
+void memoria_falha(memoria_pool_id_t id) {
+    pools[id].falhas++;
+}
+
+const memoria_pool_t *memoria_get(memoria_pool_id_t id) {
+    return &pools[id];
+}
+
+const char *memoria_nome(memoria_pool_id_t id) {
+    return nomes[id];
+}
+
+// ================= HEAP DA LIBC =================
+// mallinfo da newlib percorre só a lista livre; chamado apenas por /metrics
+
+size_t memoria_heap_usado(void) {
+    return mallinfo().uordblks;
+}
+
+size_t memoria_heap_max(void) {
+    return mallinfo().arena;
+}
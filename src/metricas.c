@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+
+#include "metricas.h"
+#include "log.h"
+#include "wifi_ap.h"
+#include "dhcp_persistencia.h"
+#include "memoria.h"
+
+static metricas_histograma_t etapas[METRICAS_ETAPAS];
+static metricas_histograma_t latencias[METRICAS_LATENCIAS];
+static uint64_t pendentes_us[METRICAS_LATENCIAS];
+
+static const char *const nomes_etapas[METRICAS_ETAPAS] = {
+    "laco", "cyw43_poll", "http", "vl53l0x", "ultrassonico", "decisao", "display", "persistencia"
+};
+
+static const char *const nomes_latencias[METRICAS_LATENCIAS] = {
+    "cancela_abrir", "cancela_fechar", "beep_manobra", "beep_localizar", "http_estado"
+};
+
+// ================= REGISTRO =================
+
+static void histograma_adicionar(metricas_histograma_t *h, uint32_t us) {
+    uint32_t k = us ? 32 - __builtin_clz(us) : 0;
+    if (k >= METRICAS_BALDES) k = METRICAS_BALDES - 1;
+
+    h->n++;
+    h->total_us += us;
+    if (us > h->max_us) h->max_us = us;
+    h->baldes[k]++;
+}
+
+// Chamada também da interrupção do ultrassônico: cada etapa tem um único
+// contexto de escrita, então não há disputa entre elas.
+void metricas_registrar(metricas_etapa_t etapa, uint32_t us) {
+    histograma_adicionar(&etapas[etapa], us);
+}
+
+#if METRICAS_ATIVAS || RASTRO_ATIVO
+// Histograma e, no rastro de eventos, um bloco com o início e a duração
+void metricas_etapa(metricas_etapa_t etapa, uint32_t inicio_us) {
+    uint32_t us = time_us_32() - inicio_us;
+#if METRICAS_ATIVAS
+    metricas_registrar(etapa, us);
+#endif
+#if RASTRO_ATIVO
+    rastro_registrar(RASTRO_ETAPA + etapa, inicio_us, us);
+#endif
+}
+#endif
+
+const metricas_histograma_t *metricas_get(metricas_etapa_t etapa) {
+    return &etapas[etapa];
+}
+
+// ================= LATÊNCIA =================
+
+void metricas_latencia(metricas_latencia_t l, uint64_t origem_us) {
+#if METRICAS_ATIVAS
+    if (!origem_us) return;
+    uint64_t us = time_us_64() - origem_us;
+    histograma_adicionar(&latencias[l], us > UINT32_MAX ? UINT32_MAX : (uint32_t)us);
+#else
+    (void)l; (void)origem_us;
+#endif
+}
+
+void metricas_latencia_pendente(metricas_latencia_t l, uint64_t origem_us) {
+    if (!pendentes_us[l]) pendentes_us[l] = origem_us;
+}
+
+void metricas_latencia_concluir(metricas_latencia_t l) {
+    metricas_latencia(l, pendentes_us[l]);
+    pendentes_us[l] = 0;
+}
+
+const metricas_histograma_t *metricas_get_latencia(metricas_latencia_t l) {
+    return &latencias[l];
+}
+
+// ================= TEXTO PROMETHEUS =================
+
+#if METRICAS_ATIVAS
+#define LINHAS_POR_ETAPA (METRICAS_BALDES + 2)   // Baldes (o último = +Inf) + sum + count
+
+// Uma família de histogramas com um rótulo (etapa, atuador...)
+typedef struct {
+    const char *familia;
+    const char *rotulo;
+    const char *const *nomes;
+    const metricas_histograma_t *h;
+} familia_histograma_t;
+
+static const familia_histograma_t hist_etapas = {
+    "estacionamento_etapa_segundos", "etapa", nomes_etapas, etapas
+};
+static const familia_histograma_t hist_latencias = {
+    "estacionamento_latencia_segundos", "atuador", nomes_latencias, latencias
+};
+
+// Histograma cumulativo: le do balde k = 2^k - 1 us (o último é +Inf)
+static int linha_histograma(const familia_histograma_t *f, uint32_t i, char *buf, size_t len) {
+    if (i == 0) return snprintf(buf, len, "# TYPE %s histogram\n", f->familia);
+    i--;
+
+    const metricas_histograma_t *h = &f->h[i / LINHAS_POR_ETAPA];
+    const char *nome = f->nomes[i / LINHAS_POR_ETAPA];
+    uint32_t k = i % LINHAS_POR_ETAPA;
+
+    if (k < METRICAS_BALDES) {
+        uint32_t acumulado = 0;
+        for (uint32_t j = 0; j <= k; j++) acumulado += h->baldes[j];
+        if (k == METRICAS_BALDES - 1) {
+            return snprintf(buf, len, "%s_bucket{%s=\"%s\",le=\"+Inf\"} %lu\n",
+                            f->familia, f->rotulo, nome, acumulado);
+        }
+        return snprintf(buf, len, "%s_bucket{%s=\"%s\",le=\"%.6f\"} %lu\n",
+                        f->familia, f->rotulo, nome, ((1UL << k) - 1) / 1e6, acumulado);
+    }
+    if (k == METRICAS_BALDES) {
+        return snprintf(buf, len, "%s_sum{%s=\"%s\"} %.6f\n", f->familia, f->rotulo, nome, h->total_us / 1e6);
+    }
+    return snprintf(buf, len, "%s_count{%s=\"%s\"} %lu\n", f->familia, f->rotulo, nome, h->n);
+}
+
+static int linha_etapas(uint32_t i, char *buf, size_t len) {
+    return linha_histograma(&hist_etapas, i, buf, len);
+}
+
+static int linha_latencias(uint32_t i, char *buf, size_t len) {
+    return linha_histograma(&hist_latencias, i, buf, len);
+}
+
+static int linha_maximo(uint32_t i, char *buf, size_t len) {
+    if (i == 0) return snprintf(buf, len, "# TYPE estacionamento_etapa_max_segundos gauge\n");
+    return snprintf(buf, len, "estacionamento_etapa_max_segundos{etapa=\"%s\"} %.6f\n",
+                    nomes_etapas[i - 1], etapas[i - 1].max_us / 1e6);
+}
+#endif
+
+#if MEMP_STATS
+// Pools do lwIP que limitam o servidor (conexões, segmentos e pbufs)
+static const struct {
+    memp_t pool;
+    const char *nome;
+} pools[] = {
+    { MEMP_TCP_PCB,        "tcp_pcb" },
+    { MEMP_TCP_PCB_LISTEN, "tcp_pcb_listen" },
+    { MEMP_TCP_SEG,        "tcp_seg" },
+    { MEMP_UDP_PCB,        "udp_pcb" },
+    { MEMP_PBUF,           "pbuf" },
+    { MEMP_PBUF_POOL,      "pbuf_pool" },
+#if MEM_USE_POOLS
+    // Heap do lwIP em blocos fixos (lwippools.h)
+    { MEMP_POOL_128,       "mem_128" },
+    { MEMP_POOL_640,       "mem_640" },
+    { MEMP_POOL_1600,      "mem_1600" },
+#endif
+};
+#define N_POOLS (sizeof(pools) / sizeof(pools[0]))
+
+#define N_FAMILIAS_MEMP 4
+
+static int linha_memp(uint32_t i, char *buf, size_t len) {
+    static const char *const familias[N_FAMILIAS_MEMP][2] = {
+        { "estacionamento_lwip_memp_usados", "gauge" },
+        { "estacionamento_lwip_memp_max", "gauge" },
+        { "estacionamento_lwip_memp_total", "gauge" },
+        { "estacionamento_lwip_memp_erros_total", "counter" },
+    };
+    uint32_t f = i / (N_POOLS + 1);
+    uint32_t p = i % (N_POOLS + 1);
+
+    if (p == 0) return snprintf(buf, len, "# TYPE %s %s\n", familias[f][0], familias[f][1]);
+
+    const struct stats_mem *s = lwip_stats.memp[pools[p - 1].pool];
+    uint32_t valor = (f == 0) ? s->used : (f == 1) ? s->max : (f == 2) ? s->avail : s->err;
+    return snprintf(buf, len, "%s{pool=\"%s\"} %lu\n", familias[f][0], pools[p - 1].nome, valor);
+}
+#endif
+
+// Pools estáticos do firmware (memoria.h) e o heap da libc que sobrou
+#define N_FAMILIAS_MEMORIA 4
+#define LINHAS_MEMORIA     (N_FAMILIAS_MEMORIA * (MEMORIA_POOLS + 1) + 4)
+
+static int linha_memoria(uint32_t i, char *buf, size_t len) {
+    static const char *const familias[N_FAMILIAS_MEMORIA][2] = {
+        { "estacionamento_memoria_usados", "gauge" },
+        { "estacionamento_memoria_max", "gauge" },
+        { "estacionamento_memoria_total", "gauge" },
+        { "estacionamento_memoria_falhas_total", "counter" },
+    };
+    if (i < N_FAMILIAS_MEMORIA * (MEMORIA_POOLS + 1)) {
+        uint32_t f = i / (MEMORIA_POOLS + 1);
+        uint32_t p = i % (MEMORIA_POOLS + 1);
+
+        if (p == 0) return snprintf(buf, len, "# TYPE %s %s\n", familias[f][0], familias[f][1]);
+
+        const memoria_pool_t *m = memoria_get(p - 1);
+        uint32_t valor = (f == 0) ? m->usados : (f == 1) ? m->max : (f == 2) ? m->total : m->falhas;
+        return snprintf(buf, len, "%s{pool=\"%s\"} %lu\n", familias[f][0], memoria_nome(p - 1), valor);
+    }
+    i -= N_FAMILIAS_MEMORIA * (MEMORIA_POOLS + 1);
+    if (i == 0) return snprintf(buf, len, "# TYPE estacionamento_heap_bytes gauge\n");
+    if (i == 1) return snprintf(buf, len, "estacionamento_heap_bytes %u\n", (unsigned)memoria_heap_usado());
+    if (i == 2) return snprintf(buf, len, "# TYPE estacionamento_heap_max_bytes gauge\n");
+    return snprintf(buf, len, "estacionamento_heap_max_bytes %u\n", (unsigned)memoria_heap_max());
+}
+
+// Mensagens do log adiado, com as descartadas por falta de espaço no anel
+static int linha_log(uint32_t i, char *buf, size_t len) {
+    static const char *const resultados[] = { "gravadas", "descartadas", "escritas", "truncadas" };
+    const log_stats_t *s = log_get_stats();
+
+    if (i == 0) return snprintf(buf, len, "# TYPE estacionamento_log_mensagens_total counter\n");
+    uint32_t valores[] = { s->gravadas, s->descartadas, s->escritas, s->truncadas };
+    return snprintf(buf, len, "estacionamento_log_mensagens_total{resultado=\"%s\"} %lu\n",
+                    resultados[i - 1], valores[i - 1]);
+}
+
+// Servidor DHCP: mensagens por resultado, ocupação do pool e a reconexão
+// depois do boot (primeiro ACK e leases restaurados da flash)
+#define LINHAS_DHCP_EVENTOS 7
+#define LINHAS_DHCP         (1 + LINHAS_DHCP_EVENTOS + 4 * 2)
+
+static int linha_dhcp(uint32_t i, char *buf, size_t len) {
+    static const char *const eventos[LINHAS_DHCP_EVENTOS] = {
+        "oferta", "ack", "nak", "expirado", "esgotado", "reconectado", "gravacao_flash"
+    };
+    static const char *const simples[4][2] = {
+        { "estacionamento_dhcp_leases_em_uso", "gauge" },
+        { "estacionamento_dhcp_primeiro_ack_ms", "gauge" },
+        { "estacionamento_dhcp_leases_restaurados", "gauge" },
+        { "estacionamento_dhcp_falhas_flash_total", "counter" },
+    };
+    const dhcp_lease_tabela_t *t = wifi_ap_leases();
+    const dhcp_persistencia_stats_t *p = dhcp_persistencia_get_stats();
+
+    if (i == 0) return snprintf(buf, len, "# TYPE estacionamento_dhcp_eventos_total counter\n");
+    if (i <= LINHAS_DHCP_EVENTOS) {
+        uint32_t valores[LINHAS_DHCP_EVENTOS] = { t->stats.ofertas, t->stats.acks, t->stats.naks, t->stats.expiradas,
+                                                  t->stats.esgotado, t->stats.reconectados, p->gravacoes };
+        return snprintf(buf, len, "estacionamento_dhcp_eventos_total{tipo=\"%s\"} %lu\n", eventos[i - 1], valores[i - 1]);
+    }
+    i -= 1 + LINHAS_DHCP_EVENTOS;
+    if (i % 2 == 0) return snprintf(buf, len, "# TYPE %s %s\n", simples[i / 2][0], simples[i / 2][1]);
+    uint32_t valores[4] = { dhcp_lease_em_uso(t), t->stats.primeiro_ack_ms, p->restaurados, p->falhas };
+    return snprintf(buf, len, "%s %lu\n", simples[i / 2][0], valores[i / 2]);
+}
+
+// DNS do portal: consultas por resposta dada e repetições (o cliente
+// perguntou de novo a mesma coisa logo depois)
+#define LINHAS_DNS 8
+
+static int linha_dns(uint32_t i, char *buf, size_t len) {
+    static const char *const respostas[] = { "ignorada", "a", "vazia", "nxdomain", "sem_memoria" };
+    const dns_server_stats_t *s = wifi_ap_dns_stats();
+
+    if (i == 0) return snprintf(buf, len, "# TYPE estacionamento_dns_consultas_total counter\n");
+    if (i <= 5) {
+        uint32_t valor = (i <= DNS_RESPOSTA_TIPOS) ? s->answers[i - 1] : s->no_memory;
+        return snprintf(buf, len, "estacionamento_dns_consultas_total{resposta=\"%s\"} %lu\n", respostas[i - 1], valor);
+    }
+    if (i == 6) return snprintf(buf, len, "# TYPE estacionamento_dns_repeticoes_total counter\n");
+    return snprintf(buf, len, "estacionamento_dns_repeticoes_total %lu\n", s->repeats);
+}
+
+static const struct {
+    uint32_t linhas;
+    int (*gerar)(uint32_t i, char *buf, size_t len);
+} secoes[] = {
+#if METRICAS_ATIVAS
+    { 1 + METRICAS_ETAPAS * LINHAS_POR_ETAPA, linha_etapas },
+    { 1 + METRICAS_ETAPAS, linha_maximo },
+    { 1 + METRICAS_LATENCIAS * LINHAS_POR_ETAPA, linha_latencias },
+#endif
+#if MEMP_STATS
+    { N_FAMILIAS_MEMP * (N_POOLS + 1), linha_memp },
+#endif
+    { LINHAS_MEMORIA, linha_memoria },
+    { 5, linha_log },
+    { LINHAS_DHCP, linha_dhcp },
+    { LINHAS_DNS, linha_dns },
+};
+
+int metricas_linha(uint32_t indice, char *buf, size_t len) {
+    for (size_t s = 0; s < sizeof(secoes) / sizeof(secoes[0]); s++) {
+        if (indice < secoes[s].linhas) return secoes[s].gerar(indice, buf, len);
+        indice -= secoes[s].linhas;
+    }
+    return -1;
+}
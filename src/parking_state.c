@@ -1,7 +1,46 @@
 #include "parking_state.h"
 
-vaga_status_t vaga1_status = { false, 0 };
-vaga_status_t vaga2_status = { false, 0 };
+// nil_time é uma constante extern do SDK, não serve de inicializador estático:
+// os instantes recebem nil_time em vaga_init()
+vaga_status_t vaga1_status = {0};
+vaga_status_t vaga2_status = {0};
 
 bool localizar_vaga1 = false;
 bool localizar_vaga2 = false;
+uint64_t localizar_pedido_us = 0;
+
+void vaga_init(vaga_status_t *vaga) {
+    vaga->ocupada = false;
+    vaga->ocupada_desde = nil_time;
+    vaga->liberada_em = nil_time;
+    vaga->tempo_anterior_ms = 0;
+}
+
+// Só as transições são registradas: o instante da amostra que detectou a troca.
+// Retorna true quando houve chegada ou saída.
+bool vaga_atualizar(vaga_status_t *vaga, bool ocupada, absolute_time_t agora) {
+    if (ocupada == vaga->ocupada) return false;
+
+    if (ocupada) {
+        vaga->ocupada_desde = agora;
+        vaga->tempo_anterior_ms = 0;
+    } else {
+        vaga->liberada_em = agora;
+    }
+    vaga->ocupada = ocupada;
+    return true;
+}
+
+uint32_t vaga_tempo_ocupada_ms(const vaga_status_t *vaga) {
+    if (!vaga->ocupada) return 0;
+    return vaga->tempo_anterior_ms +
+           (uint32_t)(absolute_time_diff_us(vaga->ocupada_desde, get_absolute_time()) / 1000);
+}
+
+// Estado recuperado do log após um reset: o tempo em que a placa ficou
+// desligada não é conhecido, então a permanência continua de onde parou.
+void vaga_restaurar(vaga_status_t *vaga, bool ocupada, uint32_t tempo_ocupada_ms) {
+    vaga->ocupada = ocupada;
+    vaga->ocupada_desde = ocupada ? get_absolute_time() : nil_time;
+    vaga->tempo_anterior_ms = ocupada ? tempo_ocupada_ms : 0;
+}
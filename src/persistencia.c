@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+#include "pico/stdlib.h"
+
+#include "persistencia.h"
+#include "flash_store.h"
+#include "parking_state.h"
+#include "log.h"
+
+#define LOG_MAGIC              0x474F4C50  // "PLOG"
+#define LOG_VAGAS              2
+#define LOG_EVENTOS_POR_PAGINA 14
+#define LOG_PAGINAS_POR_SETOR  (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+#define LOG_TOTAL_PAGINAS      (FLASH_STORE_LOG_SETORES * LOG_PAGINAS_POR_SETOR)
+#define LOG_PAGINAS_HISTORICO  ((HISTORICO_CAPACIDADE + LOG_EVENTOS_POR_PAGINA - 1) / LOG_EVENTOS_POR_PAGINA)
+
+// Com vaga ocupada e sem eventos, grava o estado de tempos em tempos para que
+// a permanência sobreviva a um reset (erro máximo = este intervalo)
+#define PERSISTENCIA_SNAPSHOT_MS (10 * 60 * 1000)
+
+// Um registro = uma página da flash
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;                 // Sequência global das páginas (nunca se repete)
+    uint32_t ultimo_evento;       // Seq do último evento do histórico até esta página
+    uint32_t tempo_ocupada_ms[LOG_VAGAS];
+    uint16_t boot;
+    uint8_t ocupada[LOG_VAGAS];
+    uint8_t n_eventos;
+    uint8_t reservado[3];
+    evento_t eventos[LOG_EVENTOS_POR_PAGINA];
+    uint32_t crc;
+} log_pagina_t;
+
+static_assert(sizeof(log_pagina_t) == FLASH_PAGE_SIZE, "registro do log deve ocupar uma pagina");
+
+static log_pagina_t pagina;            // Lote em montagem na RAM
+static uint32_t proxima_pagina = 0;    // Índice (0..LOG_TOTAL_PAGINAS-1) da próxima gravação
+static uint32_t proximo_seq = 1;
+static uint64_t pendente_desde_us = 0;
+static uint64_t ultimo_commit_us = 0;
+static persistencia_stats_t stats;
+
+// ================= LEITURA DA FLASH =================
+
+static const log_pagina_t *ler_pagina(uint32_t indice) {
+    return (const log_pagina_t *)flash_store_ptr(FLASH_STORE_LOG_OFFSET + indice * FLASH_PAGE_SIZE);
+}
+
+static bool pagina_valida(const log_pagina_t *p) {
+    stats.paginas_lidas++;
+    if (p->magic != LOG_MAGIC || p->n_eventos > LOG_EVENTOS_POR_PAGINA) return false;
+    return flash_store_crc32(p, offsetof(log_pagina_t, crc)) == p->crc;
+}
+
+static bool pagina_apagada(const log_pagina_t *p) {
+    const uint32_t *w = (const uint32_t *)p;
+    for (size_t i = 0; i < FLASH_PAGE_SIZE / sizeof(uint32_t); i++) {
+        if (w[i] != 0xFFFFFFFF) return false;
+    }
+    return true;
+}
+
+// ================= RECUPERAÇÃO =================
+
+// Devolve ao anel de RAM os eventos das últimas páginas (o suficiente para
+// encher o histórico), percorrendo para trás enquanto o seq decrescer. Páginas
+// inválidas (gravação interrompida), repetidas ou só com o estado das vagas
+// são puladas; a volta completa no anel ou um seq maior (dados de antes do
+// rodízio) encerra a busca.
+static void restaurar_historico(uint32_t ultima) {
+    uint32_t paginas[LOG_PAGINAS_HISTORICO];
+    uint32_t n = 0;
+    uint32_t seq = ler_pagina(ultima)->seq;
+
+    if (ler_pagina(ultima)->n_eventos > 0) paginas[n++] = ultima;
+    for (uint32_t k = 1; k < LOG_TOTAL_PAGINAS && n < LOG_PAGINAS_HISTORICO; k++) {
+        uint32_t i = (ultima + LOG_TOTAL_PAGINAS - k) % LOG_TOTAL_PAGINAS;
+        const log_pagina_t *p = ler_pagina(i);
+        if (!pagina_valida(p) || p->seq == seq) continue;  // Inválida ou repetida
+        if (p->seq > seq) break;
+        seq = p->seq;
+        if (p->n_eventos > 0) paginas[n++] = i;
+    }
+
+    while (n > 0) {
+        const log_pagina_t *p = ler_pagina(paginas[--n]);
+        for (uint8_t e = 0; e < p->n_eventos; e++) historico_restaurar(&p->eventos[e]);
+    }
+}
+
+// Página de maior seq válido no setor (o setor tem ao menos uma válida).
+// Páginas com gravação interrompida são puladas, não encerram a varredura.
+static uint32_t ultima_do_setor(uint32_t setor) {
+    uint32_t ultima = 0;
+    uint32_t seq = 0;
+    for (uint32_t i = 0; i < LOG_PAGINAS_POR_SETOR; i++) {
+        uint32_t indice = setor * LOG_PAGINAS_POR_SETOR + i;
+        const log_pagina_t *p = ler_pagina(indice);
+        if (pagina_valida(p) && p->seq >= seq) {
+            ultima = indice;
+            seq = p->seq;
+        }
+    }
+    return ultima;
+}
+
+// Os setores são usados em rodízio e o seq só cresce: o setor mais recente é
+// o que tem o maior seq, e a última página é a de maior seq dentro dele.
+// Examina a primeira página válida de cada setor + as páginas de um setor.
+void persistencia_init(void) {
+    uint64_t t0 = time_us_64();
+    int setor = -1;
+    uint32_t maior_seq = 0;
+
+    for (uint32_t s = 0; s < FLASH_STORE_LOG_SETORES; s++) {
+        for (uint32_t i = 0; i < LOG_PAGINAS_POR_SETOR; i++) {
+            const log_pagina_t *p = ler_pagina(s * LOG_PAGINAS_POR_SETOR + i);
+            if (!pagina_valida(p)) continue;
+            if (setor < 0 || p->seq > maior_seq) {
+                setor = (int)s;
+                maior_seq = p->seq;
+            }
+            break;
+        }
+    }
+
+    if (setor >= 0) {
+        uint32_t ultima = ultima_do_setor((uint32_t)setor);
+
+        const log_pagina_t *ult = ler_pagina(ultima);
+        proximo_seq = ult->seq + 1;
+        stats.boot = ult->boot + 1;
+
+        vaga_restaurar(&vaga1_status, ult->ocupada[0], ult->tempo_ocupada_ms[0]);
+        vaga_restaurar(&vaga2_status, ult->ocupada[1], ult->tempo_ocupada_ms[1]);
+        restaurar_historico(ultima);
+        // Sem eventos na janela restaurada (vaga ocupada por horas, só
+        // snapshots) o seq dos próximos continua do cabeçalho, não de 1
+        historico_continuar(ult->ultimo_evento);
+
+        // Páginas com gravação interrompida (CRC inválido, não apagadas) são puladas
+        proxima_pagina = (ultima + 1) % LOG_TOTAL_PAGINAS;
+        while (proxima_pagina % LOG_PAGINAS_POR_SETOR != 0 && !pagina_apagada(ler_pagina(proxima_pagina))) {
+            proxima_pagina = (proxima_pagina + 1) % LOG_TOTAL_PAGINAS;
+        }
+    }
+
+    historico_set_boot((uint8_t)stats.boot);
+    memset(&pagina, 0, sizeof(pagina));
+    ultimo_commit_us = time_us_64();
+    stats.recuperacao_us = (uint32_t)(time_us_64() - t0);
+
+    LOG_INFO("Log na flash: boot %u, %lu paginas lidas em %lu us, proximo seq %lu",
+           stats.boot, stats.paginas_lidas, stats.recuperacao_us, proximo_seq);
+}
+
+// ================= GRAVAÇÃO =================
+
+// Grava o lote atual numa página. Ao entrar num setor novo ele é apagado
+// primeiro (o conteúdo mais antigo do log sai nesse momento).
+static void commit(void) {
+    uint64_t t0 = time_us_64();
+    uint32_t offset = FLASH_STORE_LOG_OFFSET + proxima_pagina * FLASH_PAGE_SIZE;
+
+    pagina.magic = LOG_MAGIC;
+    pagina.seq = proximo_seq;
+    pagina.boot = stats.boot;
+    pagina.ultimo_evento = historico_ultimo_seq();
+    pagina.ocupada[0] = vaga1_status.ocupada;
+    pagina.tempo_ocupada_ms[0] = vaga_tempo_ocupada_ms(&vaga1_status);
+    pagina.ocupada[1] = vaga2_status.ocupada;
+    pagina.tempo_ocupada_ms[1] = vaga_tempo_ocupada_ms(&vaga2_status);
+    pagina.crc = flash_store_crc32(&pagina, offsetof(log_pagina_t, crc));
+
+    if (proxima_pagina % LOG_PAGINAS_POR_SETOR == 0) {
+        if (!flash_store_erase_sector(offset)) {
+            stats.falhas++;
+            return; // Tenta de novo na próxima chamada
+        }
+        stats.setores_apagados++;
+    }
+    if (!flash_store_program_page(offset, &pagina)) {
+        stats.falhas++;
+        proxima_pagina = (proxima_pagina + 1) % LOG_TOTAL_PAGINAS; // Página possivelmente suja
+        return;
+    }
+
+    proxima_pagina = (proxima_pagina + 1) % LOG_TOTAL_PAGINAS;
+    proximo_seq++;
+
+    stats.paginas_gravadas++;
+    stats.eventos_gravados += pagina.n_eventos;
+    stats.bytes_eventos += pagina.n_eventos * sizeof(evento_t);
+    stats.bytes_flash += FLASH_PAGE_SIZE;
+    stats.commit_us = (uint32_t)(time_us_64() - t0);
+    if (stats.commit_us > stats.commit_max_us) stats.commit_max_us = stats.commit_us;
+
+    memset(&pagina, 0, sizeof(pagina));
+    pendente_desde_us = 0;
+    ultimo_commit_us = time_us_64();
+}
+
+void persistencia_evento(const evento_t *evento) {
+    if (!evento) return;
+
+    // Lote ainda cheio: o último commit falhou (apagamento ou programação).
+    // Tenta de novo; se a flash continuar recusando, o evento é descartado
+    // em vez de escrever além do lote.
+    if (pagina.n_eventos >= LOG_EVENTOS_POR_PAGINA) commit();
+    if (pagina.n_eventos >= LOG_EVENTOS_POR_PAGINA) {
+        stats.eventos_perdidos++;
+        return;
+    }
+
+    if (pagina.n_eventos == 0) pendente_desde_us = time_us_64();
+    pagina.eventos[pagina.n_eventos++] = *evento;
+    if (pagina.n_eventos == LOG_EVENTOS_POR_PAGINA) commit();
+}
+
+// Chamada a cada volta do laço: grava o lote quando o evento mais antigo
+// passou do prazo ou quando o estado de uma vaga ocupada precisa ser renovado.
+void persistencia_tarefa(void) {
+    uint64_t agora = time_us_64();
+
+    if (pagina.n_eventos > 0 && agora - pendente_desde_us >= (uint64_t)PERSISTENCIA_COMMIT_MS * 1000) {
+        commit();
+    } else if ((vaga1_status.ocupada || vaga2_status.ocupada) &&
+               agora - ultimo_commit_us >= (uint64_t)PERSISTENCIA_SNAPSHOT_MS * 1000) {
+        commit();
+    }
+}
+
+const persistencia_stats_t *persistencia_get_stats(void) {
+    return &stats;
+}
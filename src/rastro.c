@@ -0,0 +1,110 @@
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/critical_section.h"
+
+#include "rastro.h"
+#include "trace.h"
+
+#define INICIO_BYTES (1 + 2 + 4 + 8)
+#define ENTRADA_BYTES 8
+
+static rastro_entrada_t anel[RASTRO_CAPACIDADE];
+static uint32_t escrita = 0;          // Contador livre; a posição é & (RASTRO_CAPACIDADE - 1)
+static volatile bool congelado = false;
+static critical_section_t secao;      // Os dois núcleos registram (core1 durante o boot)
+
+// Despejo em andamento
+static bool inicio_pendente;
+static uint32_t despejo_primeiro;     // Contador livre da entrada mais antiga
+static uint32_t despejo_n;
+static uint32_t despejo_pos;          // Entradas já enviadas
+static uint64_t congelado_us;
+
+// ================= REGISTRO =================
+
+// Antes do primeiro RASTRO() e de lançar o core1
+void rastro_init(void) {
+    critical_section_init(&secao);
+}
+
+// Com o anel congelado os eventos são descartados: o despejo vê uma janela estável.
+void rastro_registrar(uint8_t id, uint32_t t_us, uint32_t arg) {
+    if (congelado) return;
+    if (arg > RASTRO_ARG_MAX) arg = RASTRO_ARG_MAX;
+
+    critical_section_enter_blocking(&secao);
+    rastro_entrada_t *e = &anel[escrita++ & (RASTRO_CAPACIDADE - 1)];
+    e->t_us = t_us;
+    e->id_arg = ((uint32_t)id << 24) | arg;
+    critical_section_exit(&secao);
+}
+
+// ================= DESPEJO =================
+
+static uint8_t *put_u16(uint8_t *p, uint16_t v) {
+    *p++ = (uint8_t)v;
+    *p++ = (uint8_t)(v >> 8);
+    return p;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) *p++ = (uint8_t)(v >> (8 * i));
+    return p;
+}
+
+bool rastro_despejar(void) {
+    if (congelado) return false;
+    congelado = true;
+
+    despejo_n = (escrita < RASTRO_CAPACIDADE) ? escrita : RASTRO_CAPACIDADE;
+    despejo_primeiro = escrita - despejo_n;
+    despejo_pos = 0;
+    congelado_us = time_us_64();
+    inicio_pendente = true;
+    return true;
+}
+
+bool rastro_despejando(void) {
+    return congelado;
+}
+
+// Só quadros inteiros: o despejo divide a CDC com o trace da decisão e o printf
+size_t rastro_ler(uint8_t *buf, size_t max) {
+    uint8_t p[2 + RASTRO_POR_QUADRO * ENTRADA_BYTES];
+    uint8_t *q;
+    size_t n = 0;
+
+    if (!congelado) return 0;
+
+    if (inicio_pendente) {
+        if (max < INICIO_BYTES + TRACE_QUADRO_EXTRA) return 0;
+        p[0] = RASTRO_VERSAO;
+        q = put_u16(p + 1, (uint16_t)despejo_n);
+        q = put_u32(q, escrita - despejo_n);
+        q = put_u32(q, (uint32_t)congelado_us);
+        put_u32(q, (uint32_t)(congelado_us >> 32));
+        n += trace_quadro(buf, TRACE_RASTRO_INICIO, p, INICIO_BYTES);
+        inicio_pendente = false;
+    }
+
+    while (despejo_pos < despejo_n) {
+        uint32_t k = despejo_n - despejo_pos;
+        if (k > RASTRO_POR_QUADRO) k = RASTRO_POR_QUADRO;
+        uint8_t len = (uint8_t)(2 + k * ENTRADA_BYTES);
+        if (max - n < len + TRACE_QUADRO_EXTRA) return n;
+
+        q = put_u16(p, (uint16_t)despejo_pos);
+        for (uint32_t i = 0; i < k; i++) {
+            const rastro_entrada_t *e = &anel[(despejo_primeiro + despejo_pos + i) & (RASTRO_CAPACIDADE - 1)];
+            q = put_u32(q, e->t_us);
+            q = put_u32(q, e->id_arg);
+        }
+        n += trace_quadro(buf + n, TRACE_RASTRO, p, len);
+        despejo_pos += k;
+    }
+
+    // Despejo completo: o anel recomeça vazio
+    escrita = 0;
+    congelado = false;
+    return n;
+}
@@ -0,0 +1,26 @@
+#include "pico/stdlib.h"
+
+#include "relogio.h"
+
+static uint64_t deslocamento_ms = 0;   // epoch_ms - ms desde o boot
+static bool definido = false;
+
+// Só o primeiro ajuste vale: evita que cada cliente com relógio diferente
+// desloque os horários já exibidos.
+bool relogio_definir(uint64_t epoch_ms) {
+    if (definido || epoch_ms == 0) return false;
+
+    deslocamento_ms = epoch_ms - to_us_since_boot(get_absolute_time()) / 1000;
+    definido = true;
+    return true;
+}
+
+bool relogio_definido(void) {
+    return definido;
+}
+
+// 0 quando o relógio ainda não foi definido
+uint64_t relogio_epoch_ms(absolute_time_t instante) {
+    if (!definido) return 0;
+    return deslocamento_ms + to_us_since_boot(instante) / 1000;
+}
@@ -1,11 +1,38 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <stddef.h>
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include "hardware/pwm.h"
 #include "vl53l0x.h"
 
 #include "sensor.h"
+#include "flash_store.h"
+#include "log.h"
+
+#define SENSOR_CAL_MAGIC  0x41434C56  // "VLCA"
+#define SENSOR_CAL_VERSAO 2
+
+// Registro da calibração dos VL53L0X no setor reservado da flash
+// (uma entrada por posição no barramento)
+typedef struct {
+    uint32_t magic;
+    uint16_t versao;
+    uint16_t tamanho;
+    uint8_t n_sensores;
+    vl53l0x_calibration cal[SENSOR_MAX_VL53L0X];
+    uint32_t crc;
+} sensor_cal_registro_t;
+
+static vl53l0x_calibration cal_atual[SENSOR_MAX_VL53L0X];
+static uint8_t n_cal = 0;
+static bool cal_pendente_valida = false;
+
+static uint16_t zona_parado_mm = 0;
+static uint16_t zona_livre_mm = 0;
+static sensor_stats_t stats;
 
 // =======================================================
 // === CONTROLE DE PWM PARA BUZZER =======================
@@ -36,14 +63,61 @@ void buzzer_off(void) {
 }
 
 
+// =======================================================
+// === CACHE DA CALIBRAÇÃO NA FLASH =======================
+// =======================================================
+
+static const vl53l0x_calibration *sensor_cal_carregar(uint8_t indice) {
+#if SENSOR_CACHE_CALIBRACAO
+    const sensor_cal_registro_t *reg =
+        (const sensor_cal_registro_t *)flash_store_ptr(FLASH_STORE_CALIBRACAO_OFFSET);
+
+    if (reg->magic != SENSOR_CAL_MAGIC || reg->versao != SENSOR_CAL_VERSAO ||
+        reg->tamanho != sizeof(sensor_cal_registro_t)) {
+        return NULL;
+    }
+    if (indice >= reg->n_sensores) return NULL;
+    if (flash_store_crc32(reg, offsetof(sensor_cal_registro_t, crc)) != reg->crc) return NULL;
+    return &reg->cal[indice];
+#else
+    (void)indice;
+    return NULL;
+#endif
+}
+
+static void sensor_cal_salvar(void) {
+#if SENSOR_CACHE_CALIBRACAO
+    sensor_cal_registro_t reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.magic = SENSOR_CAL_MAGIC;
+    reg.versao = SENSOR_CAL_VERSAO;
+    reg.tamanho = sizeof(reg);
+    reg.n_sensores = n_cal;
+    memcpy(reg.cal, cal_atual, n_cal * sizeof(vl53l0x_calibration));
+    reg.crc = flash_store_crc32(&reg, offsetof(sensor_cal_registro_t, crc));
+
+    if (!flash_store_write_sector(FLASH_STORE_CALIBRACAO_OFFSET, &reg, sizeof(reg))) {
+        LOG_ERRO("Falha ao salvar calibracao do VL53L0X");
+    }
+#endif
+}
+
+
+void sensor_commit_calibration(void) {
+    if (!cal_pendente_valida) return;
+    sensor_cal_salvar();
+    cal_pendente_valida = false;
+}
+
+
 // =======================================================
 // === INICIALIZAÇÃO DO VL53L0X + LEDS E BUZZER ===========
 // =======================================================
 
-void sensor_init(vl53l0x_dev *sensor_dev) {
+static void sensor_barramento_init(void) {
 
     // ---- Inicializa I2C0 (pinos 0 e 1) ----
-    i2c_init(I2C_SENSOR, 50 * 1000);
+    i2c_init(I2C_SENSOR, SENSOR_I2C_HZ);
     gpio_set_function(SDA_SENSOR, GPIO_FUNC_I2C);
     gpio_set_function(SCL_SENSOR, GPIO_FUNC_I2C);
     gpio_pull_up(SDA_SENSOR);
@@ -62,17 +136,124 @@ void sensor_init(vl53l0x_dev *sensor_dev) {
     gpio_init(BUZZER_PWM);
     gpio_set_dir(BUZZER_PWM, GPIO_OUT);
 
-    sleep_ms(500);
+#if SENSOR_INT_PIN >= 0
+    // GPIO1 do sensor é open-drain e ativo em nível baixo.
+    gpio_init(SENSOR_INT_PIN);
+    gpio_set_dir(SENSOR_INT_PIN, GPIO_IN);
+    gpio_pull_up(SENSOR_INT_PIN);
+#endif
+}
 
-    // ---- Inicializa sensor ----
-    if (!vl53l0x_init(sensor_dev, I2C_SENSOR)) {
-        printf(" Erro ao inicializar VL53L0X!\n");
-        while (1);
+// Reaplica a calibração salva quando ela pertence a este sensor;
+// caso contrário calibra do zero e marca o cache para atualização.
+static bool sensor_dispositivo_init(vl53l0x_dev *sensor_dev, uint8_t indice) {
+    uint64_t t_init = time_us_64();
+
+    if (!vl53l0x_init_with_calibration(sensor_dev, I2C_SENSOR, sensor_cal_carregar(indice),
+                                       &cal_atual[indice])) {
+        return false;
+    }
+    stats.init_us += (uint32_t)(time_us_64() - t_init);
+    stats.init_transacoes += sensor_dev->i2c_transactions;
+    if (!sensor_dev->calibration_from_cache) {
+        // A gravação fica para sensor_commit_calibration(): o init pode estar
+        // rodando no core1 enquanto o core0 executa da flash.
+        cal_pendente_valida = true;
     }
+    if (indice >= n_cal) n_cal = indice + 1;
+    return true;
+}
 
-    vl53l0x_start_continuous(sensor_dev, 0);
+// Liga a medição contínua de todos os sensores conforme o agendamento.
+// No modo intercalado cada sensor mede uma vez por período de N budgets e os
+// disparos partem defasados de um budget. Só a fase inicial é garantida: o
+// oscilador de cada sensor corre livre e a defasagem deriva com o tempo.
+static void sensor_iniciar_medicao(vl53l0x_dev *devs, uint8_t n, sensor_agenda_t agenda) {
+    if (agenda == SENSOR_AGENDA_PARALELO || n == 1) {
+        for (uint8_t i = 0; i < n; i++) {
+            if (devs[i].i2c) vl53l0x_start_continuous(&devs[i], 0);
+        }
+        return;
+    }
 
-    printf(" Sensor VL53L0X inicializado (I2C0)!\n");
+    uint32_t budget_us = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        if (devs[i].measurement_timing_budget_us > budget_us) budget_us = devs[i].measurement_timing_budget_us;
+    }
+    uint32_t passo_ms = budget_us / 1000 + 1;
+    uint32_t periodo_ms = passo_ms * n;
+
+    for (uint8_t i = 0; i < n; i++) {
+        if (devs[i].i2c) vl53l0x_start_continuous(&devs[i], periodo_ms);
+        if (i + 1 < n) sleep_ms(passo_ms);
+    }
+}
+
+// Sobe N sensores no mesmo barramento. Todos ficam em reset (XSHUT baixo) e são
+// liberados um a um: o recém-ligado responde em 0x29 e recebe um endereço
+// exclusivo antes do próximo sair do reset. Com xshut_pins == NULL há um único
+// sensor, que fica no endereço padrão. Sensores que falham ficam com i2c == NULL
+// e são ignorados pelo agendador.
+bool sensor_init_multi(vl53l0x_dev *devs, const uint8_t *xshut_pins, uint8_t n, sensor_agenda_t agenda) {
+    bool ok = true;
+    if (n > SENSOR_MAX_VL53L0X) n = SENSOR_MAX_VL53L0X;
+
+    sensor_barramento_init();
+
+    if (xshut_pins) {
+        for (uint8_t i = 0; i < n; i++) {
+            gpio_init(xshut_pins[i]);
+            gpio_set_dir(xshut_pins[i], GPIO_OUT);
+            gpio_put(xshut_pins[i], 0);
+        }
+        sleep_ms(1); // XSHUT precisa ficar baixo por pelo menos ~100 us
+    }
+
+    for (uint8_t i = 0; i < n; i++) {
+        vl53l0x_dev *dev = &devs[i];
+        memset(dev, 0, sizeof(*dev));
+
+        if (xshut_pins) gpio_put(xshut_pins[i], 1);
+
+        // Espera o sensor responder no barramento em vez de um atraso fixo.
+        if (!vl53l0x_wait_boot(I2C_SENSOR, VL53L0X_ADDRESS, SENSOR_BOOT_TIMEOUT_MS)) {
+            LOG_ERRO("VL53L0X %u nao respondeu no I2C!", i);
+            // Volta ao reset: se ele terminar o boot atrasado, responderia em
+            // 0x29 junto com o próximo
+            if (xshut_pins) gpio_put(xshut_pins[i], 0);
+            ok = false;
+            continue;
+        }
+
+        dev->i2c = I2C_SENSOR;
+        dev->address = VL53L0X_ADDRESS;
+        if (xshut_pins && !vl53l0x_set_address(dev, SENSOR_ENDERECO_BASE + i)) {
+            LOG_ERRO("VL53L0X %u nao aceitou o endereco 0x%02X!", i, SENSOR_ENDERECO_BASE + i);
+            gpio_put(xshut_pins[i], 0); // Libera 0x29 para o próximo
+            dev->i2c = NULL;
+            ok = false;
+            continue;
+        }
+
+        if (!sensor_dispositivo_init(dev, i)) {
+            LOG_ERRO("Erro ao inicializar VL53L0X %u!", i);
+            dev->i2c = NULL;
+            ok = false;
+        }
+    }
+
+    sensor_iniciar_medicao(devs, n, agenda);
+    stats.calibracao_cache = !cal_pendente_valida;
+
+    LOG_INFO("%u sensor(es) VL53L0X inicializado(s) (I2C0) em %lu us, %lu transacoes, calibracao %s!",
+           n, stats.init_us, stats.init_transacoes, stats.calibracao_cache ? "do cache" : "completa");
+    return ok;
+}
+
+void sensor_init(vl53l0x_dev *sensor_dev) {
+    if (!sensor_init_multi(sensor_dev, NULL, 1, SENSOR_AGENDA_PARALELO)) {
+        while (1);
+    }
 }
 
 
@@ -83,3 +264,206 @@ void sensor_init(vl53l0x_dev *sensor_dev) {
 uint16_t sensor_read_distance(vl53l0x_dev *sensor_dev) {
     return vl53l0x_read_range_continuous_millimeters(sensor_dev);
 }
+
+
+// =======================================================
+// === LEITURA POR LIMIAR (ZONA DE ATENÇÃO) ==============
+// =======================================================
+
+void sensor_set_attention_zone(vl53l0x_dev *sensor_dev, uint16_t parado_mm, uint16_t livre_mm) {
+    zona_parado_mm = parado_mm;
+    zona_livre_mm = livre_mm;
+
+    // Até a primeira amostra a vaga é tratada como dentro da zona.
+    vl53l0x_set_interrupt_mode(sensor_dev, VL53L0X_INT_NOVA_AMOSTRA, livre_mm, parado_mm);
+}
+
+// Escolhe o evento que deve acordar o MCU a partir da última distância lida:
+// vaga livre -> só interessa quando algo chegar abaixo de ZONA_LIVRE;
+// carro parado -> só interessa quando ele se afastar além de ZONA_PARADO;
+// dentro da zona de atenção -> todas as amostras.
+static void sensor_rearmar(vl53l0x_dev *sensor_dev, uint16_t mm) {
+    vl53l0x_int_mode modo;
+
+    if (mm >= zona_livre_mm) modo = VL53L0X_INT_ABAIXO;
+    else if (mm <= zona_parado_mm) modo = VL53L0X_INT_ACIMA;
+    else modo = VL53L0X_INT_NOVA_AMOSTRA;
+
+    // Limite inferior = ZONA_LIVRE (modo ABAIXO), superior = ZONA_PARADO (modo ACIMA).
+    if (modo != sensor_dev->int_mode) {
+        vl53l0x_set_interrupt_mode(sensor_dev, modo, zona_livre_mm, zona_parado_mm);
+        stats.trocas_modo++;
+    }
+}
+
+// Classifica a medida pelo status do dispositivo: alvo válido, alvo perto
+// demais, ausência de alvo (sinal/fase insuficientes) ou falha transitória a
+// ser descartada.
+static bool sensor_classificar(const vl53l0x_result *r, uint16_t *mm) {
+    uint8_t status = VL53L0X_RANGE_STATUS(r);
+
+    if (status == VL53L0X_STATUS_VALIDO) {
+        if (r->signal_rate < VL53L0X_MCPS_Q7(SENSOR_SINAL_MIN_MCPS)) {
+            *mm = SENSOR_SEM_ALVO;
+        } else {
+            *mm = r->range_mm;
+        }
+        return true;
+    }
+
+    switch (status) {
+        case 8:  // Abaixo do alcance mínimo
+        case 10: // Fase dobrada: reflexo forte junto do sensor
+            *mm = SENSOR_ALVO_MINIMO;
+            return true;
+        case 4:  // MSRC sem alvo
+        case 5:  // SNR baixo
+        case 6:  // Fase fora da faixa
+        case 9:  // Fase inconsistente
+        case 14: // Abaixo do limiar de ignorar
+            *mm = SENSOR_SEM_ALVO;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool sensor_poll_distance(vl53l0x_dev *sensor_dev, uint16_t *distancia_mm) {
+#if SENSOR_INT_PIN >= 0
+    // Sem evento no pino não há nada a fazer: nenhuma transação I2C.
+    if (gpio_get(SENSOR_INT_PIN)) return false;
+    stats.wakeups++;
+#else
+    // Sem o pino, um byte de status decide se vale a leitura em rajada: nos
+    // modos de limiar quase toda consulta termina aqui.
+    stats.wakeups++;
+    if (!vl53l0x_data_ready(sensor_dev)) return false;
+#endif
+
+    // Uma leitura em rajada traz status e resultado; sem dado pronto, para aqui.
+    uint32_t bytes = sensor_dev->i2c_bytes;
+    uint64_t t0 = time_us_64();
+    vl53l0x_result r;
+    if (!vl53l0x_read_result(sensor_dev, &r)) return false;
+
+    stats.amostras++;
+    stats.leitura_bytes += sensor_dev->i2c_bytes - bytes;
+    uint32_t dt = (uint32_t)(time_us_64() - t0);
+    stats.leitura_us += dt;
+    if (dt > stats.leitura_max_us) stats.leitura_max_us = dt;
+
+    uint16_t mm;
+    if (!sensor_classificar(&r, &mm)) {
+        stats.descartadas++;
+        return false;
+    }
+
+    if (zona_livre_mm != 0) sensor_rearmar(sensor_dev, mm);
+
+    if (stats.primeira_leitura_us == 0 && mm != SENSOR_SEM_ALVO) {
+        stats.primeira_leitura_us = time_us_64();
+    }
+
+    *distancia_mm = mm;
+    return true;
+}
+
+// Agendador do barramento: consulta os sensores em rodízio a partir do que vem
+// depois do último atendido, para que nenhum fique sem ser lido quando vários
+// têm amostra pronta ao mesmo tempo.
+bool sensor_poll_next(vl53l0x_dev *devs, uint8_t n, uint8_t *indice, uint16_t *distancia_mm) {
+    static uint8_t proximo = 0;
+
+    for (uint8_t k = 0; k < n; k++) {
+        uint8_t i = (proximo + k) % n;
+        if (!devs[i].continuous) continue;
+
+        if (sensor_poll_distance(&devs[i], distancia_mm)) {
+            proximo = (i + 1) % n;
+            *indice = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const sensor_stats_t *sensor_get_stats(void) {
+    return &stats;
+}
+
+
+// =======================================================
+// === PERFIS DE MEDIÇÃO ==================================
+// =======================================================
+
+bool sensor_set_profile(vl53l0x_dev *sensor_dev, vl53l0x_profile perfil) {
+    return vl53l0x_set_profile(sensor_dev, perfil);
+}
+
+// Mede a taxa real de amostragem e o jitter de um perfil. Bloqueia por
+// aproximadamente n_amostras * budget; usar apenas para diagnóstico.
+bool sensor_measure_profile(vl53l0x_dev *sensor_dev, vl53l0x_profile perfil,
+                            uint32_t n_amostras, sensor_perfil_medida_t *medida) {
+    vl53l0x_profile perfil_anterior = sensor_dev->profile;
+    vl53l0x_int_mode modo_anterior = sensor_dev->int_mode;
+
+    // Zerada antes de qualquer retorno: quem chama pode imprimir mesmo em falha
+    *medida = (sensor_perfil_medida_t){ .perfil = perfil };
+
+    if (n_amostras < 2 || !vl53l0x_set_profile(sensor_dev, perfil)) return false;
+    vl53l0x_set_interrupt_mode(sensor_dev, VL53L0X_INT_NOVA_AMOSTRA, zona_livre_mm, zona_parado_mm);
+
+    // Descarta a primeira amostra (pode ter começado antes da troca).
+    vl53l0x_read_range_continuous_millimeters(sensor_dev);
+    uint64_t anterior = time_us_64();
+
+    // Média e variância incrementais (Welford).
+    double media = 0, m2 = 0;
+    uint32_t min_us = UINT32_MAX, max_us = 0, n = 0;
+
+    for (uint32_t i = 0; i < n_amostras; i++) {
+        if (vl53l0x_read_range_continuous_millimeters(sensor_dev) == 65535) break;
+
+        uint64_t agora = time_us_64();
+        uint32_t intervalo = (uint32_t)(agora - anterior);
+        anterior = agora;
+
+        n++;
+        double delta = intervalo - media;
+        media += delta / n;
+        m2 += delta * (intervalo - media);
+        if (intervalo < min_us) min_us = intervalo;
+        if (intervalo > max_us) max_us = intervalo;
+    }
+
+    medida->perfil = perfil;
+    medida->budget_us = sensor_dev->measurement_timing_budget_us;
+    medida->amostras = n;
+    medida->taxa_hz = (media > 0) ? (float)(1e6 / media) : 0.0f;
+    medida->intervalo_medio_us = (uint32_t)media;
+    medida->intervalo_min_us = n ? min_us : 0;
+    medida->intervalo_max_us = max_us;
+    medida->jitter_us = (n > 1) ? (uint32_t)sqrt(m2 / (n - 1)) : 0;
+
+    vl53l0x_set_profile(sensor_dev, perfil_anterior);
+    vl53l0x_set_interrupt_mode(sensor_dev, modo_anterior, zona_livre_mm, zona_parado_mm);
+    return n == n_amostras;
+}
+
+// Taxa agregada (amostras/s somando todos os sensores) com o agendamento atual.
+// Deve rodar antes de sensor_set_attention_zone(): nos modos de limiar só os
+// cruzamentos geram amostra. Bloqueia por duracao_ms; usar apenas para diagnóstico.
+float sensor_measure_bus(vl53l0x_dev *devs, uint8_t n, uint32_t duracao_ms) {
+    absolute_time_t fim = make_timeout_time_ms(duracao_ms);
+    uint64_t t0 = time_us_64();
+    uint32_t amostras = 0;
+
+    while (!time_reached(fim)) {
+        uint8_t i;
+        uint16_t mm;
+        if (sensor_poll_next(devs, n, &i, &mm)) amostras++;
+    }
+
+    uint64_t dt = time_us_64() - t0;
+    return dt ? (float)(amostras * 1e6 / dt) : 0.0f;
+}
@@ -1,57 +1,220 @@
 #include <stdio.h>
+#include <assert.h>
 #include "pico/stdlib.h"
+#include "pico/critical_section.h"
 #include "hardware/gpio.h"
-#include "hardware/timer.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
 #include "sensor_ultrasonico.h"
+#include "sensor_ultrasonico.pio.h"
+#include "metricas.h"
+#include "log.h"
 
 // Velocidade do som: 340 m/s = 0.034 cm/us
 #define SOUND_SPEED_CM_US 0.034f
 
-// Timeout para evitar travamento (em microssegundos)
+// Limite da largura do ECHO, contado na SM (em microssegundos)
 #define ECHO_TIMEOUT_US 30000  // ~5 metros
 
-// ================= INIT =================
-void sensor_ultrasonico_init(void) {
-    gpio_init(TRIG_PIN);
-    gpio_set_dir(TRIG_PIN, GPIO_OUT);
-    gpio_put(TRIG_PIN, 0);
+// Tempo máximo entre o fim do TRIG e a subida do ECHO
+#define ECHO_SUBIDA_US 1000
+
+// Tempo para o HC-SR04 estabilizar após o power-on
+#define ULTRASONICO_BOOT_MS 50
+
+// Folga na comparação com o próximo disparo: o timer dos slots tem jitter
+#define MEIO_SLOT_US (ULTRASONICO_SLOT_MS * 1000 / 2)
+
+// Palavra de disparo da SM: timeout de subida (16 bits baixos) e limite da largura
+#define DISPARO ((uint32_t)ECHO_TIMEOUT_US << 16 | ECHO_SUBIDA_US)
+static_assert(ECHO_TIMEOUT_US <= 0xFFFF && ECHO_SUBIDA_US <= 0xFFFF, "limites da SM tem 16 bits");
+static_assert(ECHO_SUBIDA_US + ECHO_TIMEOUT_US < ULTRASONICO_SLOT_MS * 1000, "a SM deve terminar dentro do slot");
+
+// Valor escrito antes do disparo; o DMA o substitui pelo resultado da SM
+#define RESULTADO_PENDENTE 0xFFFFFFFF
+
+typedef struct {
+    uint sm;
+    int dma;
+    volatile uint32_t resultado;    // Escrito pelo DMA a partir do RX FIFO da SM
+    float distancia_cm;             // Última medida convertida
+    volatile bool nova;
+    bool disparado;                 // Disparado no slot que acabou de terminar
+    volatile uint32_t intervalo_us; // Intervalo mínimo entre disparos (0 = todo slot do grupo)
+    uint64_t proximo_us;
+    uint32_t disparos;
+} canal_ultra_t;
 
-    gpio_init(ECHO_PIN);
-    gpio_set_dir(ECHO_PIN, GPIO_IN);
+static canal_ultra_t canais[ULTRASONICO_MAX_CANAIS];
+static uint8_t n_canais = 0;
+static uint8_t n_grupos = 1;
+static PIO pio;
 
-    sleep_ms(50);
+static repeating_timer_t timer_slots;
+static uint8_t grupo_atual = 0;
+static bool primeiro_slot = true;
+static critical_section_t secao;    // distancia_cm + nova, entre o slot e a leitura
+
+// ================= AGENDAMENTO =================
+
+static bool no_grupo(uint8_t canal, uint8_t grupo) {
+    return (canal % n_grupos) == grupo;
 }
 
-// ================= LEITURA =================
-float sensor_ultrasonico_ler_distancia_cm(void) {
-    absolute_time_t inicio, fim, timeout;
-
-    // Pulso de trigger
-    gpio_put(TRIG_PIN, 0);
-    sleep_us(2);
-    gpio_put(TRIG_PIN, 1);
-    sleep_us(10);
-    gpio_put(TRIG_PIN, 0);
-
-    // Aguarda ECHO subir (com timeout)
-    timeout = make_timeout_time_us(ECHO_TIMEOUT_US);
-    while (gpio_get(ECHO_PIN) == 0) {
-        if (time_reached(timeout)) {
-            return -1.0f; // erro / fora de alcance
+// Roda a cada ULTRASONICO_SLOT_MS em contexto de interrupção: converte o
+// resultado do grupo que acabou de medir e dispara o próximo. O custo é fixo
+// (alguns acessos a registradores por canal), independente da largura do eco.
+static bool slot_callback(repeating_timer_t *rt) {
+    (void)rt;
+    METRICA_INICIO(slot);
+
+    if (!primeiro_slot) {
+        for (uint8_t i = 0; i < n_canais; i++) {
+            if (!no_grupo(i, grupo_atual) || !canais[i].disparado) continue;
+            canais[i].disparado = false;
+
+            uint32_t r = canais[i].resultado;
+            float cm = -1.0f; // sem eco / fora de alcance
+            if (r != RESULTADO_PENDENTE && r != 0 && r < ECHO_TIMEOUT_US) {
+                cm = ((ECHO_TIMEOUT_US - r) * SOUND_SPEED_CM_US) / 2.0f;
+            }
+            critical_section_enter_blocking(&secao);
+            canais[i].distancia_cm = cm;
+            canais[i].nova = true;
+            critical_section_exit(&secao);
         }
+        grupo_atual = (grupo_atual + 1) % n_grupos;
     }
-    inicio = get_absolute_time();
+    primeiro_slot = false;
 
-    // Aguarda ECHO descer (com timeout)
-    timeout = make_timeout_time_us(ECHO_TIMEOUT_US);
-    while (gpio_get(ECHO_PIN) == 1) {
-        if (time_reached(timeout)) {
-            return -1.0f;
+    // Canais em amostragem lenta pulam os slots do grupo até o próximo disparo
+    uint64_t agora = time_us_64();
+    for (uint8_t i = 0; i < n_canais; i++) {
+        canal_ultra_t *c = &canais[i];
+        if (!no_grupo(i, grupo_atual) || agora + MEIO_SLOT_US < c->proximo_us) continue;
+        // A SM ainda não entregou o disparo anterior: não há como rearmar
+        if (dma_channel_is_busy(c->dma)) continue;
+
+        // Uma palavra por disparo: o DMA é rearmado antes da SM receber a ordem
+        c->resultado = RESULTADO_PENDENTE;
+        dma_channel_set_trans_count(c->dma, 1, true);
+        c->disparado = true;
+        c->proximo_us = agora + c->intervalo_us;
+        c->disparos++;
+        pio_sm_put(pio, c->sm, DISPARO);
+    }
+    METRICA_FIM(slot, ETAPA_ULTRASSONICO);
+    return true;
+}
+
+static int64_t iniciar_slots(alarm_id_t id, void *user_data) {
+    (void)id; (void)user_data;
+    add_repeating_timer_ms(-ULTRASONICO_SLOT_MS, slot_callback, NULL, &timer_slots);
+    return 0;
+}
+
+// ================= INIT =================
+
+// Cada canal ganha uma SM (mesmo programa) e um canal de DMA que copia o
+// RX FIFO para canais[i].resultado: a CPU nunca espera pelo ECHO.
+uint8_t sensor_ultrasonico_init_multi(const ultrasonico_pinos_t *pinos, uint8_t n) {
+    uint offset;
+    uint sm;
+
+    if (n > ULTRASONICO_MAX_CANAIS) n = ULTRASONICO_MAX_CANAIS;
+    if (n == 0 || !pio_claim_free_sm_and_add_program(&sensor_ultrasonico_program, &pio, &sm, &offset)) {
+        LOG_ERRO("Ultrassonico: sem state machine livre!");
+        return 0;
+    }
+    critical_section_init(&secao);
+
+    for (uint8_t i = 0; i < n; i++) {
+        if (i > 0) {
+            int livre = pio_claim_unused_sm(pio, false);
+            if (livre < 0) break;
+            sm = (uint)livre;
         }
+
+        canal_ultra_t *c = &canais[i];
+        c->sm = sm;
+        c->resultado = RESULTADO_PENDENTE;
+        c->distancia_cm = -1.0f;
+        c->nova = false;
+        c->disparado = false;
+        c->intervalo_us = 0;
+        c->proximo_us = 0;
+        c->disparos = 0;
+
+        gpio_init(pinos[i].echo);
+        gpio_set_dir(pinos[i].echo, GPIO_IN);
+        sensor_ultrasonico_program_init(pio, sm, offset, pinos[i].trig, pinos[i].echo);
+
+        // Sem incremento e uma palavra por vez: o slot rearma o canal a cada
+        // disparo, então um push que sobre nunca é lido como resultado novo.
+        c->dma = dma_claim_unused_channel(true);
+        dma_channel_config cfg = dma_channel_get_default_config(c->dma);
+        channel_config_set_transfer_data_size(&cfg, DMA_SIZE_32);
+        channel_config_set_read_increment(&cfg, false);
+        channel_config_set_write_increment(&cfg, false);
+        channel_config_set_dreq(&cfg, pio_get_dreq(pio, sm, false));
+        dma_channel_configure(c->dma, &cfg, &c->resultado, &pio->rxf[sm], 1, false);
+
+        n_canais++;
     }
-    fim = get_absolute_time();
 
-    int64_t tempo_us = absolute_time_diff_us(inicio, fim);
+    n_grupos = (n_canais < ULTRASONICO_GRUPOS) ? n_canais : ULTRASONICO_GRUPOS;
+
+    // Sem espera aqui: os disparos só começam depois da estabilização.
+    add_alarm_in_ms(ULTRASONICO_BOOT_MS, iniciar_slots, NULL, true);
+
+    LOG_INFO("Ultrassonico: %u canal(is) em PIO, %.1f Hz por canal",
+           n_canais, sensor_ultrasonico_taxa_canal_hz());
+    return n_canais;
+}
+
+void sensor_ultrasonico_init(void) {
+    static const ultrasonico_pinos_t pinos = { TRIG_PIN, ECHO_PIN };
+    sensor_ultrasonico_init_multi(&pinos, 1);
+}
+
+// ================= LEITURA NÃO BLOQUEANTE =================
+bool sensor_ultrasonico_resultado(uint8_t canal, float *distancia_cm) {
+    if (canal >= n_canais || !canais[canal].nova) return false;
+
+    // O slot pode publicar outra medida entre a leitura e a limpeza de "nova"
+    critical_section_enter_blocking(&secao);
+    bool nova = canais[canal].nova;
+    canais[canal].nova = false;
+    *distancia_cm = canais[canal].distancia_cm;
+    critical_section_exit(&secao);
+    return nova;
+}
+
+bool sensor_ultrasonico_pendente(uint8_t canal) {
+    return canal < n_canais && canais[canal].nova;
+}
+
+// O disparo continua alinhado aos slots do grupo: o intervalo efetivo é o
+// pedido arredondado para cima até o próximo slot do canal.
+void sensor_ultrasonico_set_intervalo(uint8_t canal, uint32_t intervalo_ms) {
+    if (canal < n_canais) canais[canal].intervalo_us = intervalo_ms * 1000;
+}
+
+uint32_t sensor_ultrasonico_disparos(uint8_t canal) {
+    return (canal < n_canais) ? canais[canal].disparos : 0;
+}
+
+float sensor_ultrasonico_taxa_canal_hz(void) {
+    return 1000.0f / (ULTRASONICO_SLOT_MS * n_grupos);
+}
+
+// ================= LEITURA =================
+float sensor_ultrasonico_ler_distancia_cm(void) {
+    float distancia_cm;
 
-    return (tempo_us * SOUND_SPEED_CM_US) / 2.0f;
+    // Espera a próxima medida do canal 0
+    while (!sensor_ultrasonico_resultado(0, &distancia_cm)) {
+        tight_loop_contents();
+    }
+    return distancia_cm;
 }
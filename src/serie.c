@@ -0,0 +1,208 @@
+#include <assert.h>
+#include "pico/stdlib.h"
+
+#include "serie.h"
+#include "sensor.h"
+
+#define SERIE_VERSAO 1
+
+// Piores casos da codificação: varint de 32 bits = 5 bytes, zig-zag de uma
+// diferença de 16 bits = 3 bytes
+#define CABECALHO_MAX_BYTES (3 + 5 + 5)
+#define PONTO_MAX_BYTES     (3 * 3)
+
+static_assert(SENSOR_SEM_ALVO == SERIE_SEM_DADO, "sem alvo deve coincidir com sem dado");
+
+// Período em acumulação de um anel agregado
+typedef struct {
+    bool iniciado;
+    uint32_t primeiro;       // Primeiro período registrado neste boot
+    uint32_t atual;          // Período em acumulação (ainda fora do anel)
+    uint32_t soma;
+    uint16_t n;
+    uint16_t min;
+    uint16_t max;
+} serie_acumulador_t;
+
+typedef struct {
+    uint32_t bruta_t_ms[SERIE_BRUTA_N];
+    uint16_t bruta_mm[SERIE_BRUTA_N];
+    uint32_t bruta_total;    // Amostras recebidas; a posição no anel é total % N
+    serie_ponto_t seg[SERIE_SEG_N];
+    serie_ponto_t min[SERIE_MIN_N];
+    serie_acumulador_t acumulador[SERIE_RESOLUCOES - 1];
+} serie_canal_t;
+
+static serie_canal_t canais[SERIE_CANAIS];
+
+static const uint64_t periodo_us[SERIE_RESOLUCOES] = { 0, 1000000ULL, 60000000ULL };
+
+static serie_ponto_t *pontos_de(serie_canal_t *c, serie_resolucao_t r, uint32_t *capacidade) {
+    if (r == SERIE_1S) {
+        *capacidade = SERIE_SEG_N;
+        return c->seg;
+    }
+    *capacidade = SERIE_MIN_N;
+    return c->min;
+}
+
+// ================= REGISTRO =================
+
+// Grava o período atual no anel e passa para o seguinte
+static void fechar(serie_canal_t *c, serie_resolucao_t r) {
+    serie_acumulador_t *a = &c->acumulador[r - 1];
+    uint32_t capacidade;
+    serie_ponto_t *p = &pontos_de(c, r, &capacidade)[a->atual % capacidade];
+
+    if (a->n == 0) {
+        p->min = p->media = p->max = SERIE_SEM_DADO;
+    } else {
+        p->min = a->min;
+        p->media = (uint16_t)((a->soma + a->n / 2) / a->n);
+        p->max = a->max;
+    }
+    a->atual++;
+    a->soma = 0;
+    a->n = 0;
+}
+
+static void acumular(serie_canal_t *c, serie_resolucao_t r, uint16_t mm, uint64_t t_us) {
+    serie_acumulador_t *a = &c->acumulador[r - 1];
+    uint32_t periodo = (uint32_t)(t_us / periodo_us[r]);
+    uint32_t capacidade;
+    pontos_de(c, r, &capacidade);
+
+    if (!a->iniciado) {
+        a->iniciado = true;
+        a->primeiro = a->atual = periodo;
+    }
+
+    // Períodos sem leitura entram como sem dado; um intervalo maior que o
+    // anel só precisa preencher as últimas 'capacidade' posições
+    if (periodo > a->atual + capacidade) {
+        a->atual = periodo - capacidade;
+        a->soma = 0;
+        a->n = 0;
+    }
+    while (a->atual < periodo) fechar(c, r);
+
+    if (mm == SERIE_SEM_DADO) return;
+    if (a->n == 0 || mm < a->min) a->min = mm;
+    if (a->n == 0 || mm > a->max) a->max = mm;
+    a->soma += mm;
+    a->n++;
+}
+
+void serie_registrar(uint8_t canal, uint16_t distancia_mm, uint64_t t_us) {
+    if (canal >= SERIE_CANAIS) return;
+    serie_canal_t *c = &canais[canal];
+
+    uint32_t i = c->bruta_total % SERIE_BRUTA_N;
+    c->bruta_t_ms[i] = (uint32_t)(t_us / 1000);
+    c->bruta_mm[i] = distancia_mm;
+    c->bruta_total++;
+
+    acumular(c, SERIE_1S, distancia_mm, t_us);
+    acumular(c, SERIE_1MIN, distancia_mm, t_us);
+}
+
+// ================= EXPORTAÇÃO =================
+
+static size_t put_varint(uint8_t *buf, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        buf[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = (uint8_t)v;
+    return n;
+}
+
+// Diferenças pequenas, positivas ou negativas, viram varints de 1 byte
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+// Fixa a janela no início: pontos que chegarem depois ficam para a próxima consulta
+bool serie_exportar_iniciar(serie_cursor_t *cursor, uint8_t canal, serie_resolucao_t resolucao) {
+    if (canal >= SERIE_CANAIS || resolucao >= SERIE_RESOLUCOES) return false;
+    serie_canal_t *c = &canais[canal];
+
+    cursor->canal = canal;
+    cursor->resolucao = resolucao;
+    cursor->cabecalho_enviado = false;
+    cursor->anterior[0] = cursor->anterior[1] = cursor->anterior[2] = 0;
+
+    if (resolucao == SERIE_BRUTA) {
+        cursor->fim = c->bruta_total;
+        cursor->proximo = (c->bruta_total > SERIE_BRUTA_N) ? c->bruta_total - SERIE_BRUTA_N : 0;
+        cursor->t_anterior = (cursor->proximo < cursor->fim)
+                           ? c->bruta_t_ms[cursor->proximo % SERIE_BRUTA_N] : 0;
+    } else {
+        const serie_acumulador_t *a = &c->acumulador[resolucao - 1];
+        uint32_t capacidade;
+        pontos_de(c, resolucao, &capacidade);
+
+        cursor->fim = a->iniciado ? a->atual : 0;
+        cursor->proximo = a->iniciado ? a->primeiro : 0;
+        if (cursor->fim - cursor->proximo > capacidade) cursor->proximo = cursor->fim - capacidade;
+        cursor->t_anterior = cursor->proximo;
+    }
+    return true;
+}
+
+// Codifica o cabeçalho (se faltar) e quantos pontos inteiros couberem em buf.
+// Um ponto sobrescrito durante o envio sai como sem dado, mantendo o n anunciado.
+size_t serie_exportar(serie_cursor_t *cursor, uint8_t *buf, size_t len) {
+    serie_canal_t *c = &canais[cursor->canal];
+    size_t pos = 0;
+
+    if (!cursor->cabecalho_enviado) {
+        if (len < CABECALHO_MAX_BYTES) return 0;
+        buf[pos++] = SERIE_VERSAO;
+        buf[pos++] = cursor->canal;
+        buf[pos++] = cursor->resolucao;
+        pos += put_varint(buf + pos, cursor->fim - cursor->proximo);
+        pos += put_varint(buf + pos, cursor->t_anterior);
+        cursor->cabecalho_enviado = true;
+    }
+
+    while (cursor->proximo < cursor->fim && len - pos >= PONTO_MAX_BYTES) {
+        uint16_t v[3] = { SERIE_SEM_DADO, SERIE_SEM_DADO, SERIE_SEM_DADO };
+        int n_valores;
+
+        if (cursor->resolucao == SERIE_BRUTA) {
+            uint32_t t = cursor->t_anterior;
+            if (cursor->proximo + SERIE_BRUTA_N >= c->bruta_total) {
+                uint32_t i = cursor->proximo % SERIE_BRUTA_N;
+                t = c->bruta_t_ms[i];
+                v[0] = c->bruta_mm[i];
+            }
+            pos += put_varint(buf + pos, t - cursor->t_anterior);
+            cursor->t_anterior = t;
+            n_valores = 1;
+        } else {
+            const serie_acumulador_t *a = &c->acumulador[cursor->resolucao - 1];
+            uint32_t capacidade;
+            const serie_ponto_t *p = pontos_de(c, cursor->resolucao, &capacidade);
+            if (cursor->proximo + capacidade >= a->atual) {
+                p += cursor->proximo % capacidade;
+                v[0] = p->min;
+                v[1] = p->media;
+                v[2] = p->max;
+            }
+            n_valores = 3;
+        }
+
+        for (int j = 0; j < n_valores; j++) {
+            pos += put_varint(buf + pos, zigzag((int32_t)v[j] - cursor->anterior[j]));
+            cursor->anterior[j] = v[j];
+        }
+        cursor->proximo++;
+    }
+    return pos;
+}
+
+bool serie_exportar_fim(const serie_cursor_t *cursor) {
+    return cursor->cabecalho_enviado && cursor->proximo >= cursor->fim;
+}
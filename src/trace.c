@@ -0,0 +1,188 @@
+#include <assert.h>
+#include <string.h>
+
+#include "trace.h"
+
+#define INICIO_BYTES  (1 + 1 + 8 + DECISAO_ESTADO_BYTES)
+#define CICLO_BYTES   (1 + 4 + 2 + 2 + 1)
+#define COMANDO_BYTES (1 + 4 + 1 + 1)
+
+static_assert(INICIO_BYTES + TRACE_QUADRO_EXTRA <= 64, "todo quadro cabe num pacote da CDC");
+
+static uint8_t buffer[TRACE_BUFFER_BYTES];
+static uint32_t escrita = 0;   // Contadores livres; a posição é & (TRACE_BUFFER_BYTES - 1)
+static uint32_t leitura = 0;
+static bool ativo = false;
+static bool inicio_pendente = true;
+static uint32_t ciclos_sem_inicio = 0;
+static uint8_t seq = 0;
+static trace_stats_t stats;
+
+// ================= CODIFICAÇÃO =================
+
+// CRC-8 (polinômio 0x07) continuado a partir de 'crc'
+static uint8_t crc8_atualizar(uint8_t crc, const uint8_t *dados, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= dados[i];
+        for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+uint8_t trace_crc8(const uint8_t *dados, size_t len) {
+    return crc8_atualizar(0, dados, len);
+}
+
+static void put(uint8_t b) {
+    buffer[escrita++ & (TRACE_BUFFER_BYTES - 1)] = b;
+}
+
+static void quadro(trace_tipo_t tipo, const uint8_t *payload, uint8_t len) {
+    uint8_t cab[2] = { (uint8_t)tipo, len };
+    uint8_t crc = crc8_atualizar(trace_crc8(cab, 2), payload, len);
+
+    put(TRACE_SYNC0);
+    put(TRACE_SYNC1);
+    put(cab[0]);
+    put(cab[1]);
+    for (uint8_t i = 0; i < len; i++) put(payload[i]);
+    put(crc);
+
+    stats.quadros++;
+    stats.bytes += len + TRACE_QUADRO_EXTRA;
+}
+
+size_t trace_quadro(uint8_t *buf, trace_tipo_t tipo, const uint8_t *payload, uint8_t len) {
+    buf[0] = TRACE_SYNC0;
+    buf[1] = TRACE_SYNC1;
+    buf[2] = (uint8_t)tipo;
+    buf[3] = len;
+    memcpy(buf + 4, payload, len);
+    buf[4 + len] = trace_crc8(buf + 2, len + 2);
+    return len + TRACE_QUADRO_EXTRA;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) *p++ = (uint8_t)(v >> (8 * i));
+    return p;
+}
+
+void trace_ativar(bool ligado) {
+    if (ligado && !ativo) inicio_pendente = true;
+    ativo = ligado;
+}
+
+bool trace_ativo(void) {
+    return ativo;
+}
+
+// Um ciclo vai inteiro (início + comandos + leituras) ou não vai: sem espaço,
+// é descartado e o próximo recomeça com um TRACE_INICIO. Um TRACE_INICIO a
+// cada TRACE_INICIO_CICLOS deixa o replay se recuperar de qualquer lacuna.
+void trace_registrar_ciclo(const decisao_t *d, const decisao_entrada_t *e) {
+    if (!ativo) return;
+    if (ciclos_sem_inicio >= TRACE_INICIO_CICLOS) inicio_pendente = true;
+
+    size_t necessario = CICLO_BYTES + TRACE_QUADRO_EXTRA;
+    if (inicio_pendente) necessario += INICIO_BYTES + TRACE_QUADRO_EXTRA;
+    for (int i = 0; i < 2; i++) {
+        if (e->localizar[i]) necessario += COMANDO_BYTES + TRACE_QUADRO_EXTRA;
+    }
+    if (TRACE_BUFFER_BYTES - (escrita - leitura) < necessario) {
+        stats.descartados++;
+        inicio_pendente = true;
+        return;
+    }
+
+    uint8_t p[INICIO_BYTES];
+    uint8_t *q;
+    uint32_t t = (uint32_t)e->t_us;
+
+    if (inicio_pendente) {
+        p[0] = TRACE_VERSAO;
+        p[1] = seq++;
+        q = put_u32(p + 2, t);
+        q = put_u32(q, (uint32_t)(e->t_us >> 32));
+        decisao_exportar(d, q);
+        quadro(TRACE_INICIO, p, INICIO_BYTES);
+        inicio_pendente = false;
+        ciclos_sem_inicio = 0;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (!e->localizar[i]) continue;
+        p[0] = seq++;
+        q = put_u32(p + 1, t);
+        *q++ = TRACE_CMD_LOCALIZAR;
+        *q++ = (uint8_t)(i + 1);
+        quadro(TRACE_COMANDO, p, COMANDO_BYTES);
+    }
+
+    p[0] = seq++;
+    q = put_u32(p + 1, t);
+    *q++ = (uint8_t)e->d1_mm;
+    *q++ = (uint8_t)(e->d1_mm >> 8);
+    *q++ = (uint8_t)e->d2_mm;
+    *q++ = (uint8_t)(e->d2_mm >> 8);
+    *q++ = e->d2_nova ? TRACE_FLAG_D2_NOVA : 0;
+    quadro(TRACE_CICLO, p, CICLO_BYTES);
+    ciclos_sem_inicio++;
+}
+
+// Retira os quadros inteiros que couberem em 'max' bytes: o texto do log
+// divide a CDC com o trace e só pode cair entre dois quadros
+size_t trace_ler(uint8_t *buf, size_t max) {
+    size_t n = 0;
+    while (leitura != escrita) {
+        size_t len = buffer[(leitura + 3) & (TRACE_BUFFER_BYTES - 1)] + TRACE_QUADRO_EXTRA;
+        if (n + len > max) break;
+        for (size_t i = 0; i < len; i++) buf[n++] = buffer[leitura++ & (TRACE_BUFFER_BYTES - 1)];
+    }
+    return n;
+}
+
+const trace_stats_t *trace_get_stats(void) {
+    return &stats;
+}
+
+// ================= DECODIFICAÇÃO =================
+
+enum { FASE_SYNC0 = 0, FASE_SYNC1, FASE_TIPO, FASE_LEN, FASE_PAYLOAD, FASE_CRC };
+
+void trace_leitor_init(trace_leitor_t *l) {
+    memset(l, 0, sizeof(*l));
+}
+
+bool trace_leitor_byte(trace_leitor_t *l, uint8_t b) {
+    switch (l->fase) {
+    case FASE_SYNC0:
+        if (b == TRACE_SYNC0) l->fase = FASE_SYNC1;
+        return false;
+    case FASE_SYNC1:
+        l->fase = (b == TRACE_SYNC1) ? FASE_TIPO : (b == TRACE_SYNC0) ? FASE_SYNC1 : FASE_SYNC0;
+        return false;
+    case FASE_TIPO:
+        l->tipo = b;
+        l->fase = FASE_LEN;
+        return false;
+    case FASE_LEN:
+        l->len = b;
+        l->pos = 0;
+        l->fase = (b > 0) ? FASE_PAYLOAD : FASE_CRC;
+        return false;
+    case FASE_PAYLOAD:
+        l->payload[l->pos++] = b;
+        if (l->pos == l->len) l->fase = FASE_CRC;
+        return false;
+    default: {
+        uint8_t cab[2] = { l->tipo, l->len };
+        uint8_t crc = crc8_atualizar(trace_crc8(cab, 2), l->payload, l->len);
+        l->fase = FASE_SYNC0;
+        if (crc != b) {
+            l->erros_crc++;
+            return false;
+        }
+        return true;
+    }
+    }
+}
@@ -5,6 +5,9 @@
 #include "lwip/ip4_addr.h"
 #include "dhcpserver.h"
 #include "dnsserver.h"
+#include "dhcp_persistencia.h"
+#include "wifi_ap.h"
+#include "log.h"
 
 #define AP_SSID     "PicoW-Estacionamento"
 #define AP_PASSWORD "12345678"
@@ -32,11 +35,23 @@ void wifi_ap_init(void) {
     IP4_ADDR(&mask, 255, 255, 255, 0);
 
     dhcp_server_init(&dhcp_server, &ip, &mask);
+    dhcp_persistencia_init(&dhcp_server.leases);
     dns_server_init(&dns_server, &ip);
 
-    printf("\n=== WIFI AP ATIVO ===\n");
-    printf("SSID: %s\n", AP_SSID);
-    printf("IP:   %d.%d.%d.%d\n",
-           AP_IP_1, AP_IP_2, AP_IP_3, AP_IP_4);
-    printf("====================\n\n");
+    LOG_INFO("=== WIFI AP ATIVO ===");
+    LOG_INFO("SSID: %s", AP_SSID);
+    LOG_INFO("IP:   %d.%d.%d.%d", AP_IP_1, AP_IP_2, AP_IP_3, AP_IP_4);
+}
+
+// Expiração dos leases do DHCP; chamada a cada volta do laço principal
+void wifi_ap_tarefa(void) {
+    dhcp_server_tick(&dhcp_server);
+}
+
+const dhcp_lease_tabela_t *wifi_ap_leases(void) {
+    return &dhcp_server.leases;
+}
+
+const dns_server_stats_t *wifi_ap_dns_stats(void) {
+    return &dns_server.stats;
 }
@@ -0,0 +1,209 @@
+// Benchmark no PC da tabela de leases do DHCP (dhcpserver/dhcp_lease.c)
+// contra a busca linear que o dhcpserver.c usava (memcmp em todos os leases
+// a cada DISCOVER). Mede o custo por mensagem de DISCOVER/REQUEST em três
+// cargas, para pools de 8 a 256 endereços:
+//  - entrada: n clientes novos, DISCOVER + REQUEST cada (pool enchendo)
+//  - renovacao: REQUEST de um cliente qualquer com o pool cheio
+//  - rotatividade: um cliente sai (RELEASE/expiração) e outro entra
+// Também confere que as duas implementações entregam os mesmos endereços
+// na carga de entrada.
+//
+// Uso:
+//   gcc -O2 -DDHCPS_MAX_IP=256 -Idhcpserver -o dhcp_bench tools/dhcp_bench.c dhcpserver/dhcp_lease.c
+//   ./dhcp_bench
+// O tempo é do PC: serve para comparar as curvas, não como número da placa.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dhcp_lease.h"
+
+#define LEASE_S     (24 * 60 * 60)
+#define RODADAS     200000
+
+// ================= IMPLEMENTAÇÃO ANTIGA =================
+
+typedef struct {
+    uint8_t mac[6];
+    uint16_t expiry;
+} linear_lease_t;
+
+static linear_lease_t linear[DHCPS_MAX_IP];
+static int linear_n;
+
+static int linear_discover(const uint8_t *mac, uint32_t agora) {
+    int yi = linear_n;
+    for (int i = 0; i < linear_n; ++i) {
+        if (memcmp(linear[i].mac, mac, 6) == 0) {
+            yi = i;
+            break;
+        }
+        if (yi == linear_n) {
+            if (memcmp(linear[i].mac, "\x00\x00\x00\x00\x00\x00", 6) == 0) {
+                yi = i;
+            }
+            uint32_t expiry = linear[i].expiry << 16 | 0xffff;
+            if ((int32_t)(expiry - agora) < 0) {
+                memset(linear[i].mac, 0, 6);
+                yi = i;
+            }
+        }
+    }
+    return yi == linear_n ? -1 : yi;
+}
+
+static int linear_request(const uint8_t *mac, int yi, uint32_t agora) {
+    if (yi < 0 || yi >= linear_n) return -1;
+    if (memcmp(linear[yi].mac, mac, 6) == 0) {
+    } else if (memcmp(linear[yi].mac, "\x00\x00\x00\x00\x00\x00", 6) == 0) {
+        memcpy(linear[yi].mac, mac, 6);
+    } else {
+        return -1;
+    }
+    linear[yi].expiry = (agora + LEASE_S * 1000u) >> 16;
+    return yi;
+}
+
+static void linear_release(const uint8_t *mac) {
+    for (int i = 0; i < linear_n; ++i) {
+        if (memcmp(linear[i].mac, mac, 6) == 0) {
+            memset(linear[i].mac, 0, 6);
+            return;
+        }
+    }
+}
+
+// ================= AUXILIARES =================
+
+static dhcp_lease_tabela_t tabela;
+static uint8_t macs[2 * DHCPS_MAX_IP][6];
+static volatile uint32_t sumidouro;
+
+static double agora_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// MACs do mesmo fabricante (OUI fixo), como num estacionamento de celulares parecidos
+static void gerar_macs(int n) {
+    for (int i = 0; i < n; i++) {
+        uint32_t r = (uint32_t)rand();
+        macs[i][0] = 0x3c; macs[i][1] = 0x22; macs[i][2] = 0xfb;
+        macs[i][3] = (uint8_t)(r >> 16); macs[i][4] = (uint8_t)(r >> 8); macs[i][5] = (uint8_t)i;
+    }
+}
+
+static int novo_join(const uint8_t *mac, uint32_t t) {
+    uint16_t yi = dhcp_lease_oferecer(&tabela, mac, t);
+    if (yi == DHCP_LEASE_NENHUM) return -1;
+    return dhcp_lease_confirmar(&tabela, mac, yi, t, LEASE_S) == DHCP_LEASE_ACK ? yi : -1;
+}
+
+static int antigo_join(const uint8_t *mac, uint32_t t) {
+    return linear_request(mac, linear_discover(mac, t), t);
+}
+
+// ================= CARGAS =================
+
+// ns por mensagem (DISCOVER e REQUEST contam uma cada)
+static double entrada(int n, int novo) {
+    int reps = RODADAS / n + 1;
+    double total = 0;
+    for (int r = 0; r < reps; r++) {
+        dhcp_lease_init(&tabela, n, 0);
+        memset(linear, 0, sizeof(linear));
+        linear_n = n;
+        double t0 = agora_ns();
+        for (int i = 0; i < n; i++) sumidouro += novo ? novo_join(macs[i], 1000) : antigo_join(macs[i], 1000);
+        total += agora_ns() - t0;
+    }
+    return total / (reps * n * 2.0);
+}
+
+static double renovacao(int n, int novo) {
+    double t0 = agora_ns();
+    for (int r = 0; r < RODADAS; r++) {
+        int i = (int)((uint32_t)r * 2654435761u % (uint32_t)n);
+        uint32_t t = 2000 + r;
+        if (novo) {
+            // RENEWING: REQUEST direto com o endereço atual
+            uint16_t yi = dhcp_lease_buscar(&tabela, macs[i]);
+            sumidouro += dhcp_lease_confirmar(&tabela, macs[i], yi, t, LEASE_S);
+            dhcp_lease_tick(&tabela, t);
+        } else {
+            // O servidor antigo só achava o índice pelo IP pedido; o DISCOVER faz a busca
+            sumidouro += linear_request(macs[i], linear_discover(macs[i], t), t);
+        }
+    }
+    return (agora_ns() - t0) / RODADAS;
+}
+
+static double rotatividade(int n, int novo) {
+    double t0 = agora_ns();
+    for (int r = 0; r < RODADAS; r++) {
+        // Sai o cliente r, entra o r + n (os MACs se alternam entre as duas metades)
+        const uint8_t *sai = macs[r % (2 * n)];
+        const uint8_t *entra = macs[(r + n) % (2 * n)];
+        uint32_t t = 500000 + r;
+        if (novo) {
+            dhcp_lease_liberar(&tabela, sai);
+            sumidouro += novo_join(entra, t);
+            dhcp_lease_tick(&tabela, t);
+        } else {
+            linear_release(sai);
+            sumidouro += antigo_join(entra, t);
+        }
+    }
+    return (agora_ns() - t0) / (RODADAS * 3.0);
+}
+
+// ================= MAIN =================
+
+int main(void) {
+    static const int tamanhos[] = { 8, 16, 32, 64, 128, 256 };
+
+    printf("ns por mensagem (antiga = busca linear, nova = hash + roda)\n");
+    printf("%5s | %9s %9s | %9s %9s | %9s %9s\n", "pool", "entrada", "", "renovacao", "", "rotativ.", "");
+    printf("%5s | %9s %9s | %9s %9s | %9s %9s\n", "", "antiga", "nova", "antiga", "nova", "antiga", "nova");
+
+    for (size_t k = 0; k < sizeof(tamanhos) / sizeof(tamanhos[0]); k++) {
+        int n = tamanhos[k];
+        if (n > DHCPS_MAX_IP) break;
+        srand(n);
+        gerar_macs(2 * n);
+
+        // Mesmos endereços nas duas implementações com o pool enchendo
+        dhcp_lease_init(&tabela, n, 0);
+        memset(linear, 0, sizeof(linear));
+        linear_n = n;
+        for (int i = 0; i < n; i++) {
+            if (novo_join(macs[i], 1000) != antigo_join(macs[i], 1000)) {
+                fprintf(stderr, "divergencia no cliente %d do pool %d\n", i, n);
+                return 1;
+            }
+        }
+        if (novo_join(macs[n], 1000) != -1 || dhcp_lease_em_uso(&tabela) != n) {
+            fprintf(stderr, "pool %d deveria estar esgotado\n", n);
+            return 1;
+        }
+
+        double ea = entrada(n, 0), en = entrada(n, 1);
+
+        // Renovação e rotatividade partem do pool cheio
+        dhcp_lease_init(&tabela, n, 0);
+        memset(linear, 0, sizeof(linear));
+        for (int i = 0; i < n; i++) {
+            novo_join(macs[i], 1000);
+            antigo_join(macs[i], 1000);
+        }
+        double ra = renovacao(n, 0), rn = renovacao(n, 1);
+        double ca = rotatividade(n, 0), cn = rotatividade(n, 1);
+
+        printf("%5d | %9.1f %9.1f | %9.1f %9.1f | %9.1f %9.1f\n", n, ea, en, ra, rn, ca, cn);
+    }
+    printf("(ofertas %u, acks %u, naks %u)\n", tabela.stats.ofertas, tabela.stats.acks, tabela.stats.naks);
+    return 0;
+}
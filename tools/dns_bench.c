@@ -0,0 +1,193 @@
+// Benchmark no PC do DNS do portal cativo (dnsserver/dns_resposta.c) contra
+// o caminho antigo do dnsserver.c: cópia da consulta para um buffer de 300
+// bytes na pilha, resposta A montada byte a byte (qualquer que fosse o tipo)
+// e nova cópia para o pbuf de saída. O novo reescreve o cabeçalho no lugar e
+// anexa o registro pronto (no firmware, um pbuf PBUF_ROM encadeado).
+//
+// As consultas imitam o que um celular manda ao entrar no AP: A, AAAA e
+// HTTPS do mesmo nome, com o registro OPT do EDNS. A chegada do pacote
+// (cópia para o buffer de recepção) entra no custo dos dois lados.
+//
+// Uso:
+//   gcc -O2 -Idnsserver -o dns_bench tools/dns_bench.c dnsserver/dns_resposta.c
+//   ./dns_bench
+// O tempo é do PC: serve para comparar os caminhos, não como número da placa.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "dns_resposta.h"
+
+#define RODADAS          2000000
+#define MAX_DNS_MSG_SIZE 300
+
+static const uint8_t ip_ap[4] = { 192, 168, 4, 1 };
+
+static uint8_t consultas[3][128];
+static size_t consultas_len[3];
+static const uint16_t tipos[3] = { 1, 28, 65 };
+static const char *const nomes_tipos[3] = { "A", "AAAA", "HTTPS" };
+
+static uint8_t rx[512];
+static uint8_t tx[512];
+static volatile uint32_t sumidouro;
+
+static double agora_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static size_t montar_consulta(uint8_t *m, uint16_t id, const char *nome, uint16_t tipo) {
+    size_t n = 0;
+    m[n++] = id >> 8; m[n++] = id & 0xFF;
+    m[n++] = 0x01; m[n++] = 0x00;                    // RD
+    m[n++] = 0; m[n++] = 1;                          // QDCOUNT
+    m[n++] = 0; m[n++] = 0; m[n++] = 0; m[n++] = 0;
+    m[n++] = 0; m[n++] = 1;                          // ARCOUNT (OPT)
+    while (*nome) {
+        const char *ponto = strchr(nome, '.');
+        size_t l = ponto ? (size_t)(ponto - nome) : strlen(nome);
+        m[n++] = (uint8_t)l;
+        memcpy(m + n, nome, l);
+        n += l;
+        nome += l + (ponto ? 1 : 0);
+    }
+    m[n++] = 0;
+    m[n++] = tipo >> 8; m[n++] = tipo & 0xFF;
+    m[n++] = 0; m[n++] = 1;                          // IN
+    // OPT: raiz, tipo 41, UDP 1232, sem opções
+    static const uint8_t opt[] = { 0, 0, 41, 0x04, 0xD0, 0, 0, 0, 0, 0, 0 };
+    memcpy(m + n, opt, sizeof(opt));
+    return n + sizeof(opt);
+}
+
+// ================= CAMINHO ANTIGO =================
+
+static size_t antigo(const uint8_t *pacote, size_t len) {
+    uint8_t dns_msg[MAX_DNS_MSG_SIZE];
+    size_t msg_len = len < sizeof(dns_msg) ? len : sizeof(dns_msg);
+    memcpy(dns_msg, pacote, msg_len);                // pbuf_copy_partial
+    if (msg_len < 12) return 0;
+
+    uint16_t flags = (uint16_t)(dns_msg[2] << 8 | dns_msg[3]);
+    if ((flags >> 15) & 1 || ((flags >> 11) & 0xF) != 0) return 0;
+    if ((dns_msg[4] << 8 | dns_msg[5]) < 1) return 0;
+
+    const uint8_t *inicio = dns_msg + 12, *fim = dns_msg + msg_len, *q = inicio;
+    while (q < fim) {
+        if (*q == 0) {
+            q++;
+            break;
+        }
+        int l = *q++;
+        if (l > 63) return 0;
+        q += l;
+    }
+    if (q - inicio > 255) return 0;
+    q += 4;
+
+    uint8_t *a = dns_msg + (q - dns_msg);
+    *a++ = 0xc0; *a++ = (uint8_t)(inicio - dns_msg);
+    *a++ = 0; *a++ = 1;
+    *a++ = 0; *a++ = 1;
+    *a++ = 0; *a++ = 0; *a++ = 0; *a++ = 60;
+    *a++ = 0; *a++ = 4;
+    memcpy(a, ip_ap, 4);
+    a += 4;
+    dns_msg[2] = 0x84; dns_msg[3] = 0x80;
+    dns_msg[4] = 0; dns_msg[5] = 1;
+    dns_msg[6] = 0; dns_msg[7] = 1;
+    memset(dns_msg + 8, 0, 4);
+
+    size_t n = (size_t)(a - dns_msg);
+    memcpy(tx, dns_msg, n);                          // pbuf_alloc + memcpy do dns_socket_sendto
+    return n;
+}
+
+// ================= CAMINHO NOVO =================
+
+static dns_modelos_t modelos;
+static dns_recentes_t recentes;
+
+static size_t novo(uint8_t *msg, size_t len, uint32_t agora_ms) {
+    size_t mantido, reg_len;
+    uint32_t hash;
+    dns_resposta_t r = dns_resposta_preparar(msg, len, &mantido, &hash);
+    if (r == DNS_RESPOSTA_IGNORAR) return 0;
+    sumidouro += dns_recentes_repeticao(&recentes, 0x0104A8C0, hash, agora_ms);
+    const uint8_t *reg = dns_modelo(&modelos, r, &reg_len);
+    sumidouro += reg[0];                             // Encadeado, não copiado
+    return mantido + reg_len;
+}
+
+// ================= CONFERÊNCIA =================
+
+static int conferir(int k) {
+    memcpy(rx, consultas[k], consultas_len[k]);
+    size_t n = novo(rx, consultas_len[k], 0);
+    size_t mantido = consultas_len[k] - 11;          // Sem o OPT
+    size_t reg_len;
+    const uint8_t *reg = dns_modelo(&modelos, tipos[k] == 1 ? DNS_RESPOSTA_A : DNS_RESPOSTA_VAZIA, &reg_len);
+    uint8_t rcode = rx[3] & 0xF;
+    uint16_t an = (uint16_t)(rx[6] << 8 | rx[7]), ns = (uint16_t)(rx[8] << 8 | rx[9]);
+    uint16_t tipo_reg = (uint16_t)(reg[2] << 8 | reg[3]);
+
+    printf("  %-5s -> rcode %u, %u resposta(s), %u autoridade, registro tipo %u, %zu bytes\n",
+           nomes_tipos[k], rcode, an, ns, tipo_reg, n);
+    if (n != mantido + reg_len || rcode != 0) return 1;
+    if (tipos[k] == 1) return !(an == 1 && ns == 0 && tipo_reg == 1 && memcmp(reg + 12, ip_ap, 4) == 0);
+    return !(an == 0 && ns == 1 && tipo_reg == 6);
+}
+
+int main(void) {
+    uint32_t ip;
+    memcpy(&ip, ip_ap, 4);
+    dns_modelos_init(&modelos, ip);
+    for (int k = 0; k < 3; k++) {
+        consultas_len[k] = montar_consulta(consultas[k], (uint16_t)(0x1234 + k), "connectivitycheck.gstatic.com", tipos[k]);
+    }
+
+    printf("respostas do caminho novo:\n");
+    for (int k = 0; k < 3; k++) {
+        if (conferir(k)) {
+            fprintf(stderr, "resposta errada para %s\n", nomes_tipos[k]);
+            return 1;
+        }
+    }
+    // Tipo não suportado (MX) sai como NXDOMAIN
+    size_t n = montar_consulta(rx, 1, "exemplo.com", 15), m;
+    uint32_t h;
+    if (dns_resposta_preparar(rx, n, &m, &h) != DNS_RESPOSTA_NXDOMAIN || (rx[3] & 0xF) != 3) {
+        fprintf(stderr, "MX deveria dar NXDOMAIN\n");
+        return 1;
+    }
+
+    // Melhor de 5 medidas alternadas (o PC tem ruído de agendamento)
+    printf("\nconsultas/s (A, AAAA, HTTPS em rodízio, melhor de 5)\n");
+    double antigo_ns = 1e9, novo_ns = 1e9;
+    for (int medida = 0; medida < 5; medida++) {
+        double t0 = agora_ns();
+        for (int r = 0; r < RODADAS; r++) {
+            int k = r % 3;
+            memcpy(rx, consultas[k], consultas_len[k]);  // Chegada do pacote
+            sumidouro += (uint32_t)antigo(rx, consultas_len[k]);
+        }
+        double t = (agora_ns() - t0) / RODADAS;
+        if (t < antigo_ns) antigo_ns = t;
+
+        t0 = agora_ns();
+        for (int r = 0; r < RODADAS; r++) {
+            int k = r % 3;
+            memcpy(rx, consultas[k], consultas_len[k]);
+            sumidouro += (uint32_t)novo(rx, consultas_len[k], (uint32_t)r / 1000);
+        }
+        t = (agora_ns() - t0) / RODADAS;
+        if (t < novo_ns) novo_ns = t;
+    }
+
+    printf("  antigo: %8.1f ns/consulta  %10.0f consultas/s (A em todas as respostas)\n", antigo_ns, 1e9 / antigo_ns);
+    printf("  novo:   %8.1f ns/consulta  %10.0f consultas/s\n", novo_ns, 1e9 / novo_ns);
+    return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef HOST_PICO_TIME_H
+#define HOST_PICO_TIME_H
+
+// pico/time.h mínimo para compilar módulos do firmware no PC. O relógio é
+// de quem compila junto: a ferramenta define get_absolute_time() e nil_time
+// (extern const, como no SDK).
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef uint64_t absolute_time_t;
+
+extern const absolute_time_t nil_time;
+
+absolute_time_t get_absolute_time(void);
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+
+static inline bool is_nil_time(absolute_time_t t) {
+    return t == 0;
+}
+
+#endif
@@ -0,0 +1,148 @@
+// Teste no PC da permanência nas vagas (src/parking_state.c) com o laço
+// principal irregular: cada volta leva 100 ms mais um jitter aleatório e, de
+// vez em quando, uma parada longa (sleep da cancela, timeout do VL53L0X,
+// espera do eco). O relógio é simulado; a permanência informada é conferida
+// contra o tempo real de ocupação a cada volta.
+//
+// Limite esperado: a permanência é a diferença de dois instantes, e a
+// chegada só é vista na primeira amostra depois dela. O erro fica então entre
+// 0 e o maior intervalo entre amostras (+1 ms do truncamento), sem crescer
+// com a duração da ocupação. O contador antigo (+100 ms por volta) aparece
+// na saída para comparação.
+//
+// Também confere o "debounce" do estado: amostras repetidas não reiniciam a
+// ocupação, só a troca registra instante, e a permanência herdada de um
+// reset (vaga_restaurar) soma com a atual.
+//
+// Compilação e uso (na raiz do projeto):
+//   gcc -O2 -Iinc -Itools/host -o parking_state_teste tools/parking_state_teste.c src/parking_state.c
+//   ./parking_state_teste
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "parking_state.h"
+
+#define ESTADIAS        200
+#define PASSO_ANTIGO_MS 100
+
+static uint64_t agora_us = 1000000;
+static int falhas = 0;
+
+const absolute_time_t nil_time = 0;
+
+absolute_time_t get_absolute_time(void) {
+    return agora_us;
+}
+
+#define CONFERIR(cond, ...)                          \
+    do {                                             \
+        if (!(cond)) {                               \
+            fprintf(stderr, "FALHA: " __VA_ARGS__);  \
+            fprintf(stderr, "\n");                   \
+            falhas++;                                \
+        }                                            \
+    } while (0)
+
+// Duração de uma volta do laço
+static uint32_t volta_us(void) {
+    uint32_t t = 100000 + (uint32_t)(rand() % 20000);
+    int r = rand() % 100;
+    if (r < 10) t += 300000;                         // Cancela
+    else if (r < 13) t += 1000000;                   // Timeout do VL53L0X
+    else if (r < 20) t += (uint32_t)(rand() % 30000);  // Eco do ultrassônico
+    return t;
+}
+
+// ================= DEBOUNCE =================
+
+static void testar_transicoes(void) {
+    vaga_status_t v;
+    vaga_init(&v);
+    CONFERIR(!v.ocupada && v.ocupada_desde == nil_time && v.liberada_em == nil_time, "vaga_init");
+
+    CONFERIR(!vaga_atualizar(&v, false, agora_us), "livre repetido nao e transicao");
+    CONFERIR(vaga_atualizar(&v, true, agora_us), "chegada e transicao");
+    absolute_time_t desde = v.ocupada_desde;
+
+    for (int i = 0; i < 50; i++) {
+        agora_us += volta_us();
+        CONFERIR(!vaga_atualizar(&v, true, agora_us), "ocupada repetido nao e transicao");
+    }
+    CONFERIR(v.ocupada_desde == desde, "amostras repetidas nao reiniciam a ocupacao");
+    CONFERIR(vaga_tempo_ocupada_ms(&v) == (agora_us - desde) / 1000, "permanencia pelo instante da chegada");
+
+    agora_us += volta_us();
+    CONFERIR(vaga_atualizar(&v, false, agora_us), "saida e transicao");
+    CONFERIR(v.liberada_em == agora_us, "saida registra o instante da amostra");
+    CONFERIR(vaga_tempo_ocupada_ms(&v) == 0, "vaga livre tem permanencia 0");
+
+    // Estado recuperado da flash: a permanência continua de onde parou
+    vaga_restaurar(&v, true, 5000);
+    agora_us += 2000000;
+    CONFERIR(vaga_tempo_ocupada_ms(&v) == 7000, "restaurada: %u ms", vaga_tempo_ocupada_ms(&v));
+    CONFERIR(!vaga_atualizar(&v, true, agora_us), "restaurada ocupada nao e transicao");
+    agora_us += volta_us();
+    vaga_atualizar(&v, false, agora_us);
+    agora_us += volta_us();
+    vaga_atualizar(&v, true, agora_us);
+    CONFERIR(vaga_tempo_ocupada_ms(&v) == 0, "nova chegada zera a permanencia herdada");
+}
+
+// ================= JITTER =================
+
+int main(void) {
+    srand(35);
+    testar_transicoes();
+
+    vaga_status_t v;
+    vaga_init(&v);
+
+    uint64_t erro_max_us = 0;
+    uint64_t lacuna_max_us = 0;
+    int64_t antigo_erro_max_ms = 0;
+    uint64_t conferencias = 0;
+
+    for (int e = 0; e < ESTADIAS; e++) {
+        // Chegada e saída reais caem entre as amostras
+        uint64_t chegada = agora_us + 1000 + (uint64_t)(rand() % 5000000);
+        uint64_t saida = chegada + 1000000 + (uint64_t)(rand() % 2000) * 1000000 / 2;  // até ~17 min
+        uint64_t antigo_ms = 0;
+
+        while (agora_us < saida + 2000000) {
+            uint32_t passo = volta_us();
+            agora_us += passo;
+            if (passo > lacuna_max_us) lacuna_max_us = passo;
+
+            bool ocupada = agora_us >= chegada && agora_us < saida;
+            vaga_atualizar(&v, ocupada, agora_us);
+            if (ocupada) antigo_ms += PASSO_ANTIGO_MS;
+            if (!ocupada || !v.ocupada) continue;
+
+            // Erro da permanência informada contra a real
+            uint64_t real_us = agora_us - chegada;
+            int64_t erro_us = (int64_t)real_us - (int64_t)vaga_tempo_ocupada_ms(&v) * 1000;
+            CONFERIR(erro_us >= 0, "permanencia maior que a real (%lld us)", (long long)erro_us);
+            if (erro_us > (int64_t)erro_max_us) erro_max_us = (uint64_t)erro_us;
+
+            int64_t antigo_erro = (int64_t)(real_us / 1000) - (int64_t)antigo_ms;
+            if (antigo_erro > antigo_erro_max_ms) antigo_erro_max_ms = antigo_erro;
+            conferencias++;
+        }
+    }
+
+    CONFERIR(erro_max_us < lacuna_max_us + 1000, "erro %llu us acima do maior intervalo entre amostras (%llu us)",
+             (unsigned long long)erro_max_us, (unsigned long long)lacuna_max_us);
+
+    printf("%d estadias, %llu conferencias\n", ESTADIAS, (unsigned long long)conferencias);
+    printf("  maior intervalo entre amostras: %8.1f ms\n", lacuna_max_us / 1000.0);
+    printf("  erro maximo (instantes):        %8.1f ms\n", erro_max_us / 1000.0);
+    printf("  erro maximo (+%d ms por volta): %8lld ms\n", PASSO_ANTIGO_MS, (long long)antigo_erro_max_ms);
+
+    if (falhas) {
+        fprintf(stderr, "%d falha(s)\n", falhas);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+# Converte o despejo do rastro de eventos (/rastro, inc/rastro.h) para o
+# JSON do Chrome trace, aberto em chrome://tracing ou ui.perfetto.dev.
+# No stderr vai um resumo com os ticks de aquisição mais atrasados e a etapa
+# mais longa que rodava entre o vencimento e o início de cada um.
+#
+# Uso:
+#   python3 tools/rastro_chrome.py captura.bin > rastro.json
+#   (captura.bin = saída bruta da CDC USB depois de GET /rastro; o texto do
+#   printf e os quadros do trace da decisão no meio são ignorados)
+
+import json
+import struct
+import sys
+
+SYNC0, SYNC1 = 0xA5, 0x5A
+TRACE_RASTRO_INICIO = 4
+TRACE_RASTRO = 5
+RASTRO_VERSAO = 1
+
+AQUISICAO_INICIO, AQUISICAO_FIM = 0x01, 0x02
+TCP_ACEITE, TCP_FECHA = 0x03, 0x04
+I2C_INICIO, I2C_FIM = 0x05, 0x06
+ETAPA = 0x10
+
+# Mesma ordem de metricas_etapa_t
+ETAPAS = ["laco", "cyw43_poll", "http", "vl53l0x", "ultrassonico", "decisao", "display", "persistencia"]
+ETAPA_ULTRASSONICO = 4
+
+# Trilhas (tid) no visualizador
+LACO, IRQ, AQUISICAO = 1, 2, 3
+TRILHAS = {LACO: "laço principal", IRQ: "IRQ ultrassônico", AQUISICAO: "tick de aquisição"}
+
+
+def crc8(dados, crc=0):
+    for b in dados:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def quadros(dados):
+    """Quadros válidos (tipo, payload) do fluxo bruto, como trace_leitor_byte."""
+    i, n = 0, len(dados)
+    while i + 5 <= n:
+        if dados[i] != SYNC0 or dados[i + 1] != SYNC1:
+            i += 1
+            continue
+        tipo, tam = dados[i + 2], dados[i + 3]
+        fim = i + 4 + tam
+        if fim >= n:
+            i += 1
+            continue
+        if crc8(dados[i + 2:fim]) == dados[fim]:
+            yield tipo, bytes(dados[i + 4:fim])
+            i = fim + 1
+        else:
+            i += 1
+
+
+def ler_despejos(dados):
+    """Lista de despejos: (cabeçalho, entradas [(t32, id, arg)], lacunas)."""
+    despejos = []
+    atual = None
+    for tipo, p in quadros(dados):
+        if tipo == TRACE_RASTRO_INICIO and len(p) == 15:
+            versao, n, sobrescritas, congelado = struct.unpack("<BHIQ", p)
+            if versao != RASTRO_VERSAO:
+                sys.exit(f"versao de rastro {versao} nao suportada")
+            atual = {"n": n, "sobrescritas": sobrescritas, "congelado_us": congelado,
+                     "entradas": [], "lacunas": 0}
+            despejos.append(atual)
+        elif tipo == TRACE_RASTRO and atual is not None and len(p) >= 2 and (len(p) - 2) % 8 == 0:
+            (indice,) = struct.unpack_from("<H", p)
+            if indice != len(atual["entradas"]):
+                atual["lacunas"] += 1
+            for k in range(2, len(p), 8):
+                t32, id_arg = struct.unpack_from("<II", p, k)
+                atual["entradas"].append((t32, id_arg >> 24, id_arg & 0xFFFFFF))
+    return despejos
+
+
+def converter(despejo):
+    # Os 32 bits baixos são desdobrados a partir do instante do congelamento
+    cong = despejo["congelado_us"]
+    entradas = [(cong - ((cong - t32) & 0xFFFFFFFF), i, a) for t32, i, a in despejo["entradas"]]
+    entradas.sort(key=lambda e: e[0])
+    t0 = entradas[0][0] if entradas else 0
+
+    eventos = [{"ph": "M", "pid": 1, "tid": tid, "name": "thread_name", "args": {"name": nome}}
+               for tid, nome in TRILHAS.items()]
+    blocos = []
+    for t, ident, arg in entradas:
+        ts = t - t0
+        if ident >= ETAPA:
+            etapa = ident - ETAPA
+            nome = ETAPAS[etapa] if etapa < len(ETAPAS) else f"etapa_{etapa}"
+            tid = IRQ if etapa == ETAPA_ULTRASSONICO else LACO
+            eventos.append({"ph": "X", "pid": 1, "tid": tid, "name": nome, "ts": ts, "dur": arg})
+            if tid == LACO and etapa != 0:
+                blocos.append((ts, ts + arg, nome))
+        elif ident == AQUISICAO_INICIO:
+            eventos.append({"ph": "B", "pid": 1, "tid": AQUISICAO, "name": "aquisicao", "ts": ts,
+                            "args": {"atraso_us": arg}})
+        elif ident == AQUISICAO_FIM:
+            eventos.append({"ph": "E", "pid": 1, "tid": AQUISICAO, "ts": ts, "args": {"canais_novos": arg}})
+        elif ident in (TCP_ACEITE, TCP_FECHA):
+            nome = "tcp_aceite" if ident == TCP_ACEITE else "tcp_fecha"
+            eventos.append({"ph": "i", "s": "t", "pid": 1, "tid": LACO, "name": nome, "ts": ts,
+                            "args": {"porta": arg}})
+        elif ident == I2C_INICIO:
+            eventos.append({"ph": "B", "pid": 1, "tid": LACO, "name": f"i2c 0x{arg & 0xFF:02x}", "ts": ts,
+                            "args": {"bytes": arg >> 8}})
+        elif ident == I2C_FIM:
+            eventos.append({"ph": "E", "pid": 1, "tid": LACO, "ts": ts})
+    return eventos, entradas, blocos, t0
+
+
+def resumir(despejo, entradas, blocos, t0):
+    janela = (entradas[-1][0] - entradas[0][0]) / 1e6 if entradas else 0
+    print(f"{len(entradas)} entradas ({despejo['n']} esperadas, {despejo['lacunas']} lacunas), "
+          f"{despejo['sobrescritas']} sobrescritas, janela de {janela:.3f} s", file=sys.stderr)
+
+    ticks = [(a, t - t0) for t, i, a in entradas if i == AQUISICAO_INICIO]
+    if not ticks:
+        return
+    atrasos = sorted(a for a, _ in ticks)
+    print(f"{len(ticks)} ticks de aquisicao: atraso mediano {atrasos[len(atrasos) // 2]} us, "
+          f"maximo {atrasos[-1]} us", file=sys.stderr)
+
+    for atraso, ts in sorted(ticks, reverse=True)[:5]:
+        vencimento = ts - atraso
+        culpado = max((b for b in blocos if b[0] < ts and b[1] > vencimento),
+                      key=lambda b: min(b[1], ts) - max(b[0], vencimento), default=None)
+        causa = f"{culpado[2]} ({culpado[1] - culpado[0]} us)" if culpado else "nenhuma etapa medida"
+        print(f"  t={ts / 1e6:.6f} s atraso {atraso} us: {causa}", file=sys.stderr)
+
+
+def main():
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], "rb") as f:
+            dados = f.read()
+    else:
+        dados = sys.stdin.buffer.read()
+
+    despejos = ler_despejos(dados)
+    if not despejos:
+        sys.exit("nenhum despejo do rastro na captura")
+
+    # O último despejo da captura
+    despejo = despejos[-1]
+    eventos, entradas, blocos, t0 = converter(despejo)
+    json.dump({"traceEvents": eventos, "displayTimeUnit": "ms"}, sys.stdout)
+    resumir(despejo, entradas, blocos, t0)
+
+
+if __name__ == "__main__":
+    main()
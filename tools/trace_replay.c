@@ -0,0 +1,154 @@
+// Replay de traces da placa no PC: passa cada ciclo gravado pelo mesmo
+// código de decisão do firmware (src/decisao.c) e imprime a linha do tempo
+// dos atuadores, uma linha por mudança:  t_us;atuador;valor
+//
+// Compilação (na raiz do projeto):
+//   gcc -O2 -Iinc -o trace_replay tools/trace_replay.c src/decisao.c src/trace.c
+//
+// Uso:
+//   trace_replay captura.bin > linha_do_tempo.csv
+//   (captura.bin = saída bruta da CDC USB com /trace?ligar=1; o texto do
+//   printf misturado no meio é ignorado)
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "decisao.h"
+#include "trace.h"
+
+typedef struct {
+    uint64_t ciclos;
+    uint64_t quadros;
+    uint64_t lacunas;
+    uint64_t ciclos_sem_inicio;
+    uint64_t mudancas;
+    uint64_t t_inicio_us;
+    uint64_t t_fim_us;
+} replay_stats_t;
+
+static uint32_t get_u32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void imprimir(uint64_t t_us, const char *atuador, int valor, replay_stats_t *st) {
+    printf("%llu;%s;%d\n", (unsigned long long)t_us, atuador, valor);
+    st->mudancas++;
+}
+
+// Só o que mudou em relação ao ciclo anterior
+static void comparar(uint64_t t_us, const decisao_saida_t *a, const decisao_saida_t *b, replay_stats_t *st) {
+    if (a->servo_graus != b->servo_graus) imprimir(t_us, "servo", b->servo_graus, st);
+    if (a->led_vermelho != b->led_vermelho) imprimir(t_us, "led_vermelho", b->led_vermelho, st);
+    if (a->led_verde != b->led_verde) imprimir(t_us, "led_verde", b->led_verde, st);
+    if (a->buzzer_manobra != b->buzzer_manobra) imprimir(t_us, "buzzer_manobra", b->buzzer_manobra, st);
+    if (a->buzzer_localizar != b->buzzer_localizar) imprimir(t_us, "buzzer_localizar", b->buzzer_localizar, st);
+    if (a->vaga_ocupada[0] != b->vaga_ocupada[0]) imprimir(t_us, "vaga1", b->vaga_ocupada[0], st);
+    if (a->vaga_ocupada[1] != b->vaga_ocupada[1]) imprimir(t_us, "vaga2", b->vaga_ocupada[1], st);
+}
+
+// Estado completo no início (e a cada ressincronização depois de uma lacuna)
+static void imprimir_estado(uint64_t t_us, const decisao_saida_t *s, replay_stats_t *st) {
+    imprimir(t_us, "servo", s->servo_graus, st);
+    imprimir(t_us, "led_vermelho", s->led_vermelho, st);
+    imprimir(t_us, "led_verde", s->led_verde, st);
+    imprimir(t_us, "buzzer_manobra", s->buzzer_manobra, st);
+    imprimir(t_us, "buzzer_localizar", s->buzzer_localizar, st);
+    imprimir(t_us, "vaga1", s->vaga_ocupada[0], st);
+    imprimir(t_us, "vaga2", s->vaga_ocupada[1], st);
+}
+
+int main(int argc, char **argv) {
+    FILE *f = (argc > 1) ? fopen(argv[1], "rb") : stdin;
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    static trace_leitor_t leitor;
+    decisao_t decisao;
+    decisao_entrada_t entrada;
+    replay_stats_t st;
+    bool sincronizado = false;
+    bool primeiro = true;
+    uint8_t seq_esperado = 0;
+    uint64_t t_us = 0;
+    uint8_t buf[4096];
+    size_t n;
+
+    trace_leitor_init(&leitor);
+    decisao_init(&decisao);
+    memset(&entrada, 0, sizeof(entrada));
+    memset(&st, 0, sizeof(st));
+
+    clock_t c0 = clock();
+    printf("t_us;atuador;valor\n");
+
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (!trace_leitor_byte(&leitor, buf[i])) continue;
+
+            const uint8_t *p = leitor.payload;
+            uint8_t seq = (leitor.tipo == TRACE_INICIO) ? p[1] : p[0];
+            st.quadros++;
+
+            // Quadros perdidos: o estado só volta a ser confiável no próximo INICIO
+            if (!primeiro && seq != seq_esperado) {
+                st.lacunas++;
+                sincronizado = false;
+            }
+            primeiro = false;
+            seq_esperado = seq + 1;
+
+            if (leitor.tipo == TRACE_INICIO && leitor.len == 10 + DECISAO_ESTADO_BYTES) {
+                if (p[0] != TRACE_VERSAO) {
+                    fprintf(stderr, "versao de trace %u nao suportada\n", p[0]);
+                    return 1;
+                }
+                t_us = get_u32(p + 2) | ((uint64_t)get_u32(p + 6) << 32);
+                decisao_saida_t antes = decisao.saida;
+                decisao_importar(&decisao, p + 10);
+                memset(&entrada, 0, sizeof(entrada));
+                if (!st.t_inicio_us) st.t_inicio_us = t_us;
+                // INICIO periódico em sequência: o estado deve coincidir com
+                // o do replay, então só uma divergência aparece na saída
+                if (sincronizado) comparar(t_us, &antes, &decisao.saida, &st);
+                else imprimir_estado(t_us, &decisao.saida, &st);
+                sincronizado = true;
+            } else if (leitor.tipo == TRACE_COMANDO && leitor.len == 7) {
+                if (p[5] == TRACE_CMD_LOCALIZAR && p[6] >= 1 && p[6] <= 2) entrada.localizar[p[6] - 1] = true;
+            } else if (leitor.tipo == TRACE_CICLO && leitor.len == 10) {
+                if (!sincronizado) {
+                    st.ciclos_sem_inicio++;
+                    continue;
+                }
+                // Só os 32 bits baixos vêm no ciclo: reconstrói a partir do anterior
+                t_us += (uint32_t)(get_u32(p + 1) - (uint32_t)t_us);
+
+                entrada.t_us = t_us;
+                entrada.d1_mm = p[5] | (p[6] << 8);
+                entrada.d2_mm = p[7] | (p[8] << 8);
+                entrada.d2_nova = p[9] & TRACE_FLAG_D2_NOVA;
+
+                decisao_saida_t antes = decisao.saida;
+                comparar(t_us, &antes, decisao_passo(&decisao, &entrada), &st);
+                entrada.localizar[0] = entrada.localizar[1] = false;
+
+                st.ciclos++;
+                st.t_fim_us = t_us;
+            }
+        }
+    }
+
+    double cpu_s = (double)(clock() - c0) / CLOCKS_PER_SEC;
+    fprintf(stderr,
+            "%llu quadros, %llu ciclos, %llu mudancas, %llu lacunas, %llu ciclos sem INICIO, %u erros de CRC\n"
+            "%.1f s de trace em %.3f s de CPU\n",
+            (unsigned long long)st.quadros, (unsigned long long)st.ciclos,
+            (unsigned long long)st.mudancas, (unsigned long long)st.lacunas,
+            (unsigned long long)st.ciclos_sem_inicio, leitor.erros_crc,
+            (st.t_fim_us - st.t_inicio_us) / 1e6, cpu_s);
+
+    if (f != stdin) fclose(f);
+    return 0;
+}